@@ -0,0 +1,143 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Streams synthetic scans through FaultInjector into RPLidarDecoder on a
+// virtual clock and reports, per fault profile, how many scans and samples
+// are lost and how long it takes until complete scans are decoded again.
+
+#include "fault-injector.hpp"
+#include "rplidar-decoder.hpp"
+#include "scan-synthesizer.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+int32_t main(int32_t argc, char **argv) {
+  const uint32_t SCANS{600};
+  const uint32_t SAMPLES_PER_SCAN{720};
+  const float SCAN_FREQUENCY{10.0f};
+  const size_t CHUNK_SIZE{64};
+
+  std::vector<FaultInjector::Profile> profiles;
+  for (int32_t i{1}; i < argc; i++) {
+    FaultInjector::Profile profile;
+    if (!FaultInjector::parseProfile(argv[i], profile)) {
+      std::cerr << argv[0] << ": Invalid fault profile " << argv[i] << std::endl;
+      return 1;
+    }
+    profiles.push_back(profile);
+  }
+  if (profiles.empty()) {
+    profiles = FaultInjector::predefinedProfiles();
+  }
+
+  // Response descriptor for SCAN followed by the rotations and the start of one more.
+  std::vector<uint8_t> stream{RPLidarDecoder::SYNC_BYTE0, RPLidarDecoder::SYNC_BYTE1, 0x5, 0x0, 0x0, 0x40, RPLidarDecoder::GOT_SCAN};
+  {
+    ScanSynthesizer synthesizer{ScanSynthesizer::defaultRoom(0, SCAN_FREQUENCY)};
+    ScanSynthesizer::NoiseModel noiseModel;
+    noiseModel.sigma = 0.01f;
+    synthesizer.setNoiseModel(noiseModel);
+    for (uint32_t i{0}; i <= SCANS; i++) {
+      synthesizer.synthesize(i, SAMPLES_PER_SCAN, stream);
+    }
+    stream.resize(stream.size() - (SAMPLES_PER_SCAN - 1) * 5);
+  }
+  const double NANOSECONDS_PER_BYTE{1e9 / (static_cast<double>(SCAN_FREQUENCY) * SAMPLES_PER_SCAN * 5)};
+
+  std::cout << "[" << std::endl;
+  for (size_t p{0}; p < profiles.size(); p++) {
+    FaultInjector faultInjector(profiles[p], 1);
+    RPLidarDecoder decoder;
+
+    int64_t now{0};
+    int64_t pendingFault{0};
+    uint64_t scans{0};
+    uint64_t samples{0};
+    uint64_t completeScans{0};
+    std::vector<int64_t> resyncTimes;
+    decoder.setDelegates(nullptr, nullptr, [&](const opendlv::proxy::PointCloudReading &pc){
+      const uint64_t samplesInScan{pc.distances().size() / 4};
+      scans++;
+      samples += samplesInScan;
+      if (SAMPLES_PER_SCAN == samplesInScan) {
+        completeScans++;
+        if (0 < pendingFault) {
+          resyncTimes.push_back(now - pendingFault);
+          pendingFault = 0;
+        }
+      }
+    });
+
+    std::vector<uint8_t> data;
+    faultInjector.setDelegate([&](const uint8_t *buffer, size_t size, int64_t timeStamp){
+      now = timeStamp;
+      data.insert(data.end(), buffer, buffer + size);
+      const size_t consumed{decoder.decode(data.data(), data.size())};
+      data.erase(data.begin(), data.begin() + static_cast<std::ptrdiff_t>(consumed));
+    });
+
+    // The response descriptor and its first node are delivered unharmed as
+    // the driver would otherwise simply re-send SCAN.
+    const size_t DESCRIPTOR_SIZE{7 + 5};
+    data.insert(data.end(), stream.begin(), stream.begin() + DESCRIPTOR_SIZE);
+    data.erase(data.begin(), data.begin() + static_cast<std::ptrdiff_t>(decoder.decode(data.data(), data.size())));
+    for (size_t offset{DESCRIPTOR_SIZE}; offset < stream.size(); offset += CHUNK_SIZE) {
+      const size_t size{std::min(CHUNK_SIZE, stream.size() - offset)};
+      const int64_t timeStamp{static_cast<int64_t>(static_cast<double>(offset + size) * NANOSECONDS_PER_BYTE)};
+      const int64_t lastFault{faultInjector.lastFault()};
+      faultInjector.inject(stream.data() + offset, size, timeStamp);
+      if ( (0 == pendingFault) && (lastFault != faultInjector.lastFault()) ) {
+        pendingFault = faultInjector.lastFault();
+      }
+    }
+    faultInjector.flush();
+
+    std::sort(resyncTimes.begin(), resyncTimes.end());
+    double meanResync{0.0};
+    for (auto t : resyncTimes) {
+      meanResync += static_cast<double>(t) / 1e6;
+    }
+    meanResync = resyncTimes.empty() ? 0.0 : meanResync / static_cast<double>(resyncTimes.size());
+    const double maxResync{resyncTimes.empty() ? 0.0 : static_cast<double>(resyncTimes.back()) / 1e6};
+    const uint64_t expectedSamples{static_cast<uint64_t>(SCANS) * SAMPLES_PER_SCAN};
+
+    std::cout << "  {\"profile\": \"" << profiles[p].name << "\""
+              << ", \"bytesDropped\": " << faultInjector.bytesDropped()
+              << ", \"bitsFlipped\": " << faultInjector.bitsFlipped()
+              << ", \"chunksDuplicated\": " << faultInjector.chunksDuplicated()
+              << ", \"stalls\": " << faultInjector.stalls()
+              << ", \"bursts\": " << faultInjector.bursts()
+              << ", \"scansSent\": " << SCANS
+              << ", \"scansDecoded\": " << scans
+              << ", \"scansComplete\": " << completeScans
+              << ", \"scansLost\": " << ((SCANS > scans) ? SCANS - scans : 0)
+              << ", \"samplesSent\": " << expectedSamples
+              << ", \"samplesDecoded\": " << samples
+              << ", \"samplesLost\": " << ((expectedSamples > samples) ? expectedSamples - samples : 0)
+              << ", \"resyncs\": " << resyncTimes.size()
+              << ", \"resyncMeanMs\": " << meanResync
+              << ", \"resyncMaxMs\": " << maxResync
+              << "}" << ((p + 1 < profiles.size()) ? "," : "") << std::endl;
+  }
+  std::cout << "]" << std::endl;
+  return 0;
+}
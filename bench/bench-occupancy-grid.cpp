@@ -0,0 +1,178 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Benchmark of OccupancyGrid on scans ray-cast along a trajectory through
+// the default room and decoded by RPLidarDecoder, for several numbers of
+// threads; the budget per scan is a tenth of the scan period at 10 Hz.
+// Results are printed as JSON to track them per commit and platform.
+
+#include "cluon-complete.hpp"
+
+#include "occupancy-grid.hpp"
+#include "rplidar-decoder.hpp"
+#include "scan-synthesizer.hpp"
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+struct ScanMode {
+  std::string name{};
+  float scanFrequency{0.0f};
+  uint32_t samplesPerScan{0};
+};
+
+struct Scan {
+  std::vector<float> angles{};
+  std::vector<float> distances{};
+  float x{0.0f};
+  float y{0.0f};
+  float yaw{0.0f};
+};
+
+const char *architecture() noexcept {
+#if defined(__x86_64__)
+  return "x86_64";
+#elif defined(__aarch64__)
+  return "aarch64";
+#elif defined(__arm__)
+  return "arm";
+#else
+  return "unknown";
+#endif
+}
+
+// Driving on a circle of 1.5 m radius at 0.8 m/s.
+std::vector<Scan> decodeScans(const ScanMode &mode, uint32_t numberOfScans) noexcept {
+  ScanSynthesizer synthesizer{ScanSynthesizer::defaultRoom(0, mode.scanFrequency)};
+  ScanSynthesizer::NoiseModel noiseModel;
+  noiseModel.sigma = 0.01f;
+  noiseModel.dropoutProbability = 0.01f;
+  synthesizer.setNoiseModel(noiseModel);
+  std::vector<uint8_t> nodes{RPLidarDecoder::SYNC_BYTE0, RPLidarDecoder::SYNC_BYTE1, 0x5, 0x0, 0x0, 0x40, RPLidarDecoder::GOT_SCAN};
+  std::vector<Scan> poses;
+  for (uint32_t i{0}; i <= numberOfScans; i++) {
+    const float phi{0.8f * static_cast<float>(i) / mode.scanFrequency / 1.5f};
+    Scan pose;
+    pose.x = 1.5f * std::sin(phi);
+    pose.y = 1.5f * (1.0f - std::cos(phi)) - 0.75f;
+    pose.yaw = phi;
+    poses.push_back(pose);
+    synthesizer.setSensorPose(pose.x, pose.y, pose.yaw);
+    synthesizer.synthesize(i, mode.samplesPerScan, nodes);
+  }
+  nodes.insert(nodes.end(), nodes.begin() + 7, nodes.begin() + 12);
+
+  std::vector<Scan> scans;
+  RPLidarDecoder decoder;
+  decoder.setDelegates(nullptr, nullptr, [&scans, &poses](const opendlv::proxy::PointCloudReading &pc){
+    Scan scan{poses[scans.size()]};
+    scan.angles.resize(pc.azimuthAngles().size() / sizeof(float));
+    scan.distances.resize(pc.distances().size() / sizeof(float));
+    std::memcpy(scan.angles.data(), pc.azimuthAngles().data(), scan.angles.size() * sizeof(float));
+    std::memcpy(scan.distances.data(), pc.distances().data(), scan.distances.size() * sizeof(float));
+    scans.push_back(scan);
+  });
+  decoder.decode(nodes.data(), nodes.size());
+  return scans;
+}
+}
+
+int32_t main(int32_t argc, char **argv) {
+  auto commandlineArguments = cluon::getCommandlineArguments(argc, argv);
+  if (0 != commandlineArguments.count("help")) {
+    std::cerr << argv[0] << " benchmarks OccupancyGrid on synthetic scans and prints the results as JSON." << std::endl;
+    std::cerr << "Usage:   " << argv[0] << " [--min-time=<s>] [--label=<text>]" << std::endl;
+    std::cerr << "         --min-time: minimum duration per measurement in s (default: 0.25)" << std::endl;
+    std::cerr << "         --label:    free text added to the output, e.g., the commit (default: empty)" << std::endl;
+    std::cerr << "Example: " << argv[0] << " --min-time=1 --label=$(git rev-parse --short HEAD)" << std::endl;
+    return 1;
+  }
+  const double MIN_TIME{(commandlineArguments.count("min-time") != 0) ? std::stod(commandlineArguments["min-time"]) : 0.25};
+  const std::string LABEL{(commandlineArguments.count("label") != 0) ? commandlineArguments["label"] : ""};
+  const double BUDGET_PER_SCAN{0.01};
+
+  const std::vector<ScanMode> MODES{
+    {"a1-standard", 5.5f, 360},
+    {"a3-boost", 10.0f, 1600},
+    {"a3-boost-5hz", 5.0f, 3200},
+  };
+  const std::vector<uint32_t> THREADS{1, 2, 4};
+  const uint32_t SCANS{40};
+
+  std::cout << "{\n"
+            << "  \"benchmark\": \"occupancy-grid\",\n"
+            << "  \"label\": \"" << LABEL << "\",\n"
+            << "  \"architecture\": \"" << architecture() << "\",\n"
+            << "  \"compiler\": \"" << __VERSION__ << "\",\n"
+            << "  \"cores\": " << std::thread::hardware_concurrency() << ",\n"
+            << "  \"minTime\": " << MIN_TIME << ",\n"
+            << "  \"budgetPerScan\": " << BUDGET_PER_SCAN << ",\n"
+            << "  \"results\": [\n";
+
+  bool first{true};
+  for (const auto &mode : MODES) {
+    const std::vector<Scan> scans{decodeScans(mode, SCANS)};
+    for (auto threads : THREADS) {
+      OccupancyGrid::Config config;
+      config.threads = threads;
+      OccupancyGrid grid(config);
+      uint64_t numberOfScans{0};
+      uint64_t traced{0};
+      double seconds{0.0};
+      const auto start{std::chrono::steady_clock::now()};
+      do {
+        for (const auto &scan : scans) {
+          traced += grid.integrate(scan.angles.data(), scan.distances.data(), static_cast<uint32_t>(scan.distances.size()), scan.x, scan.y, scan.yaw);
+          numberOfScans++;
+        }
+        seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+      } while (seconds < MIN_TIME);
+
+      std::string compressed;
+      const auto beforeCompress{std::chrono::steady_clock::now()};
+      grid.compress(compressed);
+      const double compressing{std::chrono::duration<double>(std::chrono::steady_clock::now() - beforeCompress).count()};
+
+      const double perScan{(0 < numberOfScans) ? seconds / static_cast<double>(numberOfScans) : 0.0};
+      std::cout << (first ? "" : ",\n")
+                << "    {\"name\": \"threads-" << threads << "\""
+                << ", \"mode\": \"" << mode.name << "\""
+                << ", \"scanFrequency\": " << mode.scanFrequency
+                << ", \"samplesPerScan\": " << mode.samplesPerScan
+                << ", \"gridSize\": " << grid.size()
+                << ", \"scans\": " << numberOfScans
+                << ", \"seconds\": " << seconds
+                << ", \"nsPerScan\": " << perScan * 1e9
+                << ", \"cellsTracedPerSecond\": " << static_cast<double>(traced) / seconds
+                << ", \"cellsUpdatedPerSecond\": " << static_cast<double>(grid.cellsUpdated()) / seconds
+                << ", \"snapshotBytes\": " << compressed.size()
+                << ", \"nsPerSnapshot\": " << compressing * 1e9
+                << ", \"withinBudget\": " << ((perScan < BUDGET_PER_SCAN) ? "true" : "false")
+                << "}";
+      first = false;
+    }
+  }
+  std::cout << "\n  ]\n}" << std::endl;
+  return 0;
+}
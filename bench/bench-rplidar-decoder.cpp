@@ -0,0 +1,256 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Microbenchmarks for the hot paths of RPLidarDecoder on synthetic scans:
+// - decode:   RPLidarDecoder::decode fed in chunks like the reader thread of
+//             RPLidar does, including the buffer handling around it;
+// - assembly: decoding and assembling complete scans without any delegate;
+// - emission: turning a complete PointCloudReading into a serialized
+//             Envelope as OD4Session::send does before handing it to UDP.
+// Results are printed as JSON to track them per commit and platform.
+
+#include "cluon-complete.hpp"
+
+#include "opendlv-standard-message-set.hpp"
+#include "decode-buffer.hpp"
+#include "fault-injector.hpp"
+#include "rplidar-decoder.hpp"
+#include "scan-synthesizer.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace {
+struct ScanMode {
+  std::string name{};
+  float scanFrequency{0.0f};
+  uint32_t samplesPerScan{0};
+};
+
+struct Noise {
+  std::string name{};
+  ScanSynthesizer::NoiseModel noiseModel{};
+  std::string faults{}; // Applied to the byte stream to exercise resynchronization.
+};
+
+struct Result {
+  uint64_t iterations{0};
+  uint64_t bytes{0};
+  uint64_t nodes{0};
+  uint64_t scans{0};
+  double seconds{0.0};
+};
+
+const char *architecture() noexcept {
+#if defined(__x86_64__)
+  return "x86_64";
+#elif defined(__aarch64__)
+  return "aarch64";
+#elif defined(__arm__)
+  return "arm";
+#else
+  return "unknown";
+#endif
+}
+
+// Runs the stream through the decoder repeatedly until minTime has passed;
+// the response descriptor is only sent in front of the first iteration.
+Result decodeStream(const std::vector<uint8_t> &descriptor, const std::vector<uint8_t> &nodes, size_t chunkSize, double minTime, bool withDelegate) noexcept {
+  Result result;
+  RPLidarDecoder decoder;
+  if (withDelegate) {
+    decoder.setDelegates(nullptr, nullptr, [&result](const opendlv::proxy::PointCloudReading &){
+      result.scans++;
+    });
+  }
+  else {
+    decoder.setDelegates(nullptr, nullptr, nullptr);
+  }
+
+  // Same buffering as RPLidar.
+  DecodeBuffer buffer(DecodeBuffer::DISCARD_ON_OVERFLOW);
+  auto feed = [&decoder, &buffer](const uint8_t *chunk, size_t length){
+    buffer.feed(decoder, chunk, length);
+  };
+
+  const auto start{std::chrono::steady_clock::now()};
+  feed(descriptor.data(), descriptor.size());
+  do {
+    for (size_t offset{0}; offset < nodes.size(); offset += chunkSize) {
+      feed(nodes.data() + offset, ((offset + chunkSize) < nodes.size()) ? chunkSize : nodes.size() - offset);
+    }
+    result.iterations++;
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  } while (result.seconds < minTime);
+
+  result.bytes = descriptor.size() + result.iterations * nodes.size();
+  result.nodes = result.iterations * (nodes.size() / 5);
+  return result;
+}
+
+// Measures the serialization of the given scans into Envelopes.
+Result emitScans(const std::vector<opendlv::proxy::PointCloudReading> &scans, double minTime, size_t &bytesPerScan) noexcept {
+  Result result;
+  bytesPerScan = 0;
+  const auto start{std::chrono::steady_clock::now()};
+  do {
+    for (auto pc : scans) {
+      cluon::ToProtoVisitor protoEncoder;
+      cluon::data::Envelope envelope;
+      envelope.dataType(static_cast<int32_t>(pc.ID()));
+      pc.accept(protoEncoder);
+      envelope.serializedData(protoEncoder.encodedData());
+      envelope.sent(cluon::time::now());
+      envelope.sampleTimeStamp(envelope.sent());
+      const std::string serialized{cluon::serializeEnvelope(std::move(envelope))};
+      bytesPerScan = serialized.size();
+      result.scans++;
+    }
+    result.iterations++;
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  } while (result.seconds < minTime);
+  return result;
+}
+
+void printResult(const std::string &name, const ScanMode &mode, const Noise &noise, size_t chunkSize, const Result &result, bool first) noexcept {
+  const double seconds{(0.0 < result.seconds) ? result.seconds : 1e-9};
+  std::cout << (first ? "" : ",\n")
+            << "    {\"name\": \"" << name << "\""
+            << ", \"mode\": \"" << mode.name << "\""
+            << ", \"scanFrequency\": " << mode.scanFrequency
+            << ", \"samplesPerScan\": " << mode.samplesPerScan
+            << ", \"noise\": \"" << noise.name << "\""
+            << ", \"chunkSize\": " << chunkSize
+            << ", \"iterations\": " << result.iterations
+            << ", \"seconds\": " << result.seconds
+            << ", \"bytes\": " << result.bytes
+            << ", \"nodes\": " << result.nodes
+            << ", \"scans\": " << result.scans
+            << ", \"bytesPerSecond\": " << static_cast<double>(result.bytes) / seconds
+            << ", \"nodesPerSecond\": " << static_cast<double>(result.nodes) / seconds
+            << ", \"nsPerScan\": " << ((0 < result.scans) ? seconds * 1e9 / static_cast<double>(result.scans) : 0.0)
+            << "}";
+}
+}
+
+int32_t main(int32_t argc, char **argv) {
+  auto commandlineArguments = cluon::getCommandlineArguments(argc, argv);
+  if (0 != commandlineArguments.count("help")) {
+    std::cerr << argv[0] << " benchmarks RPLidarDecoder on synthetic scans and prints the results as JSON." << std::endl;
+    std::cerr << "Usage:   " << argv[0] << " [--min-time=<s>] [--label=<text>]" << std::endl;
+    std::cerr << "         --min-time: minimum duration per measurement in s (default: 0.25)" << std::endl;
+    std::cerr << "         --label:    free text added to the output, e.g., the commit (default: empty)" << std::endl;
+    std::cerr << "Example: " << argv[0] << " --min-time=1 --label=$(git rev-parse --short HEAD)" << std::endl;
+    return 1;
+  }
+  const double MIN_TIME{(commandlineArguments.count("min-time") != 0) ? std::stod(commandlineArguments["min-time"]) : 0.25};
+  const std::string LABEL{(commandlineArguments.count("label") != 0) ? commandlineArguments["label"] : ""};
+
+  // Express and boost modes use different packet formats on the device; here,
+  // they are represented by their sample rates in standard 5 bytes nodes.
+  const std::vector<ScanMode> MODES{
+    {"a1-standard", 5.5f, 360},
+    {"a2-standard", 10.0f, 400},
+    {"a2-express", 10.0f, 800},
+    {"a3-boost", 10.0f, 1600},
+  };
+
+  std::vector<Noise> noises(4);
+  noises[0].name = "clean";
+  noises[1].name = "typical";
+  noises[1].noiseModel.sigma = 0.01f;
+  noises[1].noiseModel.dropoutProbability = 0.01f;
+  noises[2].name = "heavy";
+  noises[2].noiseModel.sigma = 0.05f;
+  noises[2].noiseModel.sigmaPerMeter = 0.01f;
+  noises[2].noiseModel.dropoutProbability = 0.1f;
+  noises[3].name = "corrupted";
+  noises[3].noiseModel = noises[1].noiseModel;
+  noises[3].faults = "bitflips";
+
+  const std::vector<size_t> CHUNK_SIZES{1, 5, 64, 256, 2048};
+  const uint32_t SCANS{50};
+  const std::vector<uint8_t> DESCRIPTOR{RPLidarDecoder::SYNC_BYTE0, RPLidarDecoder::SYNC_BYTE1, 0x5, 0x0, 0x0, 0x40, RPLidarDecoder::GOT_SCAN};
+
+  std::cout << "{\n"
+            << "  \"benchmark\": \"rplidar-decoder\",\n"
+            << "  \"label\": \"" << LABEL << "\",\n"
+            << "  \"architecture\": \"" << architecture() << "\",\n"
+            << "  \"compiler\": \"" << __VERSION__ << "\",\n"
+            << "  \"minTime\": " << MIN_TIME << ",\n"
+            << "  \"results\": [\n";
+
+  bool first{true};
+  for (const auto &mode : MODES) {
+    for (const auto &noise : noises) {
+      ScanSynthesizer synthesizer{ScanSynthesizer::defaultRoom(0, mode.scanFrequency)};
+      synthesizer.setNoiseModel(noise.noiseModel);
+      std::vector<uint8_t> nodes;
+      for (uint32_t i{0}; i < SCANS; i++) {
+        synthesizer.synthesize(i, mode.samplesPerScan, nodes);
+      }
+      if (!noise.faults.empty()) {
+        FaultInjector::Profile profile;
+        FaultInjector::parseProfile(noise.faults, profile);
+        FaultInjector faultInjector(profile, 1);
+        std::vector<uint8_t> corrupted;
+        faultInjector.setDelegate([&corrupted](const uint8_t *buffer, size_t size, int64_t){
+          corrupted.insert(corrupted.end(), buffer, buffer + size);
+        });
+        // Keep the first node intact as it completes the response descriptor.
+        corrupted.insert(corrupted.end(), nodes.begin(), nodes.begin() + 5);
+        faultInjector.inject(nodes.data() + 5, nodes.size() - 5, 0);
+        faultInjector.flush();
+        // Keep whole nodes only to loop over the stream.
+        corrupted.resize(corrupted.size() - corrupted.size() % 5);
+        nodes.swap(corrupted);
+      }
+
+      for (auto chunkSize : CHUNK_SIZES) {
+        printResult("decode", mode, noise, chunkSize, decodeStream(DESCRIPTOR, nodes, chunkSize, MIN_TIME, true), first);
+        first = false;
+      }
+
+      const size_t CHUNK_SIZE{CHUNK_SIZES.back()};
+      Result assembly{decodeStream(DESCRIPTOR, nodes, CHUNK_SIZE, MIN_TIME, false)};
+      // Without delegate, scans are counted from the start flags.
+      assembly.scans = assembly.iterations * SCANS;
+      printResult("assembly", mode, noise, CHUNK_SIZE, assembly, first);
+
+      std::vector<opendlv::proxy::PointCloudReading> scans;
+      {
+        RPLidarDecoder decoder;
+        decoder.setDelegates(nullptr, nullptr, [&scans](const opendlv::proxy::PointCloudReading &pc){
+          scans.push_back(pc);
+        });
+        std::vector<uint8_t> stream{DESCRIPTOR};
+        stream.insert(stream.end(), nodes.begin(), nodes.end());
+        stream.insert(stream.end(), nodes.begin(), nodes.begin() + 5);
+        decoder.decode(stream.data(), stream.size());
+      }
+      size_t bytesPerScan{0};
+      Result emission{emitScans(scans, MIN_TIME, bytesPerScan)};
+      emission.bytes = emission.scans * bytesPerScan;
+      printResult("emission", mode, noise, CHUNK_SIZE, emission, first);
+    }
+  }
+  std::cout << "\n  ]\n}" << std::endl;
+  return 0;
+}
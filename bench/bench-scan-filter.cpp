@@ -0,0 +1,162 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Benchmark of ScanFilter on synthetic scans decoded by RPLidarDecoder; the
+// budget per scan is 1 ms at up to 16k samples/s. Results are printed as
+// JSON to track them per commit and platform.
+
+#include "cluon-complete.hpp"
+
+#include "rplidar-decoder.hpp"
+#include "scan-filter.hpp"
+#include "scan-synthesizer.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace {
+struct ScanMode {
+  std::string name{};
+  float scanFrequency{0.0f};
+  uint32_t samplesPerScan{0};
+};
+
+struct Filter {
+  std::string name{};
+  ScanFilter::Config config{};
+};
+
+const char *architecture() noexcept {
+#if defined(__x86_64__)
+  return "x86_64";
+#elif defined(__aarch64__)
+  return "aarch64";
+#elif defined(__arm__)
+  return "arm";
+#else
+  return "unknown";
+#endif
+}
+
+// Distances of the scans as published by the decoder.
+std::vector<std::vector<float>> decodeScans(const ScanMode &mode, uint32_t numberOfScans) noexcept {
+  ScanSynthesizer synthesizer{ScanSynthesizer::defaultRoom(0, mode.scanFrequency)};
+  ScanSynthesizer::NoiseModel noiseModel;
+  noiseModel.sigma = 0.01f;
+  noiseModel.dropoutProbability = 0.01f;
+  synthesizer.setNoiseModel(noiseModel);
+  std::vector<uint8_t> nodes{RPLidarDecoder::SYNC_BYTE0, RPLidarDecoder::SYNC_BYTE1, 0x5, 0x0, 0x0, 0x40, RPLidarDecoder::GOT_SCAN};
+  for (uint32_t i{0}; i <= numberOfScans; i++) {
+    synthesizer.synthesize(i, mode.samplesPerScan, nodes);
+  }
+  nodes.insert(nodes.end(), nodes.begin() + 7, nodes.begin() + 12);
+
+  std::vector<std::vector<float>> scans;
+  RPLidarDecoder decoder;
+  decoder.setDelegates(nullptr, nullptr, [&scans](const opendlv::proxy::PointCloudReading &pc){
+    std::vector<float> distances(pc.distances().size() / sizeof(float));
+    std::memcpy(distances.data(), pc.distances().data(), distances.size() * sizeof(float));
+    scans.push_back(distances);
+  });
+  decoder.decode(nodes.data(), nodes.size());
+  return scans;
+}
+}
+
+int32_t main(int32_t argc, char **argv) {
+  auto commandlineArguments = cluon::getCommandlineArguments(argc, argv);
+  if (0 != commandlineArguments.count("help")) {
+    std::cerr << argv[0] << " benchmarks ScanFilter on synthetic scans and prints the results as JSON." << std::endl;
+    std::cerr << "Usage:   " << argv[0] << " [--min-time=<s>] [--label=<text>]" << std::endl;
+    std::cerr << "         --min-time: minimum duration per measurement in s (default: 0.25)" << std::endl;
+    std::cerr << "         --label:    free text added to the output, e.g., the commit (default: empty)" << std::endl;
+    std::cerr << "Example: " << argv[0] << " --min-time=1 --label=$(git rev-parse --short HEAD)" << std::endl;
+    return 1;
+  }
+  const double MIN_TIME{(commandlineArguments.count("min-time") != 0) ? std::stod(commandlineArguments["min-time"]) : 0.25};
+  const std::string LABEL{(commandlineArguments.count("label") != 0) ? commandlineArguments["label"] : ""};
+  const double BUDGET_PER_SCAN{1e-3};
+
+  const std::vector<ScanMode> MODES{
+    {"a1-standard", 5.5f, 360},
+    {"a2-express", 10.0f, 800},
+    {"a3-boost", 10.0f, 1600},
+    {"a3-boost-5hz", 5.0f, 3200},
+  };
+  const std::vector<Filter> FILTERS{
+    {"median3", {3, 0.0f}},
+    {"median5", {5, 0.0f}},
+    {"isolated", {0, 0.3f}},
+    {"median5+isolated", {5, 0.3f}},
+  };
+  const uint32_t SCANS{20};
+
+  std::cout << "{\n"
+            << "  \"benchmark\": \"scan-filter\",\n"
+            << "  \"label\": \"" << LABEL << "\",\n"
+            << "  \"architecture\": \"" << architecture() << "\",\n"
+            << "  \"compiler\": \"" << __VERSION__ << "\",\n"
+            << "  \"minTime\": " << MIN_TIME << ",\n"
+            << "  \"budgetPerScan\": " << BUDGET_PER_SCAN << ",\n"
+            << "  \"results\": [\n";
+
+  bool first{true};
+  for (const auto &mode : MODES) {
+    const std::vector<std::vector<float>> scans{decodeScans(mode, SCANS)};
+    for (const auto &filter : FILTERS) {
+      ScanFilter scanFilter(filter.config);
+      std::vector<float> distances;
+      uint64_t numberOfScans{0};
+      uint64_t samples{0};
+      uint64_t removed{0};
+      double seconds{0.0};
+      // Copying a scan into the working buffer is part of the measurement as
+      // the decoder does the same.
+      const auto start{std::chrono::steady_clock::now()};
+      do {
+        for (const auto &scan : scans) {
+          distances.assign(scan.begin(), scan.end());
+          removed += scanFilter.apply(distances.data(), static_cast<uint32_t>(distances.size()));
+          samples += distances.size();
+          numberOfScans++;
+        }
+        seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+      } while (seconds < MIN_TIME);
+
+      const double perScan{(0 < numberOfScans) ? seconds / static_cast<double>(numberOfScans) : 0.0};
+      std::cout << (first ? "" : ",\n")
+                << "    {\"name\": \"" << filter.name << "\""
+                << ", \"mode\": \"" << mode.name << "\""
+                << ", \"scanFrequency\": " << mode.scanFrequency
+                << ", \"samplesPerScan\": " << mode.samplesPerScan
+                << ", \"scans\": " << numberOfScans
+                << ", \"seconds\": " << seconds
+                << ", \"samplesPerSecond\": " << static_cast<double>(samples) / seconds
+                << ", \"nsPerScan\": " << perScan * 1e9
+                << ", \"removedPerScan\": " << static_cast<double>(removed) / static_cast<double>(numberOfScans)
+                << ", \"withinBudget\": " << ((perScan < BUDGET_PER_SCAN) ? "true" : "false")
+                << "}";
+      first = false;
+    }
+  }
+  std::cout << "\n  ]\n}" << std::endl;
+  return 0;
+}
@@ -0,0 +1,200 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Benchmark of ScanMatcher on scans ray-cast along a trajectory through the
+// default room and decoded by RPLidarDecoder; the budget per scan is one
+// scan period at 10 Hz. Results are printed as JSON to track them per
+// commit and platform, together with the error against the ground truth.
+
+#include "cluon-complete.hpp"
+
+#include "rplidar-decoder.hpp"
+#include "scan-matcher.hpp"
+#include "scan-synthesizer.hpp"
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace {
+constexpr const float PI{3.14159265f};
+
+struct ScanMode {
+  std::string name{};
+  float scanFrequency{0.0f};
+  uint32_t samplesPerScan{0};
+};
+
+struct Scan {
+  std::vector<float> angles{};
+  std::vector<float> distances{};
+  ScanMatcher::Pose truth{}; // Motion since the previous scan in its frame.
+};
+
+const char *architecture() noexcept {
+#if defined(__x86_64__)
+  return "x86_64";
+#elif defined(__aarch64__)
+  return "aarch64";
+#elif defined(__arm__)
+  return "arm";
+#else
+  return "unknown";
+#endif
+}
+
+// Driving on a circle of 1.5 m radius at 0.8 m/s.
+ScanMatcher::Pose poseAt(float t) noexcept {
+  const float RADIUS{1.5f};
+  const float phi{0.8f * t / RADIUS};
+  ScanMatcher::Pose p;
+  p.x = RADIUS * std::sin(phi);
+  p.y = RADIUS * (1.0f - std::cos(phi)) - 0.75f;
+  p.yaw = phi;
+  return p;
+}
+
+std::vector<Scan> decodeScans(const ScanMode &mode, uint32_t numberOfScans) noexcept {
+  ScanSynthesizer synthesizer{ScanSynthesizer::defaultRoom(0, mode.scanFrequency)};
+  ScanSynthesizer::NoiseModel noiseModel;
+  noiseModel.sigma = 0.01f;
+  noiseModel.dropoutProbability = 0.01f;
+  synthesizer.setNoiseModel(noiseModel);
+  std::vector<uint8_t> nodes{RPLidarDecoder::SYNC_BYTE0, RPLidarDecoder::SYNC_BYTE1, 0x5, 0x0, 0x0, 0x40, RPLidarDecoder::GOT_SCAN};
+  std::vector<ScanMatcher::Pose> poses;
+  for (uint32_t i{0}; i <= numberOfScans; i++) {
+    poses.push_back(poseAt(static_cast<float>(i) / mode.scanFrequency));
+    synthesizer.setSensorPose(poses.back().x, poses.back().y, poses.back().yaw);
+    synthesizer.synthesize(i, mode.samplesPerScan, nodes);
+  }
+  nodes.insert(nodes.end(), nodes.begin() + 7, nodes.begin() + 12);
+
+  std::vector<Scan> scans;
+  RPLidarDecoder decoder;
+  decoder.setDelegates(nullptr, nullptr, [&scans, &poses](const opendlv::proxy::PointCloudReading &pc){
+    Scan scan;
+    scan.angles.resize(pc.azimuthAngles().size() / sizeof(float));
+    scan.distances.resize(pc.distances().size() / sizeof(float));
+    std::memcpy(scan.angles.data(), pc.azimuthAngles().data(), scan.angles.size() * sizeof(float));
+    std::memcpy(scan.distances.data(), pc.distances().data(), scan.distances.size() * sizeof(float));
+    const size_t i{scans.size()};
+    if (0 < i) {
+      const float c{std::cos(poses[i - 1].yaw)};
+      const float s{std::sin(poses[i - 1].yaw)};
+      const float dx{poses[i].x - poses[i - 1].x};
+      const float dy{poses[i].y - poses[i - 1].y};
+      scan.truth.x = c * dx + s * dy;
+      scan.truth.y = -s * dx + c * dy;
+      scan.truth.yaw = poses[i].yaw - poses[i - 1].yaw;
+    }
+    scans.push_back(scan);
+  });
+  decoder.decode(nodes.data(), nodes.size());
+  return scans;
+}
+}
+
+int32_t main(int32_t argc, char **argv) {
+  auto commandlineArguments = cluon::getCommandlineArguments(argc, argv);
+  if (0 != commandlineArguments.count("help")) {
+    std::cerr << argv[0] << " benchmarks ScanMatcher on synthetic scans and prints the results as JSON." << std::endl;
+    std::cerr << "Usage:   " << argv[0] << " [--min-time=<s>] [--label=<text>]" << std::endl;
+    std::cerr << "         --min-time: minimum duration per measurement in s (default: 0.5)" << std::endl;
+    std::cerr << "         --label:    free text added to the output, e.g., the commit (default: empty)" << std::endl;
+    std::cerr << "Example: " << argv[0] << " --min-time=2 --label=$(git rev-parse --short HEAD)" << std::endl;
+    return 1;
+  }
+  const double MIN_TIME{(commandlineArguments.count("min-time") != 0) ? std::stod(commandlineArguments["min-time"]) : 0.5};
+  const std::string LABEL{(commandlineArguments.count("label") != 0) ? commandlineArguments["label"] : ""};
+  const double BUDGET_PER_SCAN{0.1};
+
+  const std::vector<ScanMode> MODES{
+    {"a1-standard", 5.5f, 360},
+    {"a2-express", 10.0f, 800},
+    {"a3-boost", 10.0f, 1600},
+    {"a3-boost-5hz", 5.0f, 3200},
+  };
+  const uint32_t SCANS{40};
+
+  std::cout << "{\n"
+            << "  \"benchmark\": \"scan-matcher\",\n"
+            << "  \"label\": \"" << LABEL << "\",\n"
+            << "  \"architecture\": \"" << architecture() << "\",\n"
+            << "  \"compiler\": \"" << __VERSION__ << "\",\n"
+            << "  \"minTime\": " << MIN_TIME << ",\n"
+            << "  \"budgetPerScan\": " << BUDGET_PER_SCAN << ",\n"
+            << "  \"results\": [\n";
+
+  bool first{true};
+  for (const auto &mode : MODES) {
+    const std::vector<Scan> scans{decodeScans(mode, SCANS)};
+    ScanMatcher matcher(ScanMatcher::Config{});
+    ScanMatcher::Result result;
+    uint64_t matches{0};
+    uint64_t converged{0};
+    uint64_t iterations{0};
+    double translationError{0.0};
+    double rotationError{0.0};
+    double seconds{0.0};
+    double maxPerScan{0.0};
+    const auto start{std::chrono::steady_clock::now()};
+    do {
+      matcher.reset();
+      for (const auto &scan : scans) {
+        const auto before{std::chrono::steady_clock::now()};
+        const bool matched{matcher.match(scan.angles.data(), scan.distances.data(), static_cast<uint32_t>(scan.distances.size()), result)};
+        const double duration{std::chrono::duration<double>(std::chrono::steady_clock::now() - before).count()};
+        maxPerScan = (duration > maxPerScan) ? duration : maxPerScan;
+        if (matched) {
+          matches++;
+          iterations += result.iterations;
+          if (result.converged) {
+            converged++;
+            translationError += std::hypot(result.delta.x - scan.truth.x, result.delta.y - scan.truth.y);
+            rotationError += std::fabs(result.delta.yaw - scan.truth.yaw);
+          }
+        }
+      }
+      seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    } while (seconds < MIN_TIME);
+
+    const double perScan{(0 < matches) ? seconds / static_cast<double>(matches) : 0.0};
+    const double convergedScans{(0 < converged) ? static_cast<double>(converged) : 1.0};
+    std::cout << (first ? "" : ",\n")
+              << "    {\"name\": \"point-to-line\""
+              << ", \"mode\": \"" << mode.name << "\""
+              << ", \"scanFrequency\": " << mode.scanFrequency
+              << ", \"samplesPerScan\": " << mode.samplesPerScan
+              << ", \"matches\": " << matches
+              << ", \"converged\": " << converged
+              << ", \"iterationsPerMatch\": " << static_cast<double>(iterations) / static_cast<double>((0 < matches) ? matches : 1)
+              << ", \"seconds\": " << seconds
+              << ", \"nsPerScan\": " << perScan * 1e9
+              << ", \"maxNsPerScan\": " << maxPerScan * 1e9
+              << ", \"translationErrorMm\": " << translationError / convergedScans * 1000.0
+              << ", \"rotationErrorDeg\": " << rotationError / convergedScans * 180.0 / PI
+              << ", \"withinBudget\": " << ((maxPerScan < BUDGET_PER_SCAN) ? "true" : "false")
+              << "}";
+    first = false;
+  }
+  std::cout << "\n  ]\n}" << std::endl;
+  return 0;
+}
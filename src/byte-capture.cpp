@@ -0,0 +1,238 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "byte-capture.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <cstring>
+
+constexpr const char *ByteCapture::MAGIC;
+constexpr const uint32_t ByteCapture::VERSION;
+constexpr const size_t ByteCapture::HEADER_SIZE;
+constexpr const size_t ByteCapture::RECORD_HEADER_SIZE;
+
+ByteCapture::ByteCapture(const std::string &filename, size_t extentSize) noexcept
+  : m_extentSize{(0 == extentSize % static_cast<size_t>(::sysconf(_SC_PAGESIZE))) ? extentSize : 16 * 1024 * 1024} {
+  m_fd = ::open(filename.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (-1 == m_fd) {
+    return;
+  }
+
+  m_current = mapExtent(0);
+  if (nullptr == m_current) {
+    ::close(m_fd);
+    m_fd = -1;
+    return;
+  }
+
+  uint8_t header[HEADER_SIZE]{};
+  std::memcpy(header, MAGIC, 8);
+  std::memcpy(header + 8, &VERSION, sizeof(VERSION));
+  write(header, sizeof(header));
+
+  m_running = true;
+  m_extentsThread.reset(new std::thread(&ByteCapture::prepareExtents, this));
+}
+
+ByteCapture::~ByteCapture() {
+  if (m_extentsThread) {
+    {
+      std::lock_guard<std::mutex> lck(m_extentsMutex);
+      m_running = false;
+    }
+    m_extentsCondition.notify_all();
+    m_extentsThread->join();
+  }
+  if (nullptr != m_current) {
+    ::munmap(m_current, m_extentSize);
+  }
+  if (nullptr != m_next) {
+    ::munmap(m_next, m_extentSize);
+  }
+  if (nullptr != m_retired) {
+    ::munmap(m_retired, m_extentSize);
+  }
+  if (-1 != m_fd) {
+    // Cut off the unused, preallocated part of the last extents.
+    if (0 != ::ftruncate(m_fd, static_cast<off_t>(m_bytesWritten.load()))) {}
+    ::close(m_fd);
+  }
+}
+
+bool ByteCapture::isOpen() const noexcept {
+  return (-1 != m_fd);
+}
+
+uint64_t ByteCapture::bytesWritten() const noexcept {
+  return m_bytesWritten.load(std::memory_order_relaxed);
+}
+
+uint64_t ByteCapture::stalls() const noexcept {
+  return m_stalls.load(std::memory_order_relaxed);
+}
+
+void ByteCapture::append(const uint8_t *buffer, const size_t size, const int64_t timeStampInNanoseconds) noexcept {
+  if ( !isOpen() || m_full || (nullptr == buffer) || (0 == size) ) {
+    return;
+  }
+  const uint32_t length{static_cast<uint32_t>(size)};
+  uint8_t recordHeader[RECORD_HEADER_SIZE];
+  std::memcpy(recordHeader, &timeStampInNanoseconds, sizeof(int64_t));
+  std::memcpy(recordHeader + sizeof(int64_t), &length, sizeof(uint32_t));
+  const uint64_t recordStart{m_bytesWritten.load(std::memory_order_relaxed)};
+  if (!write(recordHeader, sizeof(recordHeader)) || !write(buffer, size)) {
+    // Out of space: the partial record is cut off when closing the file
+    // and no further records are appended.
+    m_bytesWritten.store(recordStart, std::memory_order_relaxed);
+    m_full = true;
+  }
+}
+
+bool ByteCapture::write(const uint8_t *buffer, size_t size) noexcept {
+  while (0 < size) {
+    if ( (m_positionInExtent == m_extentSize) && !switchToNextExtent() ) {
+      return false;
+    }
+    const size_t available{m_extentSize - m_positionInExtent};
+    const size_t toCopy{(size < available) ? size : available};
+    std::memcpy(m_current + m_positionInExtent, buffer, toCopy);
+    m_positionInExtent += toCopy;
+    buffer += toCopy;
+    size -= toCopy;
+    m_bytesWritten.fetch_add(toCopy, std::memory_order_relaxed);
+  }
+  return true;
+}
+
+bool ByteCapture::switchToNextExtent() noexcept {
+  std::unique_lock<std::mutex> lck(m_extentsMutex);
+  if (nullptr == m_next) {
+    // The helper thread has not caught up; this should only happen on very slow storage.
+    m_stalls.fetch_add(1, std::memory_order_relaxed);
+    m_extentsCondition.wait(lck, [this](){ return (nullptr != m_next) || !m_running; });
+    if (nullptr == m_next) {
+      return false;
+    }
+  }
+  m_retired = m_current;
+  m_current = m_next;
+  m_next = nullptr;
+  m_currentIndex++;
+  m_positionInExtent = 0;
+  lck.unlock();
+  m_extentsCondition.notify_all();
+  return true;
+}
+
+uint8_t *ByteCapture::mapExtent(uint64_t index) noexcept {
+  const off_t offset{static_cast<off_t>(index * m_extentSize)};
+  if (0 != ::posix_fallocate(m_fd, offset, static_cast<off_t>(m_extentSize))) {
+    return nullptr;
+  }
+  void *extent = ::mmap(nullptr, m_extentSize, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, offset);
+  return (MAP_FAILED == extent) ? nullptr : static_cast<uint8_t*>(extent);
+}
+
+void ByteCapture::prepareExtents() noexcept {
+  std::unique_lock<std::mutex> lck(m_extentsMutex);
+  while (m_running) {
+    if (nullptr != m_retired) {
+      uint8_t *retired{m_retired};
+      m_retired = nullptr;
+      lck.unlock();
+      ::munmap(retired, m_extentSize);
+      lck.lock();
+    }
+    if (nullptr == m_next) {
+      const uint64_t index{m_currentIndex + 1};
+      lck.unlock();
+      uint8_t *next = mapExtent(index);
+      lck.lock();
+      m_next = next;
+      if (nullptr == m_next) {
+        // Out of space; let a waiting writer give up.
+        m_running = false;
+      }
+      m_extentsCondition.notify_all();
+      continue;
+    }
+    m_extentsCondition.wait(lck, [this](){ return !m_running || (nullptr == m_next) || (nullptr != m_retired); });
+  }
+}
+
+ByteCaptureReader::ByteCaptureReader(const std::string &filename) noexcept {
+  int fd = ::open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+  if (-1 == fd) {
+    return;
+  }
+  const off_t size{::lseek(fd, 0, SEEK_END)};
+  if (static_cast<off_t>(ByteCapture::HEADER_SIZE) <= size) {
+    void *data = ::mmap(nullptr, static_cast<size_t>(size), PROT_READ, MAP_PRIVATE, fd, 0);
+    if (MAP_FAILED != data) {
+      ::madvise(data, static_cast<size_t>(size), MADV_SEQUENTIAL);
+      m_data = static_cast<const uint8_t*>(data);
+      m_size = static_cast<uint64_t>(size);
+      if (0 != std::memcmp(m_data, ByteCapture::MAGIC, 8)) {
+        ::munmap(data, m_size);
+        m_data = nullptr;
+        m_size = 0;
+      }
+    }
+  }
+  ::close(fd);
+  rewind();
+}
+
+ByteCaptureReader::~ByteCaptureReader() {
+  if (nullptr != m_data) {
+    ::munmap(const_cast<uint8_t*>(m_data), m_size);
+  }
+}
+
+bool ByteCaptureReader::isOpen() const noexcept {
+  return (nullptr != m_data);
+}
+
+uint64_t ByteCaptureReader::size() const noexcept {
+  return m_size;
+}
+
+void ByteCaptureReader::rewind() noexcept {
+  m_position = ByteCapture::HEADER_SIZE;
+}
+
+bool ByteCaptureReader::next(int64_t &timeStampInNanoseconds, const uint8_t *&data, size_t &size) noexcept {
+  if ( !isOpen() || (m_position + ByteCapture::RECORD_HEADER_SIZE > m_size) ) {
+    return false;
+  }
+  uint32_t length{0};
+  std::memcpy(&timeStampInNanoseconds, m_data + m_position, sizeof(int64_t));
+  std::memcpy(&length, m_data + m_position + sizeof(int64_t), sizeof(uint32_t));
+  // After a crash, the file is not cut to the bytes written and ends in the
+  // preallocated space of the last extent, which is zeros; as no empty
+  // records are written, the first record of length 0 marks the end.
+  if ( (0 == length) || (m_position + ByteCapture::RECORD_HEADER_SIZE + length > m_size) ) {
+    return false;
+  }
+  data = m_data + m_position + ByteCapture::RECORD_HEADER_SIZE;
+  size = length;
+  m_position += ByteCapture::RECORD_HEADER_SIZE + length;
+  return true;
+}
@@ -0,0 +1,127 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BYTE_CAPTURE
+#define BYTE_CAPTURE
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+/**
+ * ByteCapture appends chunks of raw bytes together with a monotonic time
+ * stamp to a memory-mapped file. The file is grown in large extents that are
+ * preallocated and mapped ahead of time by a helper thread so that append()
+ * boils down to a memcpy on the caller's thread.
+ *
+ * File layout: 16 bytes header ("RPLDCAP1", uint32 version, uint32 reserved)
+ * followed by records of int64 time stamp in ns, uint32 length, and payload
+ * in host byte order.
+ */
+class ByteCapture {
+ public:
+  static constexpr const char *MAGIC{"RPLDCAP1"};
+  static constexpr const uint32_t VERSION{1};
+  static constexpr const size_t HEADER_SIZE{16};
+  static constexpr const size_t RECORD_HEADER_SIZE{sizeof(int64_t) + sizeof(uint32_t)};
+
+ private:
+  ByteCapture(const ByteCapture &) = delete;
+  ByteCapture(ByteCapture &&)      = delete;
+  ByteCapture &operator=(const ByteCapture &) = delete;
+  ByteCapture &operator=(ByteCapture &&) = delete;
+
+ public:
+  ByteCapture(const std::string &filename, size_t extentSize = 16 * 1024 * 1024) noexcept;
+  ~ByteCapture();
+
+ public:
+  bool isOpen() const noexcept;
+  /**
+   * Appends one record; once the disk is full, the record that did not fit
+   * and all following ones are left out, so the file ends with a complete one.
+   */
+  void append(const uint8_t *buffer, const size_t size, const int64_t timeStampInNanoseconds) noexcept;
+  uint64_t bytesWritten() const noexcept;
+  uint64_t stalls() const noexcept;
+
+ private:
+  /**
+   * @return false if the next extent could not be allocated.
+   */
+  bool write(const uint8_t *buffer, size_t size) noexcept;
+  bool switchToNextExtent() noexcept;
+  uint8_t *mapExtent(uint64_t index) noexcept;
+  void prepareExtents() noexcept;
+
+ private:
+  int m_fd{-1};
+  size_t m_extentSize{0};
+
+  uint8_t *m_current{nullptr};
+  uint64_t m_currentIndex{0};
+  size_t m_positionInExtent{0};
+  std::atomic<uint64_t> m_bytesWritten{0};
+  std::atomic<uint64_t> m_stalls{0};
+  bool m_full{false};
+
+  // Shared with the helper thread that maps the next extent and retires the previous one.
+  std::mutex m_extentsMutex{};
+  std::condition_variable m_extentsCondition{};
+  uint8_t *m_next{nullptr};
+  uint8_t *m_retired{nullptr};
+  bool m_running{false};
+  std::unique_ptr<std::thread> m_extentsThread{nullptr};
+};
+
+/**
+ * ByteCaptureReader iterates over the records of a file written by ByteCapture.
+ */
+class ByteCaptureReader {
+ private:
+  ByteCaptureReader(const ByteCaptureReader &) = delete;
+  ByteCaptureReader(ByteCaptureReader &&)      = delete;
+  ByteCaptureReader &operator=(const ByteCaptureReader &) = delete;
+  ByteCaptureReader &operator=(ByteCaptureReader &&) = delete;
+
+ public:
+  ByteCaptureReader(const std::string &filename) noexcept;
+  ~ByteCaptureReader();
+
+ public:
+  bool isOpen() const noexcept;
+  /**
+   * Stops at the end of the file or at the zeros that a crashed capture
+   * left in its preallocated space.
+   * @return true if another complete record was available; data points into
+   *         the mapped file and stays valid for the lifetime of this reader.
+   */
+  bool next(int64_t &timeStampInNanoseconds, const uint8_t *&data, size_t &size) noexcept;
+  void rewind() noexcept;
+  uint64_t size() const noexcept;
+
+ private:
+  const uint8_t *m_data{nullptr};
+  uint64_t m_size{0};
+  uint64_t m_position{0};
+};
+
+#endif
@@ -0,0 +1,74 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "decode-buffer.hpp"
+
+#include <cstring>
+
+constexpr const size_t DecodeBuffer::SIZE;
+
+DecodeBuffer::DecodeBuffer(Overflow overflow) noexcept
+  : m_overflow{overflow} {
+}
+
+uint8_t *DecodeBuffer::tail() noexcept {
+  return m_data.data() + m_size;
+}
+
+size_t DecodeBuffer::space() const noexcept {
+  return SIZE - m_size;
+}
+
+bool DecodeBuffer::decode(RPLidarDecoder &decoder, size_t bytesRead) noexcept {
+  m_size += (bytesRead < space()) ? bytesRead : space();
+  const size_t consumed{decoder.decode(m_data.data(), m_size)};
+  if ( (0 < consumed) && (consumed < m_size) ) {
+    std::memmove(m_data.data(), m_data.data() + consumed, m_size - consumed);
+  }
+  m_size -= (consumed < m_size) ? consumed : m_size;
+  if (m_size < SIZE) {
+    return true;
+  }
+  // The decoder does not make progress at all.
+  if (DISCARD_ON_OVERFLOW == m_overflow) {
+    m_discarded += m_size;
+    m_size = 0;
+    return true;
+  }
+  return false;
+}
+
+bool DecodeBuffer::feed(RPLidarDecoder &decoder, const uint8_t *chunk, size_t size) noexcept {
+  while (0 < size) {
+    const size_t toCopy{(size < space()) ? size : space()};
+    std::memcpy(tail(), chunk, toCopy);
+    chunk += toCopy;
+    size -= toCopy;
+    if (!decode(decoder, toCopy)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void DecodeBuffer::clear() noexcept {
+  m_size = 0;
+}
+
+uint64_t DecodeBuffer::discarded() const noexcept {
+  return m_discarded;
+}
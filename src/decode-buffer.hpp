@@ -0,0 +1,82 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef DECODE_BUFFER
+#define DECODE_BUFFER
+
+#include "rplidar-decoder.hpp"
+
+#include <array>
+#include <cstdint>
+
+/**
+ * DecodeBuffer keeps the bytes read from an RPLidar until the decoder has
+ * consumed them; the bytes of an incomplete response or node are moved to
+ * the front and completed by the next read. RPLidar reads into it, while the
+ * replay and the benchmarks feed recorded or synthetic chunks through it.
+ */
+class DecodeBuffer {
+ public:
+  static constexpr const size_t SIZE{2048};
+
+  enum Overflow : uint8_t {
+    STOP_ON_OVERFLOW    = 0, // decode() fails; RPLidar stops reading and its watchdog reconnects.
+    DISCARD_ON_OVERFLOW = 1, // The buffered bytes are dropped like after a reconnect and decoding goes on.
+  };
+
+ private:
+  DecodeBuffer(const DecodeBuffer &) = delete;
+  DecodeBuffer(DecodeBuffer &&)      = delete;
+  DecodeBuffer &operator=(const DecodeBuffer &) = delete;
+  DecodeBuffer &operator=(DecodeBuffer &&) = delete;
+
+ public:
+  explicit DecodeBuffer(Overflow overflow = STOP_ON_OVERFLOW) noexcept;
+  ~DecodeBuffer() = default;
+
+ public:
+  /**
+   * @return where to read up to space() bytes to before calling decode().
+   */
+  uint8_t *tail() noexcept;
+  size_t space() const noexcept;
+  /**
+   * Hands the buffered bytes together with the bytesRead just read to tail()
+   * to the decoder and keeps the bytes that it did not consume.
+   * @return false if the decoder left the buffer full with STOP_ON_OVERFLOW.
+   */
+  bool decode(RPLidarDecoder &decoder, size_t bytesRead) noexcept;
+  /**
+   * Copies the chunk to the buffer in parts of at most the free space and
+   * decodes every part, like successive reads from the device.
+   * @return false on overflow with STOP_ON_OVERFLOW; the rest of the chunk is left out.
+   */
+  bool feed(RPLidarDecoder &decoder, const uint8_t *chunk, size_t size) noexcept;
+  void clear() noexcept;
+  /**
+   * @return bytes dropped with DISCARD_ON_OVERFLOW.
+   */
+  uint64_t discarded() const noexcept;
+
+ private:
+  const Overflow m_overflow;
+  std::array<uint8_t, SIZE> m_data{};
+  size_t m_size{0};
+  uint64_t m_discarded{0};
+};
+
+#endif
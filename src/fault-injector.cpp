@@ -0,0 +1,242 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "fault-injector.hpp"
+
+#include <chrono>
+#include <sstream>
+#include <thread>
+
+FaultInjector::FaultInjector(const Profile &profile, uint32_t seed, bool realTime) noexcept
+  : m_profile{profile}
+  , m_generator{seed}
+  , m_realTime{realTime} {
+}
+
+std::vector<FaultInjector::Profile> FaultInjector::predefinedProfiles() noexcept {
+  std::vector<Profile> profiles;
+  Profile none;
+  profiles.push_back(none);
+
+  Profile drops;
+  drops.name = "drops";
+  drops.dropProbability = 0.0005f;
+  profiles.push_back(drops);
+
+  Profile bitflips;
+  bitflips.name = "bitflips";
+  bitflips.bitFlipProbability = 0.0005f;
+  profiles.push_back(bitflips);
+
+  Profile duplicates;
+  duplicates.name = "duplicates";
+  duplicates.duplicateProbability = 0.01f;
+  profiles.push_back(duplicates);
+
+  Profile stalls;
+  stalls.name = "stalls";
+  stalls.stallProbability = 0.005f;
+  stalls.stallDuration = 100;
+  profiles.push_back(stalls);
+
+  Profile bursts;
+  bursts.name = "bursts";
+  bursts.burstProbability = 0.02f;
+  bursts.burstLength = 16;
+  profiles.push_back(bursts);
+
+  Profile usb;
+  usb.name = "usb";
+  usb.dropProbability = 0.0001f;
+  usb.bitFlipProbability = 0.00005f;
+  usb.duplicateProbability = 0.002f;
+  usb.stallProbability = 0.001f;
+  usb.burstProbability = 0.01f;
+  profiles.push_back(usb);
+  return profiles;
+}
+
+bool FaultInjector::parseProfile(const std::string &description, Profile &profile) noexcept {
+  for (const auto &p : predefinedProfiles()) {
+    if (p.name == description) {
+      profile = p;
+      return true;
+    }
+  }
+
+  Profile parsed;
+  parsed.name = description;
+  std::stringstream sstr(description);
+  std::string entry;
+  try {
+    while (std::getline(sstr, entry, ',')) {
+      const size_t equal{entry.find('=')};
+      if (std::string::npos == equal) {
+        return false;
+      }
+      const std::string key{entry.substr(0, equal)};
+      std::string value{entry.substr(equal + 1)};
+      std::string parameter;
+      const size_t colon{value.find(':')};
+      if (std::string::npos != colon) {
+        parameter = value.substr(colon + 1);
+        value = value.substr(0, colon);
+      }
+
+      if ("drop" == key) {
+        parsed.dropProbability = std::stof(value);
+      }
+      else if ("flip" == key) {
+        parsed.bitFlipProbability = std::stof(value);
+      }
+      else if ("dup" == key) {
+        parsed.duplicateProbability = std::stof(value);
+      }
+      else if ("stall" == key) {
+        parsed.stallProbability = std::stof(value);
+        parsed.stallDuration = parameter.empty() ? parsed.stallDuration : static_cast<uint32_t>(std::stoul(parameter));
+      }
+      else if ("burst" == key) {
+        parsed.burstProbability = std::stof(value);
+        parsed.burstLength = parameter.empty() ? parsed.burstLength : static_cast<uint32_t>(std::stoul(parameter));
+      }
+      else {
+        return false;
+      }
+    }
+  }
+  catch (...) {
+    return false;
+  }
+  profile = parsed;
+  return true;
+}
+
+void FaultInjector::setDelegate(Delegate delegate) noexcept {
+  m_delegate = delegate;
+}
+
+uint64_t FaultInjector::bytesDropped() const noexcept {
+  return m_bytesDropped;
+}
+
+uint64_t FaultInjector::bitsFlipped() const noexcept {
+  return m_bitsFlipped;
+}
+
+uint64_t FaultInjector::chunksDuplicated() const noexcept {
+  return m_chunksDuplicated;
+}
+
+uint64_t FaultInjector::stalls() const noexcept {
+  return m_stalls;
+}
+
+uint64_t FaultInjector::bursts() const noexcept {
+  return m_bursts;
+}
+
+int64_t FaultInjector::lastFault() const noexcept {
+  return m_lastFault;
+}
+
+bool FaultInjector::chance(float probability) noexcept {
+  return (0.0f < probability) && (static_cast<float>(m_generator()) / 4294967296.0f < probability);
+}
+
+void FaultInjector::deliver(const uint8_t *buffer, size_t size, int64_t timeStampInNanoseconds) noexcept {
+  if ( (nullptr != m_delegate) && (0 < size) ) {
+    m_delegate(buffer, size, timeStampInNanoseconds);
+  }
+}
+
+void FaultInjector::flush() noexcept {
+  if (!m_burst.empty()) {
+    deliver(m_burst.data(), m_burst.size(), (m_stalledUntil > m_lastTimeStamp) ? m_stalledUntil : m_lastTimeStamp);
+    m_burst.clear();
+  }
+  m_chunksInBurst = 0;
+  m_stalledUntil = 0;
+}
+
+void FaultInjector::inject(const uint8_t *buffer, size_t size, int64_t timeStampInNanoseconds) noexcept {
+  m_lastTimeStamp = timeStampInNanoseconds;
+  m_chunk.clear();
+  for (size_t i{0}; i < size; i++) {
+    if (chance(m_profile.dropProbability)) {
+      m_bytesDropped++;
+      m_lastFault = timeStampInNanoseconds;
+      continue;
+    }
+    uint8_t byte{buffer[i]};
+    if (chance(m_profile.bitFlipProbability)) {
+      byte = static_cast<uint8_t>(byte ^ (1 << (m_generator() % 8)));
+      m_bitsFlipped++;
+      m_lastFault = timeStampInNanoseconds;
+    }
+    m_chunk.push_back(byte);
+  }
+
+  // During a stall (virtual time only), everything is held back until the
+  // stall is over and then delivered at once.
+  if (0 < m_stalledUntil) {
+    if (timeStampInNanoseconds < m_stalledUntil) {
+      m_burst.insert(m_burst.end(), m_chunk.begin(), m_chunk.end());
+      return;
+    }
+    deliver(m_burst.data(), m_burst.size(), m_stalledUntil);
+    m_burst.clear();
+    m_stalledUntil = 0;
+  }
+
+  if (0 < m_chunksInBurst) {
+    m_burst.insert(m_burst.end(), m_chunk.begin(), m_chunk.end());
+    if (++m_chunksInBurst >= m_profile.burstLength) {
+      deliver(m_burst.data(), m_burst.size(), timeStampInNanoseconds);
+      m_burst.clear();
+      m_chunksInBurst = 0;
+    }
+    return;
+  }
+
+  if (chance(m_profile.stallProbability)) {
+    m_stalls++;
+    m_lastFault = timeStampInNanoseconds;
+    if (m_realTime) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(m_profile.stallDuration));
+    }
+    else {
+      m_stalledUntil = timeStampInNanoseconds + static_cast<int64_t>(m_profile.stallDuration) * 1000 * 1000;
+      m_burst.insert(m_burst.end(), m_chunk.begin(), m_chunk.end());
+      return;
+    }
+  }
+  else if (chance(m_profile.burstProbability)) {
+    m_bursts++;
+    m_lastFault = timeStampInNanoseconds;
+    m_chunksInBurst = 1;
+    m_burst.insert(m_burst.end(), m_chunk.begin(), m_chunk.end());
+    return;
+  }
+
+  deliver(m_chunk.data(), m_chunk.size(), timeStampInNanoseconds);
+  if (chance(m_profile.duplicateProbability)) {
+    m_chunksDuplicated++;
+    m_lastFault = timeStampInNanoseconds;
+    deliver(m_chunk.data(), m_chunk.size(), timeStampInNanoseconds);
+  }
+}
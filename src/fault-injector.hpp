@@ -0,0 +1,111 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef FAULT_INJECTOR
+#define FAULT_INJECTOR
+
+#include <cstdint>
+#include <functional>
+#include <random>
+#include <string>
+#include <vector>
+
+/**
+ * FaultInjector sits between a byte source (emulator, replay) and the
+ * consumer (pty, RPLidarDecoder::decode) and reproduces typical USB-serial
+ * hiccups: dropped bytes, bit flips, duplicated chunks, stalls, and bursts
+ * of held back chunks delivered at once.
+ *
+ * Time stamps are passed through so that stalls can be applied to a virtual
+ * clock for offline runs; in real-time mode, stalls block the caller instead.
+ */
+class FaultInjector {
+ public:
+  struct Profile {
+    std::string name{"none"};
+    float dropProbability{0.0f};       // Per byte.
+    float bitFlipProbability{0.0f};    // Per byte.
+    float duplicateProbability{0.0f};  // Per chunk.
+    float stallProbability{0.0f};      // Per chunk.
+    uint32_t stallDuration{50};        // In ms.
+    float burstProbability{0.0f};      // Per chunk.
+    uint32_t burstLength{8};           // Chunks held back and delivered at once.
+  };
+
+  using Delegate = std::function<void(const uint8_t *buffer, size_t size, int64_t timeStampInNanoseconds)>;
+
+ private:
+  FaultInjector(const FaultInjector &) = delete;
+  FaultInjector(FaultInjector &&)      = delete;
+  FaultInjector &operator=(const FaultInjector &) = delete;
+  FaultInjector &operator=(FaultInjector &&) = delete;
+
+ public:
+  FaultInjector(const Profile &profile, uint32_t seed = 0, bool realTime = false) noexcept;
+  ~FaultInjector() = default;
+
+ public:
+  /**
+   * Parses profiles like "drop=0.001,flip=0.0001,dup=0.01,stall=0.01:50,burst=0.05:8"
+   * or one of the predefined profiles by name.
+   * @return true if the profile could be parsed.
+   */
+  static bool parseProfile(const std::string &description, Profile &profile) noexcept;
+  static std::vector<Profile> predefinedProfiles() noexcept;
+
+  void setDelegate(Delegate delegate) noexcept;
+  void inject(const uint8_t *buffer, size_t size, int64_t timeStampInNanoseconds) noexcept;
+  /**
+   * Delivers chunks that are still held back for a burst.
+   */
+  void flush() noexcept;
+
+  uint64_t bytesDropped() const noexcept;
+  uint64_t bitsFlipped() const noexcept;
+  uint64_t chunksDuplicated() const noexcept;
+  uint64_t stalls() const noexcept;
+  uint64_t bursts() const noexcept;
+  /**
+   * @return time stamp of the latest injected fault; 0 if none so far.
+   */
+  int64_t lastFault() const noexcept;
+
+ private:
+  bool chance(float probability) noexcept;
+  void deliver(const uint8_t *buffer, size_t size, int64_t timeStampInNanoseconds) noexcept;
+
+ private:
+  Profile m_profile;
+  std::mt19937 m_generator;
+  bool m_realTime;
+  Delegate m_delegate{nullptr};
+
+  std::vector<uint8_t> m_chunk{};
+  std::vector<uint8_t> m_burst{};
+  uint32_t m_chunksInBurst{0};
+  int64_t m_stalledUntil{0};
+  int64_t m_lastTimeStamp{0};
+
+  uint64_t m_bytesDropped{0};
+  uint64_t m_bitsFlipped{0};
+  uint64_t m_chunksDuplicated{0};
+  uint64_t m_stalls{0};
+  uint64_t m_bursts{0};
+  int64_t m_lastFault{0};
+};
+
+#endif
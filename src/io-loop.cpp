@@ -0,0 +1,91 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "io-loop.hpp"
+
+#include <sys/epoll.h>
+#include <unistd.h>
+
+IoLoop::IoLoop() noexcept {
+  m_epoll = ::epoll_create1(EPOLL_CLOEXEC);
+  if (-1 != m_epoll) {
+    m_running = true;
+    m_thread.reset(new std::thread(&IoLoop::run, this));
+  }
+}
+
+IoLoop::~IoLoop() {
+  m_running = false;
+  if (m_thread) {
+    m_thread->join();
+  }
+  if (-1 != m_epoll) {
+    ::close(m_epoll);
+  }
+}
+
+bool IoLoop::isRunning() const noexcept {
+  return m_running;
+}
+
+bool IoLoop::add(int fd, ReadableDelegate delegate) noexcept {
+  if ( (-1 == m_epoll) || (0 > fd) || (nullptr == delegate) ) {
+    return false;
+  }
+  std::lock_guard<std::mutex> lck(m_delegatesMutex);
+  struct epoll_event event{};
+  event.events = EPOLLIN;
+  event.data.fd = fd;
+  if (0 != ::epoll_ctl(m_epoll, EPOLL_CTL_ADD, fd, &event)) {
+    return false;
+  }
+  m_delegates[fd] = delegate;
+  return true;
+}
+
+void IoLoop::remove(int fd) noexcept {
+  std::lock_guard<std::mutex> lck(m_delegatesMutex);
+  if (0 < m_delegates.erase(fd)) {
+    ::epoll_ctl(m_epoll, EPOLL_CTL_DEL, fd, nullptr);
+  }
+}
+
+size_t IoLoop::size() const noexcept {
+  std::lock_guard<std::mutex> lck(m_delegatesMutex);
+  return m_delegates.size();
+}
+
+void IoLoop::run() noexcept {
+  constexpr const int MAX_EVENTS{16};
+  // Wake up regularly to notice the end of the loop.
+  constexpr const int TIMEOUT{100};
+  struct epoll_event events[MAX_EVENTS];
+  while (m_running) {
+    const int numberOfEvents = ::epoll_wait(m_epoll, events, MAX_EVENTS, TIMEOUT);
+    for (int i{0}; i < numberOfEvents; i++) {
+      const int fd{events[i].data.fd};
+      // Delegates run with the lock held so that remove() cannot pull one
+      // from under a running call.
+      std::lock_guard<std::mutex> lck(m_delegatesMutex);
+      auto it = m_delegates.find(fd);
+      if ( (m_delegates.end() != it) && !it->second() ) {
+        m_delegates.erase(it);
+        ::epoll_ctl(m_epoll, EPOLL_CTL_DEL, fd, nullptr);
+      }
+    }
+  }
+}
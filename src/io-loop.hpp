@@ -0,0 +1,78 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef IO_LOOP
+#define IO_LOOP
+
+#include <atomic>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+/**
+ * IoLoop waits for several file descriptors with one epoll instance and
+ * calls their delegates from its single thread whenever they are readable.
+ * A delegate delays all others while it runs: RPLidar decodes and runs the
+ * scan pipeline within its delegate, so the devices of one loop share one
+ * core for all of their per-scan processing.
+ */
+class IoLoop {
+ public:
+  /**
+   * Called from the thread of the loop; returning false removes the file
+   * descriptor from the loop, e.g., after the device disappeared.
+   */
+  using ReadableDelegate = std::function<bool()>;
+
+ private:
+  IoLoop(const IoLoop &) = delete;
+  IoLoop(IoLoop &&)      = delete;
+  IoLoop &operator=(const IoLoop &) = delete;
+  IoLoop &operator=(IoLoop &&) = delete;
+
+ public:
+  IoLoop() noexcept;
+  ~IoLoop();
+
+ public:
+  bool isRunning() const noexcept;
+  bool add(int fd, ReadableDelegate delegate) noexcept;
+  /**
+   * Removes the file descriptor; returns after a running delegate for it
+   * returned. Must not be called from a delegate.
+   */
+  void remove(int fd) noexcept;
+  /**
+   * @return file descriptors currently served.
+   */
+  size_t size() const noexcept;
+
+ private:
+  void run() noexcept;
+
+ private:
+  int m_epoll{-1};
+  mutable std::mutex m_delegatesMutex{};
+  std::map<int, ReadableDelegate> m_delegates{};
+
+  std::atomic<bool> m_running{false};
+  std::unique_ptr<std::thread> m_thread{nullptr};
+};
+
+#endif
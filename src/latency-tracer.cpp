@@ -0,0 +1,158 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "latency-tracer.hpp"
+
+#include <chrono>
+#include <sstream>
+
+constexpr const uint32_t LatencyTracer::Histogram::NUMBER_OF_BUCKETS;
+
+uint32_t LatencyTracer::Histogram::bucket(int64_t value) noexcept {
+  if (16 > value) {
+    return (0 > value) ? 0 : static_cast<uint32_t>(value);
+  }
+  const uint32_t msb{63u - static_cast<uint32_t>(__builtin_clzll(static_cast<uint64_t>(value)))};
+  const uint32_t sub{static_cast<uint32_t>((value >> (msb - 3)) & 0x7)};
+  return 16 + (msb - 4) * 8 + sub;
+}
+
+int64_t LatencyTracer::Histogram::upperBound(uint32_t bucket) noexcept {
+  if (16 > bucket) {
+    return bucket;
+  }
+  const uint32_t msb{(bucket - 16) / 8 + 4};
+  const int64_t sub{(bucket - 16) % 8};
+  return ((8 + sub + 1) << (msb - 3)) - 1;
+}
+
+void LatencyTracer::Histogram::add(int64_t value) noexcept {
+  m_buckets[bucket(value)]++;
+  m_count++;
+  m_max = (value > m_max) ? value : m_max;
+}
+
+LatencyTracer::Statistics LatencyTracer::Histogram::statistics() const noexcept {
+  Statistics s;
+  s.count = m_count;
+  s.max = m_max;
+  if (0 < m_count) {
+    const uint64_t P50{(m_count * 50 + 99) / 100};
+    const uint64_t P99{(m_count * 99 + 99) / 100};
+    uint64_t sum{0};
+    for (uint32_t i{0}; i < NUMBER_OF_BUCKETS; i++) {
+      const uint64_t before{sum};
+      sum += m_buckets[i];
+      const int64_t value{(upperBound(i) < m_max) ? upperBound(i) : m_max};
+      if ( (before < P50) && (sum >= P50) ) {
+        s.p50 = value;
+      }
+      if ( (before < P99) && (sum >= P99) ) {
+        s.p99 = value;
+        break;
+      }
+    }
+  }
+  return s;
+}
+
+void LatencyTracer::Histogram::reset() noexcept {
+  m_buckets.fill(0);
+  m_count = 0;
+  m_max = 0;
+}
+
+int64_t LatencyTracer::now() noexcept {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+const char* LatencyTracer::stageName(Stage stage) noexcept {
+  switch (stage) {
+    case SERIAL_READ: return "serial read";
+    case NODE_DECODE: return "node decode";
+    case SCAN_COMPLETE: return "scan complete";
+    case SERIALIZATION_START: return "serialization start";
+    case UDP_SEND: return "UDP send";
+    default: return "unknown";
+  }
+}
+
+void LatencyTracer::mark(Stage stage) noexcept {
+  mark(stage, now());
+}
+
+void LatencyTracer::mark(Stage stage, int64_t timeStampInNanoseconds) noexcept {
+  if (NUMBER_OF_STAGES > stage) {
+    m_marks[stage] = timeStampInNanoseconds;
+  }
+}
+
+void LatencyTracer::complete() noexcept {
+  complete(m_marks);
+  // The bytes that were read last might complete further scans.
+  for (uint8_t i{1}; i < NUMBER_OF_STAGES; i++) {
+    m_marks[i] = 0;
+  }
+}
+
+LatencyTracer::Marks LatencyTracer::release() noexcept {
+  const Marks marks{m_marks};
+  for (uint8_t i{1}; i < NUMBER_OF_STAGES; i++) {
+    m_marks[i] = 0;
+  }
+  return marks;
+}
+
+void LatencyTracer::complete(const Marks &marks) noexcept {
+  std::lock_guard<std::mutex> lck(m_histogramsMutex);
+  int64_t last{0};
+  for (uint8_t i{1}; i < NUMBER_OF_STAGES; i++) {
+    if ( (0 < marks[i]) && (0 < marks[i - 1]) ) {
+      m_histograms[i].add(marks[i] - marks[i - 1]);
+    }
+    last = (0 < marks[i]) ? marks[i] : last;
+  }
+  if ( (0 < marks[SERIAL_READ]) && (0 < last) ) {
+    m_histograms[SERIAL_READ].add(last - marks[SERIAL_READ]);
+  }
+}
+
+LatencyTracer::Statistics LatencyTracer::statistics(Stage stage) const noexcept {
+  std::lock_guard<std::mutex> lck(m_histogramsMutex);
+  return (NUMBER_OF_STAGES > stage) ? m_histograms[stage].statistics() : Statistics();
+}
+
+void LatencyTracer::reset() noexcept {
+  std::lock_guard<std::mutex> lck(m_histogramsMutex);
+  for (auto &h : m_histograms) {
+    h.reset();
+  }
+}
+
+std::string LatencyTracer::toString() const noexcept {
+  std::stringstream sstr;
+  sstr << "p50/p99/max over " << statistics(SERIAL_READ).count << " scans; ";
+  for (uint8_t i{0}; i < NUMBER_OF_STAGES; i++) {
+    const Statistics s{statistics(static_cast<Stage>(i))};
+    sstr << ((0 == i) ? "end to end" : stageName(static_cast<Stage>(i)))
+         << ": " << static_cast<double>(s.p50) / 1000.0
+         << "/" << static_cast<double>(s.p99) / 1000.0
+         << "/" << static_cast<double>(s.max) / 1000.0 << " us"
+         << ((i + 1 < NUMBER_OF_STAGES) ? ", " : "");
+  }
+  return sstr.str();
+}
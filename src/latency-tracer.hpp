@@ -0,0 +1,130 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LATENCY_TRACER
+#define LATENCY_TRACER
+
+#include <array>
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+/**
+ * LatencyTracer collects monotonic time stamps at the points that one scan
+ * passes on its way from the serial port to the network and keeps a
+ * histogram per stage, i.e., for the time from the previous point to the
+ * given one, as well as one from end to end.
+ *
+ * Points are marked from the thread that reads from the device; complete()
+ * records them once per scan. A scan that is sent from another thread takes
+ * its points along with release() to be recorded by complete(marks) there.
+ * Statistics can be queried from any thread.
+ */
+class LatencyTracer {
+ public:
+  enum Stage : uint8_t {
+    SERIAL_READ         = 0, // Bytes completing the scan were read.
+    NODE_DECODE         = 1, // Start node of the next scan was decoded.
+    SCAN_COMPLETE       = 2, // PointCloudReading was assembled.
+    SERIALIZATION_START = 3, // Publisher started to serialize.
+    UDP_SEND            = 4, // Envelope was handed to UDP.
+    NUMBER_OF_STAGES    = 5,
+  };
+
+  using Marks = std::array<int64_t, NUMBER_OF_STAGES>;
+
+  struct Statistics {
+    uint64_t count{0};
+    int64_t p50{0}; // All in ns.
+    int64_t p99{0};
+    int64_t max{0};
+  };
+
+ private:
+  // Log-linear buckets with 8 sub-buckets per power of two, i.e., at most
+  // 12.5% off, for values from 1 ns up to the range of int64_t.
+  class Histogram {
+   public:
+    void add(int64_t value) noexcept;
+    Statistics statistics() const noexcept;
+    void reset() noexcept;
+
+   private:
+    static constexpr const uint32_t NUMBER_OF_BUCKETS{512};
+    static uint32_t bucket(int64_t value) noexcept;
+    static int64_t upperBound(uint32_t bucket) noexcept;
+
+   private:
+    std::array<uint64_t, NUMBER_OF_BUCKETS> m_buckets{};
+    uint64_t m_count{0};
+    int64_t m_max{0};
+  };
+
+ private:
+  LatencyTracer(const LatencyTracer &) = delete;
+  LatencyTracer(LatencyTracer &&)      = delete;
+  LatencyTracer &operator=(const LatencyTracer &) = delete;
+  LatencyTracer &operator=(LatencyTracer &&) = delete;
+
+ public:
+  LatencyTracer() = default;
+  ~LatencyTracer() = default;
+
+ public:
+  /**
+   * @return steady clock time in ns as used for all marks.
+   */
+  static int64_t now() noexcept;
+  static const char* stageName(Stage stage) noexcept;
+
+  void mark(Stage stage) noexcept;
+  void mark(Stage stage, int64_t timeStampInNanoseconds) noexcept;
+  /**
+   * Records the points marked for the current scan; stages whose point or
+   * preceding point was not marked are skipped.
+   */
+  void complete() noexcept;
+  /**
+   * @return the points marked for the current scan, which are no longer
+   * recorded by complete().
+   */
+  Marks release() noexcept;
+  /**
+   * Records the given points; may be called from any thread.
+   */
+  void complete(const Marks &marks) noexcept;
+
+  /**
+   * @return latencies from the previous point to the given one; for
+   * SERIAL_READ, the latencies from SERIAL_READ to the last marked point.
+   */
+  Statistics statistics(Stage stage) const noexcept;
+  void reset() noexcept;
+  /**
+   * @return one line with p50/p99/max in us for every stage.
+   */
+  std::string toString() const noexcept;
+
+ private:
+  Marks m_marks{};
+
+  mutable std::mutex m_histogramsMutex{};
+  // Index SERIAL_READ holds the end to end latencies.
+  std::array<Histogram, NUMBER_OF_STAGES> m_histograms{};
+};
+
+#endif
@@ -0,0 +1,237 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "line-extractor.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+constexpr const float PI{3.14159265f};
+}
+
+LineExtractor::LineExtractor(const Config &config, uint32_t samplesPerScan) noexcept
+  : m_config(config)
+  , m_breakAngle(config.breakAngle * PI / 180.0f)
+  , m_x(samplesPerScan, 0.0f)
+  , m_y(samplesPerScan, 0.0f)
+  , m_azimuths(samplesPerScan, 0.0f)
+  , m_ranges(samplesPerScan, 0.0f) {
+  // Pieces as well as the ranges still to be split have at least 2 samples
+  // and share at most their end samples; segments have at least MIN_SAMPLES.
+  const uint32_t MIN_SAMPLES{std::max(2u, m_config.minSamples)};
+  const uint32_t MAX_PIECES{std::max(2u, samplesPerScan) - 1};
+  const uint32_t MAX_SEGMENTS{(std::max(1u, samplesPerScan) - 1) / (MIN_SAMPLES - 1) + 1};
+  m_stack.reserve(MAX_PIECES);
+  m_pieces.reserve(MAX_PIECES);
+  m_segments.reserve(MAX_SEGMENTS);
+}
+
+bool LineExtractor::isBreak(uint32_t i, uint32_t j) const noexcept {
+  // Gap between two samples on a surface seen at breakAngle from the ray of
+  // sample i (Borges and Aldon, 2004).
+  const float angle{std::fabs(std::remainder(m_azimuths[j] - m_azimuths[i], 2.0f * PI))};
+  if (angle >= m_breakAngle) {
+    return true;
+  }
+  const float maxGap{m_ranges[i] * std::sin(angle) / std::sin(m_breakAngle - angle) + m_config.breakDistance};
+  const float dx{m_x[j] - m_x[i]};
+  const float dy{m_y[j] - m_y[i]};
+  return (dx * dx + dy * dy) > maxGap * maxGap;
+}
+
+float LineExtractor::farthestFromChord(const Range &range, uint32_t &index) const noexcept {
+  const float cx{m_x[range.last] - m_x[range.first]};
+  const float cy{m_y[range.last] - m_y[range.first]};
+  const float length{std::sqrt(cx * cx + cy * cy)};
+  float farthest{0.0f};
+  index = range.first;
+  for (uint32_t i{range.first + 1}; i < range.last; i++) {
+    const float dx{m_x[i] - m_x[range.first]};
+    const float dy{m_y[i] - m_y[range.first]};
+    // Distance from the first sample for a chord of zero length.
+    const float distance{(0.0f < length) ? std::fabs(cx * dy - cy * dx) / length : std::sqrt(dx * dx + dy * dy)};
+    if (distance > farthest) {
+      farthest = distance;
+      index = i;
+    }
+  }
+  return farthest;
+}
+
+void LineExtractor::fit(const Range &range, Segment &segment) const noexcept {
+  const uint32_t n{range.last - range.first + 1};
+  double mx{0.0};
+  double my{0.0};
+  for (uint32_t i{range.first}; i <= range.last; i++) {
+    mx += m_x[i];
+    my += m_y[i];
+  }
+  mx /= n;
+  my /= n;
+  double sxx{0.0};
+  double syy{0.0};
+  double sxy{0.0};
+  for (uint32_t i{range.first}; i <= range.last; i++) {
+    const double dx{m_x[i] - mx};
+    const double dy{m_y[i] - my};
+    sxx += dx * dx;
+    syy += dy * dy;
+    sxy += dx * dy;
+  }
+  // Direction of the principal axis.
+  const double alpha{0.5 * std::atan2(2.0 * sxy, sxx - syy)};
+  const double ux{std::cos(alpha)};
+  const double uy{std::sin(alpha)};
+
+  double squares{0.0};
+  for (uint32_t i{range.first}; i <= range.last; i++) {
+    const double distance{uy * (m_x[i] - mx) - ux * (m_y[i] - my)};
+    squares += distance * distance;
+  }
+  const double t1{ux * (m_x[range.first] - mx) + uy * (m_y[range.first] - my)};
+  const double t2{ux * (m_x[range.last] - mx) + uy * (m_y[range.last] - my)};
+  segment.x1 = static_cast<float>(mx + t1 * ux);
+  segment.y1 = static_cast<float>(my + t1 * uy);
+  segment.x2 = static_cast<float>(mx + t2 * ux);
+  segment.y2 = static_cast<float>(my + t2 * uy);
+  segment.samples = n;
+  segment.residual = static_cast<float>(std::sqrt(squares / n));
+}
+
+uint32_t LineExtractor::extract(const float *angles, const float *distances, uint32_t size) noexcept {
+  m_segments.clear();
+  m_samplesFitted = 0;
+  m_residual = 0.0f;
+
+  const float DEG2RAD{PI / 180.0f};
+  uint32_t n{0};
+  for (uint32_t i{0}; (i < size) && (n < m_x.size()); i++) {
+    if (0.0f < distances[i]) {
+      // Azimuths are clockwise.
+      const float azimuth{-angles[i] * DEG2RAD};
+      m_x[n] = distances[i] * std::cos(azimuth);
+      m_y[n] = distances[i] * std::sin(azimuth);
+      m_azimuths[n] = azimuth;
+      m_ranges[n] = distances[i];
+      n++;
+    }
+  }
+  const uint32_t MIN_SAMPLES{std::max(2u, m_config.minSamples)};
+  if (MIN_SAMPLES > n) {
+    return 0;
+  }
+
+  // A surface crossing the start of the scan is continued at its end: the
+  // samples are rotated to start after the first breakpoint or, when the
+  // scan is closed, at the sample where the first split would happen.
+  uint32_t start{0};
+  if (!isBreak(n - 1, 0)) {
+    start = 1;
+    while ( (start < n) && !isBreak(start - 1, start) ) {
+      start++;
+    }
+    if (n == start) {
+      uint32_t farthest{0};
+      farthestFromChord(Range{0, n - 1, 0}, farthest);
+      if (m_config.splitDistance >= farthestFromChord(Range{0, farthest, 0}, start)) {
+        start = farthest;
+      }
+    }
+    if (0 < start) {
+      std::rotate(m_x.begin(), m_x.begin() + start, m_x.begin() + n);
+      std::rotate(m_y.begin(), m_y.begin() + start, m_y.begin() + n);
+      std::rotate(m_azimuths.begin(), m_azimuths.begin() + start, m_azimuths.begin() + n);
+      std::rotate(m_ranges.begin(), m_ranges.begin() + start, m_ranges.begin() + n);
+    }
+  }
+
+  // Split: clusters and then their pieces are handled in scan order, so
+  // pieces that share their end sample are neighbours on one surface.
+  // A piece shorter than MIN_SAMPLES, e.g., next to a corner, is not split
+  // any further but kept to be merged into a neighbour below.
+  m_pieces.clear();
+  uint32_t first{0};
+  uint32_t cluster{0};
+  for (uint32_t i{1}; i <= n; i++) {
+    if ( (n == i) || isBreak(i - 1, i) ) {
+      // Clusters with too few samples for a segment are left out right away.
+      m_stack.clear();
+      if (MIN_SAMPLES <= i - first) {
+        m_stack.push_back(Range{first, i - 1, cluster++});
+      }
+      while (!m_stack.empty()) {
+        const Range range{m_stack.back()};
+        m_stack.pop_back();
+        uint32_t index{0};
+        if ( (MIN_SAMPLES <= (range.last - range.first + 1)) && (m_config.splitDistance < farthestFromChord(range, index)) ) {
+          m_stack.push_back(Range{index, range.last, range.cluster});
+          m_stack.push_back(Range{range.first, index, range.cluster});
+        }
+        else {
+          m_pieces.push_back(range);
+        }
+      }
+      first = i;
+    }
+  }
+
+  // Merge neighbouring pieces as long as one segment fits them; a short
+  // piece that fits neither neighbour is left out.
+  const float MERGE_RESIDUAL{0.5f * m_config.splitDistance};
+  double squares{0.0};
+  uint32_t samples{0};
+  int64_t lastFitted{-1};
+  Segment segment;
+  for (uint32_t i{0}; i < m_pieces.size(); i++) {
+    Range range{m_pieces[i]};
+    while ( (i + 1 < m_pieces.size()) && (m_pieces[i + 1].cluster == range.cluster) ) {
+      fit(Range{range.first, m_pieces[i + 1].last, range.cluster}, segment);
+      if (MERGE_RESIDUAL < segment.residual) {
+        break;
+      }
+      range.last = m_pieces[++i].last;
+    }
+    if (MIN_SAMPLES > (range.last - range.first + 1)) {
+      continue;
+    }
+    fit(range, segment);
+    const float dx{segment.x2 - segment.x1};
+    const float dy{segment.y2 - segment.y1};
+    if ((m_config.minLength * m_config.minLength) <= (dx * dx + dy * dy)) {
+      m_segments.push_back(segment);
+      squares += static_cast<double>(segment.residual) * segment.residual * segment.samples;
+      samples += segment.samples;
+      m_samplesFitted += static_cast<uint32_t>(static_cast<int64_t>(range.last) - std::max(lastFitted, static_cast<int64_t>(range.first) - 1));
+      lastFitted = range.last;
+    }
+  }
+  m_residual = (0 < samples) ? static_cast<float>(std::sqrt(squares / samples)) : 0.0f;
+  return static_cast<uint32_t>(m_segments.size());
+}
+
+const std::vector<LineExtractor::Segment> &LineExtractor::segments() const noexcept {
+  return m_segments;
+}
+
+uint32_t LineExtractor::samplesFitted() const noexcept {
+  return m_samplesFitted;
+}
+
+float LineExtractor::residual() const noexcept {
+  return m_residual;
+}
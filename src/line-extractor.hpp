@@ -0,0 +1,116 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LINE_EXTRACTOR
+#define LINE_EXTRACTOR
+
+#include <cstdint>
+#include <vector>
+
+/**
+ * LineExtractor fits line segments to the samples of one scan by split and
+ * merge over the samples in scan order: the scan is cut into clusters where
+ * consecutive samples are farther apart than a surface seen at breakAngle
+ * would explain (adaptive breakpoints), clusters are split recursively at
+ * the sample farthest from the chord between their end samples, and
+ * neighbouring pieces of a cluster are merged again while the RMS distance
+ * from one line stays within half of splitDistance. A split may leave a
+ * piece of fewer than minSamples samples, e.g., next to a corner; it is
+ * merged into a neighbour it fits, or else its samples are on no segment,
+ * like those of clusters with fewer than minSamples samples.
+ * Every segment is a total least squares fit of its samples; its end points
+ * are the projections of its first and last sample.
+ *
+ * All buffers are allocated up front for samplesPerScan samples.
+ */
+class LineExtractor {
+ public:
+  struct Config {
+    float splitDistance{0.03f}; // in m; max distance of a sample from its segment
+    float breakAngle{10.0f};    // in degree; flatter surfaces are not followed
+    float breakDistance{0.05f}; // in m; added to the gap a surface at breakAngle explains, i.e., noise
+    uint32_t minSamples{6};
+    float minLength{0.2f};      // in m
+  };
+
+  struct Segment {
+    float x1{0.0f}; // in m, first end point in scan order (x forward, y left)
+    float y1{0.0f};
+    float x2{0.0f};
+    float y2{0.0f};
+    uint32_t samples{0};
+    float residual{0.0f}; // RMS distance of the samples in m
+  };
+
+ private:
+  LineExtractor(const LineExtractor &) = delete;
+  LineExtractor(LineExtractor &&)      = delete;
+  LineExtractor &operator=(const LineExtractor &) = delete;
+  LineExtractor &operator=(LineExtractor &&) = delete;
+
+ public:
+  LineExtractor(const Config &config, uint32_t samplesPerScan) noexcept;
+  ~LineExtractor() = default;
+
+ public:
+  /**
+   * Extracts the segments of one scan (azimuth clockwise in degree, distance
+   * in m; 0 = no return, skipped).
+   * @return number of segments.
+   */
+  uint32_t extract(const float *angles, const float *distances, uint32_t size) noexcept;
+  /**
+   * @return segments of the latest scan in scan order.
+   */
+  const std::vector<Segment> &segments() const noexcept;
+  /**
+   * @return samples of the latest scan that belong to a segment; samples
+   * of short pieces and clusters that were left out are not counted.
+   */
+  uint32_t samplesFitted() const noexcept;
+  /**
+   * @return RMS distance of these samples from their segments in m.
+   */
+  float residual() const noexcept;
+
+ private:
+  // Inclusive indices of samples in m_x and m_y.
+  struct Range {
+    uint32_t first{0};
+    uint32_t last{0};
+    uint32_t cluster{0};
+  };
+
+  bool isBreak(uint32_t i, uint32_t j) const noexcept;
+  float farthestFromChord(const Range &range, uint32_t &index) const noexcept;
+  void fit(const Range &range, Segment &segment) const noexcept;
+
+ private:
+  const Config m_config;
+  const float m_breakAngle; // in rad
+  std::vector<float> m_x;
+  std::vector<float> m_y;
+  std::vector<float> m_azimuths; // in rad
+  std::vector<float> m_ranges;
+  std::vector<Range> m_stack{};
+  std::vector<Range> m_pieces{};
+  std::vector<Segment> m_segments{};
+  uint32_t m_samplesFitted{0};
+  float m_residual{0.0f};
+};
+
+#endif
@@ -0,0 +1,68 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "motor-controller.hpp"
+
+constexpr const uint16_t MotorController::DEFAULT_PWM;
+constexpr const uint16_t MotorController::MAX_PWM;
+constexpr const float MotorController::NOMINAL_FREQUENCY;
+
+MotorController::MotorController(float targetFrequency, float kp, float ki) noexcept
+  : m_targetFrequency{(0.0f < targetFrequency) ? targetFrequency : 0.0f}
+  , m_kp{kp}
+  , m_ki{ki} {
+  m_pwm = static_cast<uint16_t>(feedForward());
+}
+
+void MotorController::setTargetFrequency(float targetFrequency) noexcept {
+  m_targetFrequency = (0.0f < targetFrequency) ? targetFrequency : 0.0f;
+  m_integral = 0.0f;
+  m_pwm = static_cast<uint16_t>(feedForward());
+}
+
+float MotorController::targetFrequency() const noexcept {
+  return m_targetFrequency;
+}
+
+uint16_t MotorController::pwm() const noexcept {
+  return m_pwm;
+}
+
+float MotorController::feedForward() const noexcept {
+  const float pwm{static_cast<float>(DEFAULT_PWM) * m_targetFrequency / NOMINAL_FREQUENCY};
+  return (pwm < static_cast<float>(MAX_PWM)) ? pwm : static_cast<float>(MAX_PWM);
+}
+
+uint16_t MotorController::update(float measuredFrequency, float dt) noexcept {
+  if (0.0f >= m_targetFrequency) {
+    m_pwm = 0;
+    return m_pwm;
+  }
+  if ( (0.0f >= measuredFrequency) || (0.0f >= dt) ) {
+    return m_pwm;
+  }
+
+  const float error{m_targetFrequency - measuredFrequency};
+  const float LIMIT{static_cast<float>(MAX_PWM)};
+  m_integral += m_ki * error * dt;
+  m_integral = (m_integral > LIMIT) ? LIMIT : ((m_integral < -LIMIT) ? -LIMIT : m_integral);
+
+  float pwm{feedForward() + m_kp * error + m_integral};
+  pwm = (pwm > LIMIT) ? LIMIT : ((pwm < 0.0f) ? 0.0f : pwm);
+  m_pwm = static_cast<uint16_t>(pwm + 0.5f);
+  return m_pwm;
+}
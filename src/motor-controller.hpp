@@ -0,0 +1,67 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MOTOR_CONTROLLER
+#define MOTOR_CONTROLLER
+
+#include <cstdint>
+
+/**
+ * MotorController holds a target scan frequency by adjusting the duty cycle
+ * for SET_MOTOR_PWM: a feed forward term assuming NOMINAL_FREQUENCY at
+ * DEFAULT_PWM plus a PI controller on the measured scan frequency; the
+ * integral is clamped to the PWM range against wind-up.
+ */
+class MotorController {
+ public:
+  static constexpr const uint16_t DEFAULT_PWM{660};
+  static constexpr const uint16_t MAX_PWM{1023};
+  static constexpr const float NOMINAL_FREQUENCY{10.0f};
+
+ private:
+  MotorController(const MotorController &) = delete;
+  MotorController(MotorController &&)      = delete;
+  MotorController &operator=(const MotorController &) = delete;
+  MotorController &operator=(MotorController &&) = delete;
+
+ public:
+  MotorController(float targetFrequency = NOMINAL_FREQUENCY, float kp = 20.0f, float ki = 20.0f) noexcept;
+  ~MotorController() = default;
+
+ public:
+  void setTargetFrequency(float targetFrequency) noexcept;
+  float targetFrequency() const noexcept;
+  /**
+   * @param measuredFrequency scan frequency in Hz; 0 if not known yet.
+   * @param dt time since the last update in s.
+   * @return PWM duty cycle to apply.
+   */
+  uint16_t update(float measuredFrequency, float dt) noexcept;
+  uint16_t pwm() const noexcept;
+
+ private:
+  float feedForward() const noexcept;
+
+ private:
+  float m_targetFrequency;
+  float m_kp;
+  float m_ki;
+  float m_integral{0.0f};
+  uint16_t m_pwm{DEFAULT_PWM};
+};
+
+#endif
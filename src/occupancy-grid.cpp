@@ -0,0 +1,354 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "occupancy-grid.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+constexpr const float PI{3.14159265f};
+constexpr const uint8_t FREE{1};
+constexpr const uint8_t HIT{2};
+constexpr const uint32_t BLOCK{8};
+
+uint32_t powerOfTwo(uint32_t size) noexcept {
+  uint32_t p{BLOCK};
+  while ( (p < size) && (p < OccupancyGrid::MAX_SIZE) ) {
+    p <<= 1;
+  }
+  return p;
+}
+
+int32_t toCell(float coordinate, float inverseResolution) noexcept {
+  return static_cast<int32_t>(std::floor(coordinate * inverseResolution));
+}
+}
+
+constexpr const uint32_t OccupancyGrid::MAX_SIZE;
+
+OccupancyGrid::OccupancyGrid(const Config &config) noexcept
+  : m_config{config}
+  , m_size{powerOfTwo(config.size)}
+  , m_mask{m_size - 1}
+  , m_blocksPerRow{m_size / BLOCK}
+  , m_cells(m_size * m_size, 0)
+  , m_marks(m_size * m_size)
+  , m_markedBlocks(m_blocksPerRow * m_blocksPerRow) {
+  const uint32_t parts{std::max(1u, std::min(m_config.threads, m_blocksPerRow))};
+  m_tracedPerPart.assign(parts, 0);
+  m_updatedPerPart.assign(parts, 0);
+  m_hits.reserve(8192);
+  // The first part is done by the thread that integrates.
+  for (uint32_t i{1}; i < parts; i++) {
+    m_workers.emplace_back(&OccupancyGrid::work, this, i);
+  }
+}
+
+OccupancyGrid::~OccupancyGrid() {
+  {
+    std::lock_guard<std::mutex> lck(m_workMutex);
+    m_running = false;
+  }
+  m_workAvailable.notify_all();
+  for (auto &worker : m_workers) {
+    worker.join();
+  }
+}
+
+uint32_t OccupancyGrid::size() const noexcept {
+  return m_size;
+}
+
+float OccupancyGrid::resolution() const noexcept {
+  return m_config.resolution;
+}
+
+float OccupancyGrid::originX() const noexcept {
+  return static_cast<float>(m_originX) * m_config.resolution;
+}
+
+float OccupancyGrid::originY() const noexcept {
+  return static_cast<float>(m_originY) * m_config.resolution;
+}
+
+uint64_t OccupancyGrid::cellsUpdated() const noexcept {
+  return m_cellsUpdated;
+}
+
+uint32_t OccupancyGrid::index(int32_t cellX, int32_t cellY) const noexcept {
+  const uint32_t x{static_cast<uint32_t>(cellX) & m_mask};
+  const uint32_t y{static_cast<uint32_t>(cellY) & m_mask};
+  return (((y / BLOCK) * m_blocksPerRow + (x / BLOCK)) * BLOCK * BLOCK) + (y % BLOCK) * BLOCK + (x % BLOCK);
+}
+
+bool OccupancyGrid::inside(int32_t cellX, int32_t cellY) const noexcept {
+  return m_hasOrigin
+      && (static_cast<uint32_t>(cellX - m_originX) < m_size)
+      && (static_cast<uint32_t>(cellY - m_originY) < m_size);
+}
+
+int8_t OccupancyGrid::at(float x, float y) const noexcept {
+  const float inverse{1.0f / m_config.resolution};
+  const int32_t cellX{toCell(x, inverse)};
+  const int32_t cellY{toCell(y, inverse)};
+  return inside(cellX, cellY) ? m_cells[index(cellX, cellY)] : 0;
+}
+
+void OccupancyGrid::recentre(int32_t cellX, int32_t cellY) noexcept {
+  const int32_t originX{cellX - static_cast<int32_t>(m_size / 2)};
+  const int32_t originY{cellY - static_cast<int32_t>(m_size / 2)};
+  if (m_hasOrigin) {
+    // Columns and rows entering the window hold cells that left it.
+    const int32_t dx{originX - m_originX};
+    const int32_t dy{originY - m_originY};
+    if ( (std::abs(dx) >= static_cast<int32_t>(m_size)) || (std::abs(dy) >= static_cast<int32_t>(m_size)) ) {
+      std::fill(m_cells.begin(), m_cells.end(), 0);
+    }
+    else {
+      const int32_t fromX{(0 < dx) ? m_originX + static_cast<int32_t>(m_size) : originX};
+      for (int32_t c{fromX}; c < fromX + std::abs(dx); c++) {
+        for (int32_t r{0}; r < static_cast<int32_t>(m_size); r++) {
+          m_cells[index(c, r)] = 0;
+        }
+      }
+      const int32_t fromY{(0 < dy) ? m_originY + static_cast<int32_t>(m_size) : originY};
+      for (int32_t r{fromY}; r < fromY + std::abs(dy); r++) {
+        for (int32_t c{0}; c < static_cast<int32_t>(m_size); c++) {
+          m_cells[index(c, r)] = 0;
+        }
+      }
+    }
+  }
+  m_originX = originX;
+  m_originY = originY;
+  m_hasOrigin = true;
+}
+
+uint64_t OccupancyGrid::integrate(const float *angles, const float *distances, uint32_t size, float x, float y, float yaw) noexcept {
+  if ( (nullptr == angles) || (nullptr == distances) ) {
+    return 0;
+  }
+  const float inverse{1.0f / m_config.resolution};
+  recentre(toCell(x, inverse), toCell(y, inverse));
+
+  m_angles = angles;
+  m_distances = distances;
+  m_numberOfRays = size;
+  m_x = x;
+  m_y = y;
+  m_yaw = yaw;
+  m_hits.resize(size);
+  run(TRACE);
+  // After all free cells were marked so that hits win.
+  for (auto hit : m_hits) {
+    if (UINT32_MAX != hit) {
+      markCell(hit, HIT);
+    }
+  }
+  run(APPLY);
+
+  uint64_t traced{0};
+  for (uint32_t i{0}; i < m_tracedPerPart.size(); i++) {
+    traced += m_tracedPerPart[i];
+    m_cellsUpdated += m_updatedPerPart[i];
+  }
+  return traced;
+}
+
+void OccupancyGrid::trace(uint32_t part) noexcept {
+  const uint32_t parts{static_cast<uint32_t>(m_tracedPerPart.size())};
+  const uint32_t from{static_cast<uint32_t>(static_cast<uint64_t>(m_numberOfRays) * part / parts)};
+  const uint32_t to{static_cast<uint32_t>(static_cast<uint64_t>(m_numberOfRays) * (part + 1) / parts)};
+  const float inverse{1.0f / m_config.resolution};
+  const int32_t x0{toCell(m_x, inverse)};
+  const int32_t y0{toCell(m_y, inverse)};
+
+  uint64_t traced{0};
+  for (uint32_t i{from}; i < to; i++) {
+    m_hits[i] = UINT32_MAX;
+    const float distance{m_distances[i]};
+    if (!(0.0f < distance)) {
+      continue;
+    }
+    // Azimuths are clockwise.
+    const float angle{m_yaw - m_angles[i] * PI / 180.0f};
+    const bool hit{distance <= m_config.maxRange};
+    const float range{hit ? distance : m_config.maxRange};
+    const int32_t x1{toCell(m_x + range * std::cos(angle), inverse)};
+    const int32_t y1{toCell(m_y + range * std::sin(angle), inverse)};
+
+    // Bresenham; once a ray left the window, it does not come back.
+    const int32_t dx{std::abs(x1 - x0)};
+    const int32_t dy{-std::abs(y1 - y0)};
+    const int32_t sx{(x0 < x1) ? 1 : -1};
+    const int32_t sy{(y0 < y1) ? 1 : -1};
+    int32_t error{dx + dy};
+    int32_t cx{x0};
+    int32_t cy{y0};
+    while ( ((cx != x1) || (cy != y1)) && inside(cx, cy) ) {
+      markCell(index(cx, cy), FREE);
+      traced++;
+      const int32_t e2{2 * error};
+      if (e2 >= dy) {
+        error += dy;
+        cx += sx;
+      }
+      if (e2 <= dx) {
+        error += dx;
+        cy += sy;
+      }
+    }
+    if ( (cx == x1) && (cy == y1) && inside(cx, cy) ) {
+      if (hit) {
+        m_hits[i] = index(cx, cy);
+      }
+      else {
+        markCell(index(cx, cy), FREE);
+      }
+      traced++;
+    }
+  }
+  m_tracedPerPart[part] = traced;
+}
+
+void OccupancyGrid::markCell(uint32_t cell, uint8_t value) noexcept {
+  m_marks[cell].store(value, std::memory_order_relaxed);
+  m_markedBlocks[cell / (BLOCK * BLOCK)].store(1, std::memory_order_relaxed);
+}
+
+void OccupancyGrid::apply(uint32_t part) noexcept {
+  const uint32_t parts{static_cast<uint32_t>(m_updatedPerPart.size())};
+  const uint32_t from{m_blocksPerRow * part / parts * m_blocksPerRow};
+  const uint32_t to{m_blocksPerRow * (part + 1) / parts * m_blocksPerRow};
+
+  uint64_t updated{0};
+  for (uint32_t block{from}; block < to; block++) {
+    if (0 == m_markedBlocks[block].load(std::memory_order_relaxed)) {
+      continue;
+    }
+    m_markedBlocks[block].store(0, std::memory_order_relaxed);
+    for (uint32_t i{block * BLOCK * BLOCK}; i < (block + 1) * BLOCK * BLOCK; i++) {
+      const uint8_t mark{m_marks[i].load(std::memory_order_relaxed)};
+      if (0 == mark) {
+        continue;
+      }
+      m_marks[i].store(0, std::memory_order_relaxed);
+      const int32_t value{static_cast<int32_t>(m_cells[i]) + ((HIT == mark) ? m_config.hit : m_config.miss)};
+      m_cells[i] = static_cast<int8_t>(std::min<int32_t>(m_config.maximum, std::max<int32_t>(m_config.minimum, value)));
+      updated++;
+    }
+  }
+  m_updatedPerPart[part] = updated;
+}
+
+void OccupancyGrid::run(Phase phase) noexcept {
+  {
+    std::lock_guard<std::mutex> lck(m_workMutex);
+    m_phase = phase;
+    m_pendingWorkers = static_cast<uint32_t>(m_workers.size());
+    m_generation++;
+  }
+  m_workAvailable.notify_all();
+  if (TRACE == phase) {
+    trace(0);
+  }
+  else {
+    apply(0);
+  }
+  {
+    std::unique_lock<std::mutex> lck(m_workMutex);
+    m_workDone.wait(lck, [this](){ return 0 == m_pendingWorkers; });
+  }
+}
+
+void OccupancyGrid::work(uint32_t part) noexcept {
+  uint64_t generation{0};
+  while (true) {
+    Phase phase{TRACE};
+    {
+      std::unique_lock<std::mutex> lck(m_workMutex);
+      m_workAvailable.wait(lck, [this, &generation](){ return !m_running || (generation != m_generation); });
+      // Finish a phase that is waiting for this worker before stopping.
+      if (generation == m_generation) {
+        return;
+      }
+      generation = m_generation;
+      phase = m_phase;
+    }
+    if (TRACE == phase) {
+      trace(part);
+    }
+    else {
+      apply(part);
+    }
+    {
+      std::lock_guard<std::mutex> lck(m_workMutex);
+      m_pendingWorkers--;
+    }
+    m_workDone.notify_one();
+  }
+}
+
+void OccupancyGrid::compress(std::string &buffer) const noexcept {
+  buffer.clear();
+  auto flush = [&buffer](uint32_t run, int8_t value){
+    while (0x80 <= run) {
+      buffer.push_back(static_cast<char>((run & 0x7F) | 0x80));
+      run >>= 7;
+    }
+    buffer.push_back(static_cast<char>(run));
+    buffer.push_back(static_cast<char>(value));
+  };
+
+  uint32_t run{0};
+  int8_t value{0};
+  for (int32_t r{m_originY}; r < m_originY + static_cast<int32_t>(m_size); r++) {
+    for (int32_t c{m_originX}; c < m_originX + static_cast<int32_t>(m_size); c++) {
+      const int8_t cell{m_cells[index(c, r)]};
+      if ( (0 < run) && (cell != value) ) {
+        flush(run, value);
+        run = 0;
+      }
+      value = cell;
+      run++;
+    }
+  }
+  if (0 < run) {
+    flush(run, value);
+  }
+}
+
+bool OccupancyGrid::decompress(const std::string &buffer, uint32_t numberOfCells, std::vector<int8_t> &cells) noexcept {
+  cells.clear();
+  size_t i{0};
+  while (i < buffer.size()) {
+    uint32_t run{0};
+    uint32_t shift{0};
+    uint8_t byte{0x80};
+    while ( (0x80 & byte) && (i < buffer.size()) && (shift < 32) ) {
+      byte = static_cast<uint8_t>(buffer[i++]);
+      run |= static_cast<uint32_t>(byte & 0x7F) << shift;
+      shift += 7;
+    }
+    if ( (0x80 & byte) || (i >= buffer.size()) || (run > numberOfCells - cells.size()) ) {
+      return false;
+    }
+    cells.insert(cells.end(), run, static_cast<int8_t>(buffer[i++]));
+  }
+  return numberOfCells == cells.size();
+}
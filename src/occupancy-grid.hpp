@@ -0,0 +1,152 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef OCCUPANCY_GRID
+#define OCCUPANCY_GRID
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * OccupancyGrid integrates scans into a square log-odds grid that rolls
+ * with the device: the window is recentred on the device before every scan
+ * and cells that leave it are forgotten. Cells are addressed toroidally,
+ * so recentring only clears the rows and columns that enter the window.
+ *
+ * Cells are int8 log-odds in 1/10 and stored in blocks of 8x8 cells, i.e.,
+ * one cache line each, to keep neighbouring rows of a ray close in memory.
+ * Every scan is integrated in three phases: the rays of angular sectors are
+ * traced with Bresenham in parallel and mark the cells they pass as free,
+ * the end points are marked as hit, and the marks are applied in parallel
+ * by rows of blocks. Blocks without marks are skipped, so applying a scan
+ * costs the cells it passed rather than the whole window. Hence, a cell is
+ * updated at most once per scan and the result does not depend on the
+ * number of threads.
+ */
+class OccupancyGrid {
+ public:
+  // 16 MiB of cells and as many marks.
+  static constexpr const uint32_t MAX_SIZE{4096};
+
+  struct Config {
+    uint32_t size{256};      // cells per side; rounded up to a power of two >= 8, at most MAX_SIZE
+    float resolution{0.05f}; // in m per cell
+    int8_t hit{9};           // log-odds in 1/10 per update
+    int8_t miss{-4};
+    int8_t minimum{-50};
+    int8_t maximum{50};
+    float maxRange{12.0f};   // in m; farther returns only clear the cells in between
+    uint32_t threads{1};     // angular sectors traced in parallel
+  };
+
+ private:
+  OccupancyGrid(const OccupancyGrid &) = delete;
+  OccupancyGrid(OccupancyGrid &&)      = delete;
+  OccupancyGrid &operator=(const OccupancyGrid &) = delete;
+  OccupancyGrid &operator=(OccupancyGrid &&) = delete;
+
+ public:
+  explicit OccupancyGrid(const Config &config) noexcept;
+  ~OccupancyGrid();
+
+ public:
+  /**
+   * Integrates one scan (azimuth clockwise in degree, distance in m; 0 = no
+   * return) taken at the given pose (in m, yaw counterclockwise in rad).
+   * @return cells passed by the rays including their end points.
+   */
+  uint64_t integrate(const float *angles, const float *distances, uint32_t size, float x, float y, float yaw) noexcept;
+  /**
+   * @return log-odds in 1/10 of the cell containing the point; 0 outside.
+   */
+  int8_t at(float x, float y) const noexcept;
+  uint32_t size() const noexcept;
+  float resolution() const noexcept;
+  /**
+   * @return lower-left corner of the window in m.
+   */
+  float originX() const noexcept;
+  float originY() const noexcept;
+  /**
+   * @return cells whose log-odds were updated since the start.
+   */
+  uint64_t cellsUpdated() const noexcept;
+
+  /**
+   * Run-length encodes the window row by row from the lower-left cell: a
+   * LEB128 run length followed by the int8 log-odds of the run.
+   */
+  void compress(std::string &buffer) const noexcept;
+  static bool decompress(const std::string &buffer, uint32_t numberOfCells, std::vector<int8_t> &cells) noexcept;
+
+ private:
+  enum Phase : uint8_t {
+    TRACE = 0,
+    APPLY = 1,
+  };
+
+  uint32_t index(int32_t cellX, int32_t cellY) const noexcept;
+  bool inside(int32_t cellX, int32_t cellY) const noexcept;
+  void recentre(int32_t cellX, int32_t cellY) noexcept;
+  void run(Phase phase) noexcept;
+  void trace(uint32_t part) noexcept;
+  void markCell(uint32_t cell, uint8_t value) noexcept;
+  void apply(uint32_t part) noexcept;
+  void work(uint32_t part) noexcept;
+
+ private:
+  const Config m_config;
+  const uint32_t m_size;
+  const uint32_t m_mask;
+  const uint32_t m_blocksPerRow;
+  std::vector<int8_t> m_cells;
+  // Per scan: 0 = untouched, FREE, or HIT.
+  std::vector<std::atomic<uint8_t>> m_marks;
+  // Per scan: 1 for blocks holding marks.
+  std::vector<std::atomic<uint8_t>> m_markedBlocks;
+  bool m_hasOrigin{false};
+  int32_t m_originX{0};
+  int32_t m_originY{0};
+  uint64_t m_cellsUpdated{0};
+
+  // The scan being integrated; end cells per ray, UINT32_MAX without hit.
+  const float *m_angles{nullptr};
+  const float *m_distances{nullptr};
+  uint32_t m_numberOfRays{0};
+  float m_x{0.0f};
+  float m_y{0.0f};
+  float m_yaw{0.0f};
+  std::vector<uint32_t> m_hits{};
+  std::vector<uint64_t> m_tracedPerPart{};
+  std::vector<uint64_t> m_updatedPerPart{};
+
+  std::mutex m_workMutex{};
+  std::condition_variable m_workAvailable{};
+  std::condition_variable m_workDone{};
+  uint64_t m_generation{0};
+  uint32_t m_pendingWorkers{0};
+  Phase m_phase{TRACE};
+  bool m_running{true};
+  std::vector<std::thread> m_workers{};
+};
+
+#endif
@@ -0,0 +1,194 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "cluon-complete.hpp"
+
+#include "rplidar-emulator.hpp"
+#include "rplidar.hpp"
+#include "scan-synthesizer.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdint>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace {
+std::atomic<bool> g_running{true};
+void stop(int) {
+  g_running = false;
+}
+
+int64_t now() noexcept {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Runs the unmodified RPLidar class against the emulator and reports end to end figures.
+void benchmark(RPLidarEmulator &emulator, uint32_t seconds, float targetScanFrequency) {
+  std::mutex latenciesMutex;
+  std::vector<int64_t> latencies;
+  uint64_t samples{0};
+  std::atomic<int64_t> firstScan{0};
+
+  const int64_t start{now()};
+  {
+    RPLidar rplidar(emulator.getDeviceName());
+    if (!rplidar.isOpen()) {
+      std::cerr << "[opendlv-device-lidar-rplidar-emulator]: Failed to open " << emulator.getDeviceName() << std::endl;
+      return;
+    }
+    rplidar.setTargetScanFrequency(targetScanFrequency);
+    rplidar.startScanning(nullptr, nullptr, [&](const opendlv::proxy::PointCloudReading &pc){
+      const int64_t received{now()};
+      int64_t expected{0};
+      firstScan.compare_exchange_strong(expected, received);
+      std::lock_guard<std::mutex> lck(latenciesMutex);
+      latencies.push_back(received - emulator.lastScanCompleted());
+      samples += pc.distances().size()/4;
+    });
+
+    const int64_t measuringSince{now()};
+    {
+      std::lock_guard<std::mutex> lck(latenciesMutex);
+      latencies.clear();
+      samples = 0;
+    }
+    const uint64_t bytesBefore{emulator.bytesSent()};
+    for (uint32_t i{0}; (i < seconds) && g_running; i++) {
+      std::this_thread::sleep_for(std::chrono::seconds(1));
+    }
+    const double elapsed{static_cast<double>(now() - measuringSince) / 1e9};
+    const uint64_t bytes{emulator.bytesSent() - bytesBefore};
+
+    std::lock_guard<std::mutex> lck(latenciesMutex);
+    std::sort(latencies.begin(), latencies.end());
+    std::clog << "[opendlv-device-lidar-rplidar-emulator]: Time to first scan: " << static_cast<double>(firstScan - start) / 1e6 << " ms" << std::endl;
+    std::clog << "[opendlv-device-lidar-rplidar-emulator]: Throughput: " << static_cast<double>(latencies.size()) / elapsed << " scans/s, " << static_cast<double>(samples) / elapsed << " samples/s, " << static_cast<double>(bytes) / elapsed << " bytes/s" << std::endl;
+    if (!latencies.empty()) {
+      std::clog << "[opendlv-device-lidar-rplidar-emulator]: Latency from end of rotation to delegate: p50 " << static_cast<double>(latencies[latencies.size() / 2]) / 1e3
+                << " us, p99 " << static_cast<double>(latencies[(latencies.size() * 99) / 100]) / 1e3
+                << " us, max " << static_cast<double>(latencies.back()) / 1e3 << " us" << std::endl;
+    }
+    std::clog << "[opendlv-device-lidar-rplidar-emulator]: Driver latencies " << rplidar.getLatencyTracer().toString() << std::endl;
+    const opendlv::device::lidar::rplidar::DriverStatistics statistics{rplidar.getStatistics()};
+    std::clog << "[opendlv-device-lidar-rplidar-emulator]: Driver statistics: " << statistics.bytesReceived() << " bytes received, " << statistics.bytesDiscarded() << " bytes discarded, " << statistics.invalidNodes() << " invalid nodes, " << statistics.resyncs() << " resyncs, " << statistics.scansEmitted() << " scans at " << statistics.scanFrequency() << " Hz" << std::endl;
+    if (0.0f < targetScanFrequency) {
+      std::clog << "[opendlv-device-lidar-rplidar-emulator]: Motor: target " << targetScanFrequency * 60.0f << " rpm, measured " << statistics.scanFrequency() * 60.0f << " rpm, emulated " << emulator.scanFrequency() * 60.0f << " rpm at PWM " << emulator.motorPwm() << std::endl;
+    }
+  }
+}
+}
+
+int32_t main(int32_t argc, char **argv) {
+  int32_t retCode{1};
+  auto commandlineArguments = cluon::getCommandlineArguments(argc, argv);
+  if (0 != commandlineArguments.count("help")) {
+    std::cerr << argv[0] << " emulates an RPlidar on a pseudo terminal for testing and benchmarking without hardware." << std::endl;
+    std::cerr << "Usage:   " << argv[0] << " [--freq=<Hz>] [--samples=<n>] [--map=<file>] [--obstacles=<n>] [--noise=<m>] [--dropout=<p>] [--seed=<n>] [--faults=<profile>] [--model=<A1|A2|A3>] [--benchmark=<seconds> [--rpm=<n>]]" << std::endl;
+    std::cerr << "         --freq:      scan frequency (default: 10)" << std::endl;
+    std::cerr << "         --samples:   samples per rotation (default: 720)" << std::endl;
+    std::cerr << "         --map:       polygons to ray-cast against, one per line as x,y vertices in m (default: built-in room)" << std::endl;
+    std::cerr << "         --obstacles: number of moving obstacles (default: 0)" << std::endl;
+    std::cerr << "         --noise:     standard deviation of the range noise in m (default: 0.01)" << std::endl;
+    std::cerr << "         --dropout:   probability for a sample without return (default: 0.01)" << std::endl;
+    std::cerr << "         --seed:      seed for obstacles and noise (default: 0)" << std::endl;
+    std::cerr << "         --faults:    inject faults into the stream; one of none, drops, bitflips, duplicates, stalls, bursts, usb" << std::endl;
+    std::cerr << "                      or a list like drop=0.001,flip=0.0001,dup=0.01,stall=0.01:<ms>,burst=0.05:<chunks>" << std::endl;
+    std::cerr << "         --model:     model to report; A2 and A3 accept SET_MOTOR_PWM (default: A1)" << std::endl;
+    std::cerr << "         --benchmark: connect the RPLidar driver to the emulator and report time to first scan, throughput, and latency" << std::endl;
+    std::cerr << "         --rpm:       let the driver hold this motor speed during the benchmark (default: 0 = off)" << std::endl;
+    std::cerr << "Example: " << argv[0] << " --freq=10 --samples=720" << std::endl;
+  }
+  else {
+    const float FREQ{(commandlineArguments.count("freq") != 0) ? std::stof(commandlineArguments["freq"]) : 10.0f};
+    const uint32_t SAMPLES{(commandlineArguments.count("samples") != 0) ? static_cast<uint32_t>(std::stoi(commandlineArguments["samples"])) : 720};
+    const std::string MAP{(commandlineArguments.count("map") != 0) ? commandlineArguments["map"] : ""};
+    const uint32_t OBSTACLES{(commandlineArguments.count("obstacles") != 0) ? static_cast<uint32_t>(std::stoi(commandlineArguments["obstacles"])) : 0};
+    const float NOISE{(commandlineArguments.count("noise") != 0) ? std::stof(commandlineArguments["noise"]) : 0.01f};
+    const float DROPOUT{(commandlineArguments.count("dropout") != 0) ? std::stof(commandlineArguments["dropout"]) : 0.01f};
+    const uint32_t SEED{(commandlineArguments.count("seed") != 0) ? static_cast<uint32_t>(std::stoul(commandlineArguments["seed"])) : 0};
+    const std::string FAULTS{(commandlineArguments.count("faults") != 0) ? commandlineArguments["faults"] : ""};
+    const std::string MODEL{(commandlineArguments.count("model") != 0) ? commandlineArguments["model"] : "A1"};
+    const float RPM{(commandlineArguments.count("rpm") != 0) ? std::stof(commandlineArguments["rpm"]) : 0.0f};
+    const uint32_t BENCHMARK{(commandlineArguments.count("benchmark") != 0) ? static_cast<uint32_t>(std::stoi(commandlineArguments["benchmark"])) : 0};
+
+    std::signal(SIGINT, stop);
+    std::signal(SIGTERM, stop);
+
+    ScanSynthesizer synthesizer{MAP.empty() ? ScanSynthesizer::defaultRoom(SEED, FREQ) : ScanSynthesizer(SEED, FREQ)};
+    if (!MAP.empty() && !synthesizer.loadMap(MAP)) {
+      std::cerr << "[opendlv-device-lidar-rplidar-emulator]: Failed to load map from " << MAP << std::endl;
+      return retCode;
+    }
+    {
+      ScanSynthesizer::NoiseModel noiseModel;
+      noiseModel.sigma = NOISE;
+      noiseModel.dropoutProbability = DROPOUT;
+      synthesizer.setNoiseModel(noiseModel);
+
+      // Obstacles start around the sensor and move back and forth on straight lines.
+      std::mt19937 generator(SEED);
+      for (uint32_t i{0}; i < OBSTACLES; i++) {
+        ScanSynthesizer::Obstacle obstacle;
+        obstacle.position.x = static_cast<float>(generator() % 600) / 100.0f - 3.0f;
+        obstacle.position.y = static_cast<float>(generator() % 400) / 100.0f - 2.0f;
+        obstacle.velocity.x = static_cast<float>(generator() % 200) / 100.0f - 1.0f;
+        obstacle.velocity.y = static_cast<float>(generator() % 200) / 100.0f - 1.0f;
+        obstacle.radius = 0.1f + static_cast<float>(generator() % 30) / 100.0f;
+        obstacle.period = 4.0f;
+        synthesizer.addObstacle(obstacle);
+      }
+    }
+
+    FaultInjector::Profile faultProfile;
+    if (!FAULTS.empty() && !FaultInjector::parseProfile(FAULTS, faultProfile)) {
+      std::cerr << "[opendlv-device-lidar-rplidar-emulator]: Invalid fault profile " << FAULTS << std::endl;
+      return retCode;
+    }
+
+    RPLidarEmulator emulator(FREQ, SAMPLES);
+    emulator.setModel(("A3" == MODEL) ? RPLidarEmulator::MODEL_A3 : (("A2" == MODEL) ? RPLidarEmulator::MODEL_A2 : RPLidarEmulator::MODEL_A1));
+    if (!FAULTS.empty()) {
+      emulator.setFaultProfile(faultProfile, SEED);
+    }
+    emulator.setScanGenerator([&synthesizer](uint32_t scanIndex, uint32_t samplesPerScan, std::vector<uint8_t> &nodes){
+      synthesizer.synthesize(scanIndex, samplesPerScan, nodes);
+    });
+    if (emulator.isOpen()) {
+      std::clog << "[opendlv-device-lidar-rplidar-emulator]: Emulating RPlidar with " << SAMPLES << " samples at " << FREQ << " Hz on " << emulator.getDeviceName() << std::endl;
+      if (0 < BENCHMARK) {
+        benchmark(emulator, BENCHMARK, RPM / 60.0f);
+      }
+      else {
+        // Endless loop; end the program by pressing Ctrl-C.
+        while (g_running) {
+          std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        }
+      }
+      retCode = 0;
+    }
+    else {
+      std::cerr << "[opendlv-device-lidar-rplidar-emulator]: Failed to open pseudo terminal" << std::endl;
+    }
+  }
+  return retCode;
+}
@@ -0,0 +1,174 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "cluon-complete.hpp"
+
+#include "opendlv-standard-message-set.hpp"
+#include "rplidar-message-set.hpp"
+#include "byte-capture.hpp"
+#include "decode-buffer.hpp"
+#include "fault-injector.hpp"
+#include "latency-tracer.hpp"
+#include "rplidar-decoder.hpp"
+#include "scan-options.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+
+int32_t main(int32_t argc, char **argv) {
+  int32_t retCode{1};
+  auto commandlineArguments = cluon::getCommandlineArguments(argc, argv);
+  if ( (0 == commandlineArguments.count("cid")) ||
+       (0 == commandlineArguments.count("capture")) ) {
+    std::cerr << argv[0] << " replays bytes recorded with --capture through the RPlidar decoder to provide opendlv.proxy.PointCloudReading messages." << std::endl;
+    std::cerr << "Usage:   " << argv[0] << " --cid=<OD4 session> --capture=<file> [--id=<n>] [--speed=<factor>] " << ScanOptions::synopsis() << " [--faults=<profile>] [--verbose]" << std::endl;
+    std::cerr << "         --cid:     CID of the OD4Session to send messages to" << std::endl;
+    std::cerr << "         --capture: file recorded by opendlv-device-lidar-rplidar --capture for one device" << std::endl;
+    std::cerr << "         --id:      sender stamp to send the messages with, e.g., the --id the capture was recorded with (default: 0)" << std::endl;
+    std::cerr << "         --speed:   0 = as fast as possible, 1 = original timing, N = N times faster (default: 1)" << std::endl;
+    std::cerr << ScanOptions::usage();
+    std::cerr << "         --faults:  inject faults in front of the decoder; one of none, drops, bitflips, duplicates, stalls, bursts, usb" << std::endl;
+    std::cerr << "                    or a list like drop=0.001,flip=0.0001,dup=0.01,stall=0.01:<ms>,burst=0.05:<chunks>" << std::endl;
+    std::cerr << "Example: " << argv[0] << " --cid=111 --capture=rplidar.rec --speed=0 --verbose" << std::endl;
+  }
+  else {
+    const std::string CAPTURE{commandlineArguments["capture"]};
+    const double SPEED{(commandlineArguments.count("speed") != 0) ? std::stod(commandlineArguments["speed"]) : 1.0};
+    const uint32_t ID{(commandlineArguments.count("id") != 0) ? static_cast<uint32_t>(std::stoul(commandlineArguments["id"])) : 0};
+    const std::string FAULTS{(commandlineArguments.count("faults") != 0) ? commandlineArguments["faults"] : ""};
+    const bool VERBOSE{commandlineArguments.count("verbose") != 0};
+    ScanOptions options;
+    std::string error;
+    if (!options.parse(commandlineArguments, 1, error)) {
+      std::cerr << "[opendlv-device-lidar-rplidar-replay]: " << error << std::endl;
+      return retCode;
+    }
+    if (!options.warning().empty()) {
+      std::cerr << "[opendlv-device-lidar-rplidar-replay]: " << options.warning() << std::endl;
+    }
+
+    ByteCaptureReader reader(CAPTURE);
+    if (reader.isOpen()) {
+      cluon::OD4Session od4{static_cast<uint16_t>(std::stoi(commandlineArguments["cid"]))};
+
+      uint64_t scans{0};
+      uint64_t samples{0};
+      LatencyTracer latencyTracer;
+      RPLidarDecoder decoder;
+      decoder.setLatencyTracer(&latencyTracer);
+      decoder.setDelegates(nullptr, nullptr, [&od4, &options, &scans, &samples, &latencyTracer, ID](const opendlv::proxy::PointCloudReading &pc){
+        scans++;
+        samples += pc.distances().size()/4;
+        if (options.linesOnly) {
+          return;
+        }
+        latencyTracer.mark(LatencyTracer::SERIALIZATION_START);
+        opendlv::proxy::PointCloudReading msg{pc};
+        od4.send(msg, cluon::time::now(), ID);
+        latencyTracer.mark(LatencyTracer::UDP_SEND);
+      });
+      if (!options.apply(decoder, 0, od4, ID)) {
+        std::cerr << "[opendlv-device-lidar-rplidar-replay]: Invalid --pipeline=" << options.pipeline << std::endl;
+        return retCode;
+      }
+
+      // Same buffering as RPLidar; where the driver would stop reading and
+      // reconnect, which drops the buffered bytes, the replay drops them and
+      // goes on.
+      DecodeBuffer buffer(DecodeBuffer::DISCARD_ON_OVERFLOW);
+
+      uint64_t bytes{0};
+      uint64_t records{0};
+      std::chrono::nanoseconds timeInDecoder{0};
+
+      // Pacing and decoding of one chunk; faults are injected in front of it if requested.
+      bool firstChunk{true};
+      int64_t firstTimeStamp{0};
+      const auto start{std::chrono::steady_clock::now()};
+      auto process = [&](const uint8_t *chunk, size_t chunkSize, int64_t timeStamp){
+        if (firstChunk) {
+          firstTimeStamp = timeStamp;
+          firstChunk = false;
+        }
+        if (0.0 < SPEED) {
+          const auto due{start + std::chrono::nanoseconds(static_cast<int64_t>(static_cast<double>(timeStamp - firstTimeStamp) / SPEED))};
+          std::this_thread::sleep_until(due);
+        }
+
+        // Latencies start when the chunk is handed to the decoder as the
+        // recorded time stamps stem from a different clock domain.
+        latencyTracer.mark(LatencyTracer::SERIAL_READ);
+        const auto beforeDecode{std::chrono::steady_clock::now()};
+        buffer.feed(decoder, chunk, chunkSize);
+        timeInDecoder += std::chrono::steady_clock::now() - beforeDecode;
+      };
+
+      std::unique_ptr<FaultInjector> faultInjector{nullptr};
+      if (!FAULTS.empty()) {
+        FaultInjector::Profile profile;
+        if (!FaultInjector::parseProfile(FAULTS, profile)) {
+          std::cerr << "[opendlv-device-lidar-rplidar-replay]: Invalid fault profile " << FAULTS << std::endl;
+          return retCode;
+        }
+        faultInjector.reset(new FaultInjector(profile));
+        faultInjector->setDelegate(process);
+      }
+
+      int64_t timeStamp{0};
+      const uint8_t *chunk{nullptr};
+      size_t chunkSize{0};
+      while (od4.isRunning() && reader.next(timeStamp, chunk, chunkSize)) {
+        records++;
+        bytes += chunkSize;
+        if (faultInjector) {
+          faultInjector->inject(chunk, chunkSize, timeStamp);
+        }
+        else {
+          process(chunk, chunkSize, timeStamp);
+        }
+      }
+      if (faultInjector) {
+        faultInjector->flush();
+        std::clog << "[opendlv-device-lidar-rplidar-replay]: Injected faults: " << faultInjector->bytesDropped() << " bytes dropped, " << faultInjector->bitsFlipped() << " bits flipped, " << faultInjector->chunksDuplicated() << " chunks duplicated, " << faultInjector->stalls() << " stalls, " << faultInjector->bursts() << " bursts." << std::endl;
+      }
+      if (0 < buffer.discarded()) {
+        std::clog << "[opendlv-device-lidar-rplidar-replay]: Dropped " << buffer.discarded() << " bytes the decoder did not make progress on; the driver would have reconnected." << std::endl;
+      }
+      const double elapsed{std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count()};
+      const double decoding{std::chrono::duration<double>(timeInDecoder).count()};
+
+      std::clog << "[opendlv-device-lidar-rplidar-replay]: Replayed " << records << " chunks with " << bytes << " bytes resulting in " << scans << " scans with " << samples << " samples in " << elapsed << " s." << std::endl;
+      if (0.0 < decoding) {
+        std::clog << "[opendlv-device-lidar-rplidar-replay]: Decode throughput: " << static_cast<double>(bytes) / decoding / (1024.0 * 1024.0) << " MiB/s, " << static_cast<double>(samples) / decoding << " samples/s, " << static_cast<double>(scans) / decoding << " scans/s (" << decoding << " s in decode including publishing)." << std::endl;
+      }
+      if (VERBOSE && (0.0 < elapsed)) {
+        std::clog << "[opendlv-device-lidar-rplidar-replay]: Wall clock throughput: " << static_cast<double>(bytes) / elapsed / (1024.0 * 1024.0) << " MiB/s, " << static_cast<double>(scans) / elapsed << " scans/s." << std::endl;
+        std::clog << "[opendlv-device-lidar-rplidar-replay]: Latencies " << latencyTracer.toString() << std::endl;
+        std::clog << "[opendlv-device-lidar-rplidar-replay]: Pipeline " << decoder.getPipelineStatistics() << std::endl;
+      }
+      retCode = 0;
+    }
+    else {
+      std::cerr << "[opendlv-device-lidar-rplidar-replay]: Failed to open " << CAPTURE << std::endl;
+    }
+  }
+  return retCode;
+}
@@ -19,63 +19,336 @@
 
 #include "opendlv-standard-message-set.hpp"
 #include "rplidar-message-set.hpp"
+#include "io-loop.hpp"
 #include "rplidar.hpp"
+#include "scan-merger.hpp"
+#include "scan-options.hpp"
+#include "scan-publisher.hpp"
 
+#include <chrono>
 #include <cstdint>
 #include <iomanip>
 #include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+struct Device {
+  std::string name{};
+  uint32_t senderStamp{0};
+  std::unique_ptr<RPLidar> rplidar{nullptr};
+  // Requests, health checks, and the watchdog stop and resume scanning; run one at a time.
+  std::mutex scanningMutex{};
+};
+}
 
 int32_t main(int32_t argc, char **argv) {
   int32_t retCode{1};
   auto commandlineArguments = cluon::getCommandlineArguments(argc, argv);
   if ( (0 == commandlineArguments.count("cid")) ||
        (0 == commandlineArguments.count("device")) ) {
-    std::cerr << argv[0] << " connects to an RPlidar device to provide opendlv.proxy.PointCloudReading messages." << std::endl;
-    std::cerr << "Usage:   " << argv[0] << " --cid=<OD4 session> --device=<serial port to open> [--verbose]" << std::endl;
-    std::cerr << "         --cid:    CID of the OD4Session to send and receive messages" << std::endl;
-    std::cerr << "         --device: serial port where the RPlidar is attached to" << std::endl;
-    std::cerr << "Example: " << argv[0] << " --cid=111 --device=/dev/ttyUSB0 --verbose" << std::endl;
+    std::cerr << argv[0] << " connects to one or more RPlidar devices to provide opendlv.proxy.PointCloudReading messages." << std::endl;
+    std::cerr << "Usage:   " << argv[0] << " --cid=<OD4 session> --device=<serial port to open> [--device=<serial port> ...] [--id=<n>[,<n>...]] [--capture=<file>] [--rpm=<n>] [--statistics=<Hz>] [--health=<s>] [--watchdog=<ms>] " << ScanOptions::synopsis() << " [--merge=<ms>] [--extrinsics=<x:y:yaw>[,<x:y:yaw>...]] [--deskew] [--verbose]" << std::endl;
+    std::cerr << "         --cid:     CID of the OD4Session to send and receive messages; opendlv.device.lidar.rplidar.ScanRequest reconfigures scanning at runtime" << std::endl;
+    std::cerr << "         --device:  serial port where the RPlidar is attached to; repeat or separate by commas for several devices served from one thread" << std::endl;
+    std::cerr << "         --id:      sender stamps per device in the order of --device; ScanRequests are matched by sender stamp (default: 0, 1, ...)" << std::endl;
+    std::cerr << "         --capture: record all bytes received from the RPlidar with monotonic time stamps to the given file; with several devices, .<id> is appended" << std::endl;
+    std::cerr << "         --rpm:     hold the motor at this speed (A2/A3 only; default: 0 = as configured by the hardware)" << std::endl;
+    std::cerr << "         --statistics: rate to send opendlv.device.lidar.rplidar.DriverStatistics at (default: 1; 0 = off)" << std::endl;
+    std::cerr << "         --health:  interval to briefly stop scanning and query the health at; a device in error state is reset (default: 60; 0 = off)" << std::endl;
+    std::cerr << "         --watchdog: reopen the serial port and restart scanning when no scan was completed for this long (default: 2000; 0 = off)" << std::endl;
+    std::cerr << ScanOptions::usage();
+    std::cerr << "         --merge:   additionally send the latest scans of all devices as one opendlv.device.lidar.rplidar.MergedPointCloud with this period, also with --lines-only (default: 0 = off)" << std::endl;
+    std::cerr << "         --extrinsics: pose of every device in the vehicle frame in the order of --device for merging only; x and y in m, yaw in degree counterclockwise (default: 0:0:0; leave out with --mount-*)" << std::endl;
+    std::cerr << "         --deskew:  move merged samples by the vehicle motion from opendlv.proxy.GroundSpeedReading and AngularVelocityReading (z in rad/s)" << std::endl;
+    std::cerr << "         --verbose: print received messages and, every 10 s, statistics and latencies from reading bytes to sending scans" << std::endl;
+    std::cerr << "Example: " << argv[0] << " --cid=111 --device=/dev/ttyUSB0 --sectors=16 --verbose" << std::endl;
+    std::cerr << "         " << argv[0] << " --cid=111 --device=/dev/ttyUSB0 --device=/dev/ttyUSB1 --id=1,2" << std::endl;
+    std::cerr << "         " << argv[0] << " --cid=111 --device=/dev/ttyUSB0,/dev/ttyUSB1 --merge=100 --extrinsics=1.2:0:0,-0.8:0:180 --deskew" << std::endl;
   }
   else {
-    const std::string DEVICE{commandlineArguments["device"]};
+    // cluon keeps the last of repeated arguments only.
+    std::vector<std::string> deviceNames;
+    for (int32_t i{1}; i < argc; i++) {
+      const std::string argument{argv[i]};
+      const std::string DEVICE_ARGUMENT{"--device="};
+      if (0 == argument.find(DEVICE_ARGUMENT)) {
+        for (const auto &name : ScanOptions::split(argument.substr(DEVICE_ARGUMENT.size()))) {
+          deviceNames.push_back(name);
+        }
+      }
+    }
+    const std::vector<std::string> IDS{(commandlineArguments.count("id") != 0) ? ScanOptions::split(commandlineArguments["id"]) : std::vector<std::string>()};
+    const std::string CAPTURE{(commandlineArguments.count("capture") != 0) ? commandlineArguments["capture"] : ""};
+    const float RPM{(commandlineArguments.count("rpm") != 0) ? std::stof(commandlineArguments["rpm"]) : 0.0f};
+    const float STATISTICS{(commandlineArguments.count("statistics") != 0) ? std::stof(commandlineArguments["statistics"]) : 1.0f};
+    const uint32_t HEALTH{(commandlineArguments.count("health") != 0) ? static_cast<uint32_t>(std::stoi(commandlineArguments["health"])) : 60};
+    const uint32_t WATCHDOG{(commandlineArguments.count("watchdog") != 0) ? static_cast<uint32_t>(std::stoi(commandlineArguments["watchdog"])) : 2000};
+    const uint32_t MERGE{(commandlineArguments.count("merge") != 0) ? static_cast<uint32_t>(std::stoi(commandlineArguments["merge"])) : 0};
+    const std::vector<std::string> EXTRINSICS{(commandlineArguments.count("extrinsics") != 0) ? ScanOptions::split(commandlineArguments["extrinsics"]) : std::vector<std::string>()};
+    const bool DESKEW{commandlineArguments.count("deskew") != 0};
     const bool VERBOSE{commandlineArguments.count("verbose") != 0};
+    ScanOptions options;
+    std::string error;
+    if (!options.parse(commandlineArguments, deviceNames.size(), error)) {
+      std::cerr << "[opendlv-device-lidar-rplidar]: " << error << std::endl;
+      return retCode;
+    }
+    if (!options.warning().empty()) {
+      std::cerr << "[opendlv-device-lidar-rplidar]: " << options.warning() << std::endl;
+    }
 
-    RPLidar rplidar(DEVICE);
-    if (rplidar.isOpen()) {
-      // Interface to a running OpenDaVINCI session; here, you can send and receive messages.
-      cluon::OD4Session od4{static_cast<uint16_t>(std::stoi(commandlineArguments["cid"]))};
+    std::vector<ScanMerger::Extrinsics> extrinsics(deviceNames.size());
+    for (size_t i{0}; (i < EXTRINSICS.size()) && (i < extrinsics.size()); i++) {
+      if (!ScanMerger::parseExtrinsics(EXTRINSICS[i], extrinsics[i])) {
+        std::cerr << "[opendlv-device-lidar-rplidar]: Invalid extrinsics " << EXTRINSICS[i] << std::endl;
+        return retCode;
+      }
+    }
 
-      auto deviceInfo = [VERBOSE](const opendlv::device::lidar::rplidar::DeviceInfo &di){
-        if (VERBOSE) {
-          std::clog << "[opendlv-device-lidar-rplidar]: model: " << +(di.model()) << ", firmware_major: " << +(di.firmware_major()) << ", firmware_minor: " << +(di.firmware_minor()) << ", hardware: " << +(di.hardware()) << ", hardware: 0x" << std::hex << di.serialNumber0() << " 0x" << di.serialNumber1() << " 0x" << di.serialNumber2() << " 0x" << di.serialNumber3() << std::dec << std::endl;
-        }
+    // Several devices share one thread reading from all serial ports and
+    // one thread sending all scans. Decoding and the scan pipeline of all
+    // devices run on the reading thread; hence, costly stages like --grid
+    // or --odometry on several devices may exceed one rotation together.
+    const bool SHARED{1 < deviceNames.size()};
+    std::unique_ptr<IoLoop> ioLoop{SHARED ? new IoLoop() : nullptr};
+
+    std::vector<std::unique_ptr<Device>> devices;
+    for (size_t i{0}; i < deviceNames.size(); i++) {
+      std::unique_ptr<Device> device{new Device()};
+      device->name = deviceNames[i];
+      device->senderStamp = (i < IDS.size()) ? static_cast<uint32_t>(std::stoul(IDS[i])) : static_cast<uint32_t>(i);
+      const std::string capture{(CAPTURE.empty() || !SHARED) ? CAPTURE : CAPTURE + "." + std::to_string(device->senderStamp)};
+      device->rplidar.reset(new RPLidar(device->name, capture, ioLoop.get()));
+      if (!device->rplidar->isOpen()) {
+        std::cerr << "[opendlv-device-lidar-rplidar]: Failed to open " << device->name << std::endl;
+        return retCode;
+      }
+      if (!capture.empty() && !device->rplidar->isCapturing()) {
+        std::cerr << "[opendlv-device-lidar-rplidar]: Failed to open " << capture << " for capturing" << std::endl;
+      }
+      devices.push_back(std::move(device));
+    }
+
+    // Interface to a running OpenDaVINCI session; here, you can send and receive messages.
+    cluon::OD4Session od4{static_cast<uint16_t>(std::stoi(commandlineArguments["cid"]))};
+
+    std::unique_ptr<ScanPublisher> publisher{nullptr};
+    if (SHARED) {
+      publisher.reset(new ScanPublisher([&od4](opendlv::proxy::PointCloudReading &pc, uint32_t senderStamp){
+        od4.send(pc, cluon::time::now(), senderStamp);
+      }));
+    }
+
+    // Scans count towards a merge for up to one period plus a rotation at 5 Hz.
+    std::unique_ptr<ScanMerger> merger{nullptr};
+    if (0 < MERGE) {
+      merger.reset(new ScanMerger(extrinsics, std::chrono::milliseconds(MERGE + 200), [&od4](opendlv::device::lidar::rplidar::MergedPointCloud &mpc, int64_t){
+        od4.send(mpc, cluon::time::now(), 0);
+      }));
+      merger->setDeskew(DESKEW);
+      if (DESKEW) {
+        od4.dataTrigger(opendlv::proxy::GroundSpeedReading::ID(), [&merger](cluon::data::Envelope &&env){
+          const opendlv::proxy::GroundSpeedReading gsr{cluon::extractMessage<opendlv::proxy::GroundSpeedReading>(std::move(env))};
+          merger->setVelocity(gsr.groundSpeed(), 0.0f);
+        });
+        od4.dataTrigger(opendlv::proxy::AngularVelocityReading::ID(), [&merger](cluon::data::Envelope &&env){
+          const opendlv::proxy::AngularVelocityReading avr{cluon::extractMessage<opendlv::proxy::AngularVelocityReading>(std::move(env))};
+          merger->setYawRate(avr.angularVelocityZ());
+        });
+      }
+    }
+
+    auto deviceInfo = [VERBOSE](const opendlv::device::lidar::rplidar::DeviceInfo &di){
+      if (VERBOSE) {
+        std::clog << "[opendlv-device-lidar-rplidar]: model: " << +(di.model()) << ", firmware_major: " << +(di.firmware_major()) << ", firmware_minor: " << +(di.firmware_minor()) << ", hardware: " << +(di.hardware()) << ", hardware: 0x" << std::hex << di.serialNumber0() << " 0x" << di.serialNumber1() << " 0x" << di.serialNumber2() << " 0x" << di.serialNumber3() << std::dec << std::endl;
+      }
+    };
+
+    auto deviceHealth = [VERBOSE](const opendlv::device::lidar::rplidar::DeviceHealth &dh){
+      if (VERBOSE) {
+        std::clog << "[opendlv-device-lidar-rplidar]: status: " << +(dh.status()) << ", error_code: " << +(dh.error_code()) << std::endl;
+      }
+    };
+
+    auto sectorMinDistance = [&od4](uint32_t senderStamp){
+      return [&od4, senderStamp](const opendlv::device::lidar::rplidar::SectorMinDistance &smd){
+        opendlv::device::lidar::rplidar::SectorMinDistance msg{smd};
+        od4.send(msg, cluon::time::now(), senderStamp);
       };
+    };
+
+    // The handshakes take more than a second each; run them concurrently.
+    {
+      std::vector<std::thread> handshakes;
+      for (uint32_t i{0}; i < devices.size(); i++) {
+        RPLidar &rplidar{*devices[i]->rplidar};
+        const uint32_t senderStamp{devices[i]->senderStamp};
+        LatencyTracer &latencyTracer{rplidar.getLatencyTracer()};
+        auto completeScan = [VERBOSE, &options, &od4, &rplidar, &latencyTracer, &publisher, &merger, senderStamp, i](const opendlv::proxy::PointCloudReading &pc){
+          if (merger) {
+            merger->addScan(i, pc, LatencyTracer::now(), rplidar.getScanFrequency());
+          }
+          if (options.linesOnly) {
+            return;
+          }
+          if (publisher) {
+            publisher->publish(pc, senderStamp, &latencyTracer);
+          }
+          else {
+            latencyTracer.mark(LatencyTracer::SERIALIZATION_START);
+            opendlv::proxy::PointCloudReading msg{pc};
+            od4.send(msg, cluon::time::now(), senderStamp);
+            latencyTracer.mark(LatencyTracer::UDP_SEND);
+          }
+          if (VERBOSE) {
+            std::clog << "[opendlv-device-lidar-rplidar]: Sending point cloud " << senderStamp << " with " << pc.distances().size()/4 << " distances starting at angle " << pc.startAzimuth() << std::endl;
+          }
+        };
 
-      auto deviceHealth = [VERBOSE](const opendlv::device::lidar::rplidar::DeviceHealth &dh){
-        if (VERBOSE) {
-          std::clog << "[opendlv-device-lidar-rplidar]: status: " << +(dh.status()) << ", error_code: " << +(dh.error_code()) << std::endl;
+        rplidar.setTargetScanFrequency(RPM / 60.0f);
+        if (!options.apply(rplidar, i, od4, senderStamp)) {
+          std::cerr << "[opendlv-device-lidar-rplidar]: Invalid --pipeline=" << options.pipeline << std::endl;
         }
-      };
+        handshakes.emplace_back([&rplidar, deviceInfo, deviceHealth, completeScan](){
+          rplidar.startScanning(deviceInfo, deviceHealth, completeScan);
+        });
+      }
+      for (auto &handshake : handshakes) {
+        handshake.join();
+      }
+    }
+    for (auto &device : devices) {
+      if ( (0.0f < RPM) && !device->rplidar->hasMotorSpeedControl() ) {
+        std::cerr << "[opendlv-device-lidar-rplidar]: " << device->name << " does not support SET_MOTOR_PWM; ignoring --rpm" << std::endl;
+      }
+    }
 
-      auto completeScan = [VERBOSE, &od4](opendlv::proxy::PointCloudReading pc){
-        od4.send(pc);
-        if (VERBOSE) {
-          std::clog << "[opendlv-device-lidar-rplidar]: Sending point cloud with " << pc.distances().size()/4 << " distances starting at angle " << pc.startAzimuth() << std::endl;
+    if (merger) {
+      merger->start(std::chrono::milliseconds(MERGE));
+    }
+
+    // Reconfigure at runtime: stop scanning, apply the request, and resume.
+    auto onScanRequest = [&devices, &sectorMinDistance](cluon::data::Envelope &&env){
+      const uint32_t senderStamp{env.senderStamp()};
+      const opendlv::device::lidar::rplidar::ScanRequest request{cluon::extractMessage<opendlv::device::lidar::rplidar::ScanRequest>(std::move(env))};
+      for (auto &device : devices) {
+        if (senderStamp != device->senderStamp) {
+          continue;
         }
-      };
+        RPLidar &rplidar{*device->rplidar};
+        std::lock_guard<std::mutex> lck(device->scanningMutex);
+        const auto start{std::chrono::steady_clock::now()};
+        rplidar.stopScanning();
+        if (0 <= request.numberOfSectors()) {
+          rplidar.setSectorDelegate(static_cast<uint16_t>(request.numberOfSectors()), sectorMinDistance(senderStamp));
+        }
+        if (0.0f <= request.targetScanFrequency()) {
+          rplidar.setTargetScanFrequency(request.targetScanFrequency());
+        }
+        if (1 == request.command()) {
+          std::clog << "[opendlv-device-lidar-rplidar]: Stopped scanning " << device->name << " on request" << std::endl;
+        }
+        else if (rplidar.resumeScanning()) {
+          std::clog << "[opendlv-device-lidar-rplidar]: Restarted scanning " << device->name << " on request after " << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() << " ms" << std::endl;
+        }
+        else {
+          std::cerr << "[opendlv-device-lidar-rplidar]: Failed to restart scanning " << device->name << " on request" << std::endl;
+        }
+      }
+    };
+    od4.dataTrigger(opendlv::device::lidar::rplidar::ScanRequest::ID(), onScanRequest);
 
-      rplidar.startScanning(deviceInfo, deviceHealth, completeScan);
+    // Watchdog for stalled scans, e.g., after the USB adapter hiccupped.
+    std::unique_ptr<std::thread> watchdog{nullptr};
+    if (0 < WATCHDOG) {
+      watchdog.reset(new std::thread([&od4, &devices, WATCHDOG](){
+        const std::chrono::milliseconds DEADLINE{WATCHDOG};
+        while (od4.isRunning()) {
+          std::this_thread::sleep_for(DEADLINE / 4);
+          for (auto &device : devices) {
+            RPLidar &rplidar{*device->rplidar};
+            std::lock_guard<std::mutex> lck(device->scanningMutex);
+            if (rplidar.isStalled(DEADLINE)) {
+              std::cerr << "[opendlv-device-lidar-rplidar]: No scan from " << device->name << " for " << DEADLINE.count() << " ms; reconnecting" << std::endl;
+              if (rplidar.reconnect()) {
+                std::cerr << "[opendlv-device-lidar-rplidar]: Scanning " << device->name << " again after " << rplidar.getStatistics().recoveryTime() << " ms" << std::endl;
+              }
+              else {
+                std::cerr << "[opendlv-device-lidar-rplidar]: Failed to reconnect " << device->name << "; retrying" << std::endl;
+              }
+            }
+          }
+        }
+      }));
+    }
 
-      // Endless loop; end the program by pressing Ctrl-C.
-      while (od4.isRunning()) {
-        std::this_thread::sleep_for(std::chrono::seconds(1));
+    // Endless loop; end the program by pressing Ctrl-C.
+    const std::chrono::microseconds PERIOD{static_cast<int64_t>(1e6f / ((0.0f < STATISTICS) ? STATISTICS : 1.0f))};
+    const std::chrono::seconds LATENCY_REPORT_INTERVAL{10};
+    auto nextLatencyReport{std::chrono::steady_clock::now() + LATENCY_REPORT_INTERVAL};
+    const std::chrono::seconds HEALTH_CHECK_INTERVAL{HEALTH};
+    auto nextHealthCheck{std::chrono::steady_clock::now() + HEALTH_CHECK_INTERVAL};
+    while (od4.isRunning()) {
+      std::this_thread::sleep_for(PERIOD);
+      const bool checkHealth{(0 < HEALTH) && (std::chrono::steady_clock::now() >= nextHealthCheck)};
+      if (checkHealth) {
+        nextHealthCheck = std::chrono::steady_clock::now() + HEALTH_CHECK_INTERVAL;
       }
-      retCode = 0;
+      const bool report{VERBOSE && (std::chrono::steady_clock::now() >= nextLatencyReport)};
+      if (report) {
+        nextLatencyReport += LATENCY_REPORT_INTERVAL;
+      }
+      for (auto &device : devices) {
+        RPLidar &rplidar{*device->rplidar};
+        if (checkHealth) {
+          std::lock_guard<std::mutex> lck(device->scanningMutex);
+          const uint64_t resets{rplidar.getStatistics().deviceResets()};
+          const int8_t status{rplidar.checkHealth()};
+          const opendlv::device::lidar::rplidar::DriverStatistics statistics{rplidar.getStatistics()};
+          if (resets != statistics.deviceResets()) {
+            std::cerr << "[opendlv-device-lidar-rplidar]: " << device->name << " reported health status " << +status << "; reset and restarted scanning after " << statistics.healthCheckGap() / 1000.0 << " ms" << std::endl;
+          }
+          else if (VERBOSE || (0 != status)) {
+            std::clog << "[opendlv-device-lidar-rplidar]: Health status of " << device->name << " " << +status << ", scanning interrupted for " << statistics.healthCheckGap() / 1000.0 << " ms" << std::endl;
+          }
+        }
+        if (0.0f < STATISTICS) {
+          opendlv::device::lidar::rplidar::DriverStatistics statistics{rplidar.getStatistics()};
+          od4.send(statistics, cluon::time::now(), device->senderStamp);
+        }
+        if (report) {
+          const opendlv::device::lidar::rplidar::DriverStatistics statistics{rplidar.getStatistics()};
+          std::clog << "[opendlv-device-lidar-rplidar]: " << device->name << ": Received " << statistics.bytesReceived() << " bytes, discarded " << statistics.bytesDiscarded() << " bytes, " << statistics.invalidNodes() << " invalid nodes, " << statistics.resyncs() << " resyncs, " << statistics.scansEmitted() << " scans at " << statistics.scanFrequency() << " Hz (PWM " << statistics.motorPwm() << ") with " << statistics.samplesPerScan() << " samples, " << statistics.samplesFiltered() << " samples filtered, " << statistics.invalidRatio() * 100.0f << "% without return, " << statistics.outliersRemoved() << " outliers removed, " << statistics.samplesDownsampled() << " samples downsampled, " << statistics.publishesDropped() << " publishes dropped" << std::endl;
+          std::clog << "[opendlv-device-lidar-rplidar]: " << device->name << ": Latencies " << rplidar.getLatencyTracer().toString() << std::endl;
+          std::clog << "[opendlv-device-lidar-rplidar]: " << device->name << ": Pipeline " << rplidar.getPipelineStatistics() << std::endl;
+        }
+      }
+      if (report && publisher) {
+        std::clog << "[opendlv-device-lidar-rplidar]: Published " << publisher->published() << " scans from the shared queue, " << publisher->dropped() << " dropped" << std::endl;
+      }
+      if (report && merger) {
+        std::clog << "[opendlv-device-lidar-rplidar]: Merged " << merger->merges() << " times, latest merge took " << merger->mergeDuration() << " us, " << merger->overruns() << " merges took longer than " << MERGE << " ms" << std::endl;
+      }
+    }
+    if (watchdog) {
+      watchdog->join();
     }
-    else {
-      std::cerr << "[opendlv-device-lidar-rplidar]: Failed to open " << DEVICE << std::endl;
+    // Unregister the triggers referring to devices and merger first.
+    od4.dataTrigger(opendlv::device::lidar::rplidar::ScanRequest::ID(), nullptr);
+    od4.dataTrigger(opendlv::proxy::GroundSpeedReading::ID(), nullptr);
+    od4.dataTrigger(opendlv::proxy::AngularVelocityReading::ID(), nullptr);
+    // Send the queued scans while their devices' tracers still exist, then
+    // stop the devices before the loop, the publisher, and the merger they use.
+    if (publisher) {
+      publisher->stop();
     }
+    devices.clear();
+    merger.reset();
+    retCode = 0;
   }
   return retCode;
 }
-
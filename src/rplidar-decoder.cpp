@@ -20,9 +20,38 @@
 #include "cluon-complete.hpp"
 #include "rplidar-decoder.hpp"
 
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
 #include <sstream>
 #include <string>
 
+constexpr const uint32_t RPLidarDecoder::MAX_SAMPLES_PER_SCAN;
+constexpr const uint32_t RPLidarDecoder::FULL_CIRCLE_Q6;
+
+RPLidarDecoder::RPLidarDecoder() noexcept {
+  m_angles.reserve(MAX_SAMPLES_PER_SCAN * sizeof(float));
+  m_distances.reserve(MAX_SAMPLES_PER_SCAN * sizeof(float));
+  // The generated setters copy-assign; a large string assigned once leaves
+  // enough capacity inside the message so that later scans do not allocate.
+  const std::string reserved(MAX_SAMPLES_PER_SCAN * sizeof(float), '\0');
+  m_pointCloudReading.distances(reserved).azimuthAngles(reserved);
+  m_validity.reserve(MAX_SAMPLES_PER_SCAN / 8);
+  m_scanValidity.validity(std::string(MAX_SAMPLES_PER_SCAN / 8, '\0'));
+}
+
+void RPLidarDecoder::leaveScanningMode() noexcept {
+  std::lock_guard<std::mutex> lck(m_dataMutex);
+  m_lastRPLidarMessage = RPLidarDecoder::UNKNOWN;
+  m_leaveScanningMode = true;
+}
+
+bool RPLidarDecoder::waitForMessage(RPLidarMessages message, std::chrono::milliseconds timeout) const noexcept {
+  std::unique_lock<std::mutex> lck(m_dataMutex);
+  return m_messageReceived.wait_for(lck, timeout, [this, message](){ return message == m_lastRPLidarMessage; });
+}
+
 RPLidarDecoder::RPLidarMessages RPLidarDecoder::getLastRPLidarMessage() const noexcept {
   std::lock_guard<std::mutex> lck(m_dataMutex);
   return m_lastRPLidarMessage;
@@ -38,32 +67,247 @@ opendlv::device::lidar::rplidar::DeviceHealth RPLidarDecoder::getDeviceHealth()
   return m_deviceHealth;
 }
 
+opendlv::device::lidar::rplidar::DriverStatistics RPLidarDecoder::getStatistics() const noexcept {
+  opendlv::device::lidar::rplidar::DriverStatistics statistics;
+  statistics.bytesDiscarded(m_bytesDiscarded.load(std::memory_order_relaxed))
+            .invalidNodes(m_invalidNodes.load(std::memory_order_relaxed))
+            .resyncs(m_resyncs.load(std::memory_order_relaxed))
+            .scansEmitted(m_scansEmitted.load(std::memory_order_relaxed))
+            .samplesPerScan(m_samplesPerScan.load(std::memory_order_relaxed))
+            .scanFrequency(m_scanFrequency.load(std::memory_order_relaxed))
+            .publishesDropped(m_publishesDropped.load(std::memory_order_relaxed))
+            .samplesFiltered(m_samplesFiltered.load(std::memory_order_relaxed))
+            .samplesInvalid(m_samplesInvalid.load(std::memory_order_relaxed))
+            .invalidRatio(m_invalidRatio.load(std::memory_order_relaxed))
+            .outliersRemoved(m_pipeline.statistics(Pipeline::indexOf<OutlierStage>()).samplesRemoved)
+            .samplesDownsampled(m_pipeline.statistics(Pipeline::indexOf<ResampleStage>()).samplesRemoved);
+  return statistics;
+}
+
+float RPLidarDecoder::getScanFrequency() const noexcept {
+  return m_scanFrequency.load(std::memory_order_relaxed);
+}
+
 void RPLidarDecoder::setDelegates(
     std::function<void(const opendlv::device::lidar::rplidar::DeviceInfo &)> delegateDeviceInfo,
     std::function<void(const opendlv::device::lidar::rplidar::DeviceHealth &)> delegateDeviceHealth,
-    std::function<void(opendlv::proxy::PointCloudReading pc)> delegateCompleteScan) {
+    std::function<void(const opendlv::proxy::PointCloudReading &)> delegateCompleteScan) {
   std::lock_guard<std::mutex> lck(m_dataMutex);
   m_delegateDeviceInfo = delegateDeviceInfo;
   m_delegateDeviceHealth = delegateDeviceHealth;
   m_delegateCompleteScan = delegateCompleteScan;
 }
 
+void RPLidarDecoder::setSectorDelegate(
+    uint16_t numberOfSectors,
+    std::function<void(const opendlv::device::lidar::rplidar::SectorMinDistance &)> delegateSectorMinDistance) {
+  std::lock_guard<std::mutex> lck(m_dataMutex);
+  m_pendingNumberOfSectors = numberOfSectors;
+  m_pendingDelegateSectorMinDistance = (0 < numberOfSectors) ? delegateSectorMinDistance : nullptr;
+  m_sectorsPending = true;
+}
+
+void RPLidarDecoder::setMount(float x, float y, float yaw, bool flip) noexcept {
+  // Azimuths are clockwise while the yaw is counterclockwise.
+  const float clockwise{std::fmod(360.0f - std::fmod(yaw, 360.0f), 360.0f)};
+  m_mountAngleQ6 = static_cast<uint16_t>(static_cast<uint32_t>(std::lround(clockwise * 64.0f)) % FULL_CIRCLE_Q6);
+  m_mountFlip = flip;
+  m_mountX = x;
+  m_mountY = y;
+  m_mountTranslation = (0.0f < std::fabs(x)) || (0.0f < std::fabs(y));
+}
+
+void RPLidarDecoder::setScanFilter(const ScanFilter::Config &config) noexcept {
+  m_pipeline.stage<MedianStage>().configure(config.medianWindow, MAX_SAMPLES_PER_SCAN);
+  m_pipeline.stage<OutlierStage>().configure(config.isolationDistance, MAX_SAMPLES_PER_SCAN);
+  m_scanBuffer.reserve(m_pipeline.enabled() ? MAX_SAMPLES_PER_SCAN : 0);
+}
+
+void RPLidarDecoder::setPointBudget(uint32_t budget) noexcept {
+  m_pipeline.stage<ResampleStage>().configure(budget);
+  m_scanBuffer.reserve(m_pipeline.enabled() ? MAX_SAMPLES_PER_SCAN : 0);
+}
+
+void RPLidarDecoder::setOdometry(const ScanMatcher::Config &config,
+    std::function<void(const opendlv::device::lidar::rplidar::ScanOdometry &)> delegateScanOdometry) noexcept {
+  if (nullptr == delegateScanOdometry) {
+    m_pipeline.stage<OdometryStage>().configure(config, MAX_SAMPLES_PER_SCAN, nullptr);
+  }
+  else {
+    m_pipeline.stage<OdometryStage>().configure(config, MAX_SAMPLES_PER_SCAN, [this, delegateScanOdometry](const ScanMatcher::Result &result, const ScanMatcher::Pose &pose){
+      m_scanOdometry.deltaX(result.delta.x)
+                    .deltaY(result.delta.y)
+                    .deltaYaw(result.delta.yaw)
+                    .x(pose.x)
+                    .y(pose.y)
+                    .yaw(pose.yaw)
+                    .correspondences(result.correspondences)
+                    .iterations(result.iterations)
+                    .residual(result.residual)
+                    .converged(result.converged);
+      delegateScanOdometry(m_scanOdometry);
+    });
+  }
+  m_scanBuffer.reserve(m_pipeline.enabled() ? MAX_SAMPLES_PER_SCAN : 0);
+}
+
+void RPLidarDecoder::setOccupancyGrid(const OccupancyGrid::Config &config, std::chrono::milliseconds snapshotPeriod,
+    std::function<void(const opendlv::device::lidar::rplidar::OccupancyGridSnapshot &)> delegateOccupancyGridSnapshot) noexcept {
+  if (nullptr == delegateOccupancyGridSnapshot) {
+    m_pipeline.stage<GridStage>().configure(config, snapshotPeriod, nullptr, nullptr);
+  }
+  else {
+    m_pipeline.stage<GridStage>().configure(config, snapshotPeriod, [this](){
+      return m_pipeline.stage<OdometryStage>().pose();
+    }, [this, delegateOccupancyGridSnapshot](const OccupancyGrid &grid, const ScanMatcher::Pose &pose){
+      grid.compress(m_gridCells);
+      m_occupancyGridSnapshot.originX(grid.originX())
+                             .originY(grid.originY())
+                             .resolution(grid.resolution())
+                             .width(grid.size())
+                             .height(grid.size())
+                             .cells(m_gridCells)
+                             .x(pose.x)
+                             .y(pose.y)
+                             .yaw(pose.yaw)
+                             .cellsUpdated(grid.cellsUpdated());
+      delegateOccupancyGridSnapshot(m_occupancyGridSnapshot);
+    });
+  }
+  m_scanBuffer.reserve(m_pipeline.enabled() ? MAX_SAMPLES_PER_SCAN : 0);
+}
+
+void RPLidarDecoder::setLineSegments(const LineExtractor::Config &config,
+    std::function<void(const opendlv::device::lidar::rplidar::LineSegments &)> delegateLineSegments) noexcept {
+  if (nullptr == delegateLineSegments) {
+    m_pipeline.stage<LineStage>().configure(config, MAX_SAMPLES_PER_SCAN, nullptr);
+  }
+  else {
+    m_segments.reserve((MAX_SAMPLES_PER_SCAN / std::max(2u, config.minSamples) + 1) * 4 * sizeof(int16_t));
+    m_pipeline.stage<LineStage>().configure(config, MAX_SAMPLES_PER_SCAN, [this, delegateLineSegments](const LineExtractor &lineExtractor){
+      const float LIMIT{static_cast<float>(INT16_MAX) / 1000.0f};
+      m_segments.clear();
+      uint32_t numberOfSegments{0};
+      for (const auto &s : lineExtractor.segments()) {
+        const float coordinates[4]{s.x1, s.y1, s.x2, s.y2};
+        int16_t millimetres[4];
+        bool inside{true};
+        for (uint8_t i{0}; i < 4; i++) {
+          inside &= (std::fabs(coordinates[i]) <= LIMIT);
+          millimetres[i] = inside ? static_cast<int16_t>(std::lround(coordinates[i] * 1000.0f)) : 0;
+        }
+        if (inside) {
+          m_segments.append(reinterpret_cast<const char*>(millimetres), sizeof(millimetres));
+          numberOfSegments++;
+        }
+      }
+      m_lineSegments.startAzimuth(m_startAzimuth)
+                    .numberOfSegments(numberOfSegments)
+                    .segments(m_segments)
+                    .samplesFitted(lineExtractor.samplesFitted())
+                    .residual(lineExtractor.residual());
+      delegateLineSegments(m_lineSegments);
+    });
+  }
+  m_scanBuffer.reserve(m_pipeline.enabled() ? MAX_SAMPLES_PER_SCAN : 0);
+}
+
+bool RPLidarDecoder::setPipeline(const std::string &stages) noexcept {
+  return m_pipeline.setOrder(stages);
+}
+
+std::string RPLidarDecoder::getPipelineStatistics() const noexcept {
+  return m_pipeline.toString();
+}
+
+void RPLidarDecoder::setInvalidSamples(InvalidSamples invalidSamples,
+    std::function<void(const opendlv::device::lidar::rplidar::ScanValidity &)> delegateScanValidity) noexcept {
+  std::lock_guard<std::mutex> lck(m_dataMutex);
+  m_invalidSamples = invalidSamples;
+  m_delegateScanValidity = (MARK_INVALID == invalidSamples) ? delegateScanValidity : nullptr;
+}
+
+bool RPLidarDecoder::parseAngularMasks(const std::string &text, std::vector<std::pair<float, float>> &masks) noexcept {
+  std::stringstream sstr(text);
+  std::string entry;
+  std::vector<std::pair<float, float>> parsed;
+  try {
+    while (std::getline(sstr, entry, ',')) {
+      const size_t colon{entry.find(':')};
+      if (std::string::npos == colon) {
+        return false;
+      }
+      parsed.emplace_back(std::stof(entry.substr(0, colon)), std::stof(entry.substr(colon + 1)));
+    }
+  }
+  catch (...) {
+    return false;
+  }
+  masks.swap(parsed);
+  return true;
+}
+
+void RPLidarDecoder::setAngularMasks(const std::vector<std::pair<float, float>> &masks) noexcept {
+  m_angularMask.clear();
+  if (masks.empty()) {
+    return;
+  }
+  // One bit per 1/64 degree; 64 bits per degree.
+  m_angularMask.assign(FULL_CIRCLE_Q6 / 64, 0);
+  for (const auto &mask : masks) {
+    const uint32_t from{static_cast<uint32_t>(std::lround(std::fmod(std::fmod(mask.first, 360.0f) + 360.0f, 360.0f) * 64.0f)) % FULL_CIRCLE_Q6};
+    const uint32_t to{static_cast<uint32_t>(std::lround(std::fmod(std::fmod(mask.second, 360.0f) + 360.0f, 360.0f) * 64.0f)) % FULL_CIRCLE_Q6};
+    // Masks ending at or behind their start wrap around 360 degree.
+    const uint32_t length{(from < to) ? to - from : FULL_CIRCLE_Q6 - from + to};
+    for (uint32_t i{0}; i < length; i++) {
+      const uint32_t a{(from + i) % FULL_CIRCLE_Q6};
+      m_angularMask[a >> 6] |= (static_cast<uint64_t>(1) << (a & 0x3F));
+    }
+  }
+}
+
+void RPLidarDecoder::setRangeGate(float minRange, float maxRange) noexcept {
+  const float MAX_Q2{static_cast<float>(UINT16_MAX)};
+  m_minRangeQ2 = static_cast<uint16_t>((0.0f < minRange) ? std::min(minRange * 4000.0f, MAX_Q2) : 0.0f);
+  m_maxRangeQ2 = static_cast<uint16_t>((0.0f < maxRange) ? std::min(maxRange * 4000.0f, MAX_Q2) : MAX_Q2);
+}
+
+void RPLidarDecoder::setLatencyTracer(LatencyTracer *latencyTracer) noexcept {
+  std::lock_guard<std::mutex> lck(m_dataMutex);
+  m_latencyTracer = latencyTracer;
+}
+
 size_t RPLidarDecoder::decode(const uint8_t *buffer, const size_t size) noexcept {
   const size_t HEADER_SIZE{7};
   size_t offset{0};
+  if (m_leaveScanningMode.exchange(false)) {
+    // Bytes of an incomplete node are skipped in request/response mode.
+    m_inScanningMode = false;
+    resetScan();
+  }
+  if (!m_inScanningMode && m_sectorsPending.load(std::memory_order_relaxed)) {
+    applySectors();
+  }
   while (true) {
     if (m_inScanningMode) {
-      // In scanning mode, we must receive messages of size 5 bytes;
-      // otherwise, it's an error that we simply reject.
+      // In scanning mode, we receive messages of size 5 bytes; keep an
+      // incomplete one at the end to be completed with the next chunk.
       if (offset + 5 > size) {
-        return size;
+        return offset;
       }
 
       if (parseScan(buffer, offset, 5)) {
         offset += 5;
+        if (m_outOfSync) {
+          m_outOfSync = false;
+          m_resyncs.fetch_add(1, std::memory_order_relaxed);
+        }
       }
       else {
         offset += 1;
+        m_outOfSync = true;
+        m_invalidNodes.fetch_add(1, std::memory_order_relaxed);
+        m_bytesDiscarded.fetch_add(1, std::memory_order_relaxed);
       }
     }
     else {
@@ -71,6 +315,7 @@ size_t RPLidarDecoder::decode(const uint8_t *buffer, const size_t size) noexcept
       if ((offset + 6) > size) {
         // In request/response mode, we must receive messages of size 6 bytes;
         // otherwise, it's an error that we simply reject.
+        m_bytesDiscarded.fetch_add(size - offset, std::memory_order_relaxed);
         return size;
       }
 
@@ -92,16 +337,22 @@ size_t RPLidarDecoder::decode(const uint8_t *buffer, const size_t size) noexcept
         // Parse contained message.
         if (parseMessage(buffer, offset + HEADER_SIZE, m_payloadSize, m_nextRPLidarMessage)) {
           offset += HEADER_SIZE + m_payloadSize;
-          m_lastRPLidarMessage = m_nextRPLidarMessage;
+          {
+            std::lock_guard<std::mutex> lck(m_dataMutex);
+            m_lastRPLidarMessage = m_nextRPLidarMessage;
+          }
+          m_messageReceived.notify_all();
         }
         else {
           // Parsing failed even though we found the two SYNC bytes; consume them and start over.
           offset += 2;
+          m_bytesDiscarded.fetch_add(2, std::memory_order_relaxed);
         }
       }
       else {
         // No SYNC bytes found yet; consume one byte.
         offset++;
+        m_bytesDiscarded.fetch_add(1, std::memory_order_relaxed);
       }
     }
   }
@@ -111,6 +362,15 @@ size_t RPLidarDecoder::decode(const uint8_t *buffer, const size_t size) noexcept
   return size;
 }
 
+void RPLidarDecoder::encodeScanNode(std::vector<uint8_t> &buffer, bool startFlag, uint8_t quality, uint16_t angleQ6, uint16_t distanceQ2) noexcept {
+  buffer.push_back(static_cast<uint8_t>((startFlag ? 0x1 : 0x2) | ((quality & 0x3F) << 2)));
+  // The lowest bit of the angle bytes is the check bit that is always 1.
+  buffer.push_back(static_cast<uint8_t>(((angleQ6 << 1) & 0xFF) | 0x1));
+  buffer.push_back(static_cast<uint8_t>((angleQ6 >> 7) & 0xFF));
+  buffer.push_back(static_cast<uint8_t>(distanceQ2 & 0xFF));
+  buffer.push_back(static_cast<uint8_t>((distanceQ2 >> 8) & 0xFF));
+}
+
 bool RPLidarDecoder::parseMessage(const uint8_t *buffer, const size_t offset, const size_t sizeOfMessage, RPLidarMessages type) noexcept {
   if (RPLidarDecoder::GOT_INFO == type) {
     std::lock_guard<std::mutex> lck(m_dataMutex);
@@ -159,58 +419,292 @@ bool RPLidarDecoder::parseScan(const uint8_t *buffer, const size_t offset, const
   }
 
   //uint8_t quality{byte0 >> 2};
-  float angle = ((byte1 & 0xFF) | ((buffer[offset + 2] & 0xFF) << 8)) >> 1;
+  uint16_t angleQ6 = static_cast<uint16_t>(((byte1 & 0xFF) | ((buffer[offset + 2] & 0xFF) << 8)) >> 1);
+  uint16_t distanceQ2 = static_cast<uint16_t>((buffer[offset + 3] & 0xFF) | ((buffer[offset + 4] & 0xFF) << 8));
+
+  // Masks and range gates work on the raw values of the device; start
+  // nodes are needed to complete the scan nevertheless.
+  const bool filtered{isFiltered(angleQ6, distanceQ2)};
+  const bool invalid{!filtered && (0 == distanceQ2)};
+  const bool dropped{filtered || (invalid && (DROP_INVALID == m_invalidSamples))};
+  if (dropped && !startFlag) {
+    if (m_foundFirstStart) {
+      m_nodesFiltered += filtered ? 1 : 0;
+      m_nodesInvalid += invalid ? 1 : 0;
+    }
+    return true;
+  }
+
+  // Flip and yaw of the mounting are applied to the fixed point angle.
+  if (m_mountFlip && (0 < angleQ6) && (FULL_CIRCLE_Q6 > angleQ6)) {
+    angleQ6 = static_cast<uint16_t>(FULL_CIRCLE_Q6 - angleQ6);
+  }
+  if (0 < m_mountAngleQ6) {
+    const uint32_t shifted{static_cast<uint32_t>(angleQ6) + m_mountAngleQ6};
+    angleQ6 = static_cast<uint16_t>((FULL_CIRCLE_Q6 <= shifted) ? shifted - FULL_CIRCLE_Q6 : shifted);
+  }
+  float angle = angleQ6;
   angle /= 64.0f;
 
-  float distance = ((buffer[offset + 3] & 0xFF) | ((buffer[offset + 4] & 0xFF) << 8));
+  float distance = distanceQ2;
   distance /= 4.0f;
   // Turn into m.
   distance /= 1000.0f;
 
+  // An offset of the mounting changes azimuth and distance of every return.
+  if (m_mountTranslation && (0 < distanceQ2)) {
+    const float phi{angle * static_cast<float>(M_PI) / 180.0f};
+    const float x{m_mountX + distance * std::cos(phi)};
+    const float y{m_mountY - distance * std::sin(phi)};
+    distance = std::sqrt(x * x + y * y);
+    angle = -std::atan2(y, x) * 180.0f / static_cast<float>(M_PI);
+    angle = (0.0f > angle) ? angle + 360.0f : angle;
+    angleQ6 = static_cast<uint16_t>(static_cast<uint32_t>(angle * 64.0f) % FULL_CIRCLE_Q6);
+    const float q2{distance * 4000.0f};
+    distanceQ2 = (65535.0f < q2) ? static_cast<uint16_t>(65535) : static_cast<uint16_t>(q2);
+  }
+
   if (startFlag && !m_foundFirstStart) {
     m_foundFirstStart = true;
   }
 
   // Copy entries into buffers.
   if (!startFlag && m_foundFirstStart) {
-    m_anglesWritten++;
-    m_angles.write(reinterpret_cast<char*>(&angle), sizeof(float));
-    m_distances.write(reinterpret_cast<char*>(&distance), sizeof(float));
+    appendSample(angle, distance, angleQ6, distanceQ2);
   }
 
   // Send PointCloud and start over.
   if (startFlag && m_foundFirstStart) {
-    if (m_anglesWritten > 200) {
-      const std::string listOfAngles = m_angles.str();
-      const std::string listOfDistances = m_distances.str();
+    const int64_t now{std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count()};
+    if (m_scanFrequencyEstimator.addStartFlag(now)) {
+      m_scanFrequency.store(m_scanFrequencyEstimator.frequency(), std::memory_order_relaxed);
+    }
+
+    if (nodesInScan() > 200) {
+      if (nullptr != m_latencyTracer) {
+        m_latencyTracer->mark(LatencyTracer::NODE_DECODE);
+      }
+      processScan();
       m_pointCloudReading.startAzimuth(m_startAzimuth)
                          .endAzimuth(0)
                          .entriesPerAzimuth(1)
-                         .distances(listOfDistances)
+                         .distances(m_distances)
                          .numberOfBitsForIntensity(0)
                          .typeOfVerticalAngularLayout(2)
-                         .azimuthAngles(listOfAngles);
+                         .azimuthAngles(m_angles);
+      if (nullptr != m_latencyTracer) {
+        m_latencyTracer->mark(LatencyTracer::SCAN_COMPLETE);
+      }
 
-      if (nullptr != m_delegateCompleteScan) {
+      {
         std::lock_guard<std::mutex> lck(m_dataMutex);
-        m_delegateCompleteScan(m_pointCloudReading);
+        bool published{false};
+        if (nullptr != m_delegateCompleteScan) {
+          try {
+            m_delegateCompleteScan(m_pointCloudReading);
+            published = true;
+          }
+          catch (...) {}
+        }
+        if (!published) {
+          m_publishesDropped.fetch_add(1, std::memory_order_relaxed);
+        }
+      }
+      sendSectors();
+      sendValidity();
+      updateStatistics();
+      if (nullptr != m_latencyTracer) {
+        m_latencyTracer->complete();
       }
 
       m_anglesWritten = 0;
-      m_angles.str("");
-      m_distances.str("");
+      m_nodesFiltered = 0;
+      m_nodesInvalid = 0;
       m_angles.clear();
       m_distances.clear();
+      m_validity.clear();
+    }
+    else {
+      // Too few nodes for a rotation, e.g., the rest of one before the first
+      // start flag; discard them so that neither the next cloud nor its
+      // sectors contain them.
+      m_anglesWritten = 0;
+      m_nodesFiltered = 0;
+      m_nodesInvalid = 0;
+      m_angles.clear();
+      m_distances.clear();
+      m_validity.clear();
+      for (auto &d : m_sectorMinDistances) {
+        d = UINT16_MAX;
+      }
     }
 
-    m_anglesWritten++;
     m_startAzimuth = angle;
-    m_angles.write(reinterpret_cast<char*>(&angle), sizeof(float));
-    m_distances.write(reinterpret_cast<char*>(&distance), sizeof(float));
+    if (filtered) {
+      m_nodesFiltered++;
+    }
+    else if (dropped) {
+      m_nodesInvalid++;
+    }
+    else {
+      appendSample(angle, distance, angleQ6, distanceQ2);
+    }
   }
   return true;
 }
 
+void RPLidarDecoder::appendSample(float angle, float distance, uint16_t angleQ6, uint16_t distanceQ2) noexcept {
+  if (0 == distanceQ2) {
+    m_nodesInvalid++;
+  }
+  if (MARK_INVALID == m_invalidSamples) {
+    // One bit per sample, least significant bit first.
+    if (0 == (m_anglesWritten & 0x7)) {
+      m_validity.push_back('\0');
+    }
+    if (0 < distanceQ2) {
+      m_validity.back() = static_cast<char>(m_validity.back() | (1 << (m_anglesWritten & 0x7)));
+    }
+  }
+  m_anglesWritten++;
+  m_angles.append(reinterpret_cast<char*>(&angle), sizeof(float));
+  m_distances.append(reinterpret_cast<char*>(&distance), sizeof(float));
+  addToSectors(angleQ6, distanceQ2);
+}
+
+void RPLidarDecoder::processScan() noexcept {
+  if ( (0 == m_anglesWritten) || !m_pipeline.enabled() ) {
+    return;
+  }
+  m_scanBuffer.assign(m_angles.data(), m_distances.data(), m_anglesWritten);
+  m_pipeline.run(m_scanBuffer);
+
+  // Samples removed by a stage are handled like samples without return.
+  uint32_t kept{m_scanBuffer.size};
+  if (DROP_INVALID == m_invalidSamples) {
+    kept = 0;
+    for (uint32_t i{0}; i < m_scanBuffer.size; i++) {
+      if (0.0f < m_scanBuffer.distances[i]) {
+        m_scanBuffer.angles[kept] = m_scanBuffer.angles[i];
+        m_scanBuffer.distances[kept] = m_scanBuffer.distances[i];
+        kept++;
+      }
+    }
+  }
+  else if (MARK_INVALID == m_invalidSamples) {
+    m_validity.assign((kept + 7) / 8, '\0');
+    for (uint32_t i{0}; i < kept; i++) {
+      if (0.0f < m_scanBuffer.distances[i]) {
+        m_validity[i / 8] = static_cast<char>(m_validity[i / 8] | (1 << (i % 8)));
+      }
+    }
+  }
+  m_anglesWritten = kept;
+  m_angles.resize(kept * sizeof(float));
+  m_distances.resize(kept * sizeof(float));
+  std::memcpy(&m_angles[0], m_scanBuffer.angles.data(), kept * sizeof(float));
+  std::memcpy(&m_distances[0], m_scanBuffer.distances.data(), kept * sizeof(float));
+}
+
+uint32_t RPLidarDecoder::nodesInScan() const noexcept {
+  return m_anglesWritten + m_nodesFiltered + ((DROP_INVALID == m_invalidSamples) ? m_nodesInvalid : 0);
+}
+
+float RPLidarDecoder::invalidRatio() const noexcept {
+  const uint32_t samples{nodesInScan() - m_nodesFiltered};
+  return (0 < samples) ? static_cast<float>(m_nodesInvalid) / static_cast<float>(samples) : 0.0f;
+}
+
+bool RPLidarDecoder::isFiltered(uint16_t angleQ6, uint16_t distanceQ2) const noexcept {
+  // Distance 0 marks a sample without return that is not gated.
+  if ( (0 < distanceQ2) && ((distanceQ2 < m_minRangeQ2) || (distanceQ2 > m_maxRangeQ2)) ) {
+    return true;
+  }
+  return !m_angularMask.empty() && (FULL_CIRCLE_Q6 > angleQ6) && (0 != ((m_angularMask[angleQ6 >> 6] >> (angleQ6 & 0x3F)) & 0x1));
+}
+
+void RPLidarDecoder::resetScan() noexcept {
+  m_foundFirstStart = false;
+  m_outOfSync = false;
+  m_anglesWritten = 0;
+  m_nodesFiltered = 0;
+  m_nodesInvalid = 0;
+  m_angles.clear();
+  m_distances.clear();
+  m_validity.clear();
+  for (auto &d : m_sectorMinDistances) {
+    d = UINT16_MAX;
+  }
+  // Time between the last start flag before and the first after a pause is no rotation.
+  m_scanFrequencyEstimator.reset();
+  // Nor is the scan before a pause the reference for the first after it.
+  m_pipeline.stage<OdometryStage>().restart();
+}
+
+void RPLidarDecoder::updateStatistics() noexcept {
+  m_scansEmitted.fetch_add(1, std::memory_order_relaxed);
+  m_samplesPerScan.store(m_anglesWritten, std::memory_order_relaxed);
+  m_samplesFiltered.fetch_add(m_nodesFiltered, std::memory_order_relaxed);
+  m_samplesInvalid.fetch_add(m_nodesInvalid, std::memory_order_relaxed);
+  m_invalidRatio.store(invalidRatio(), std::memory_order_relaxed);
+}
+
+void RPLidarDecoder::applySectors() noexcept {
+  std::lock_guard<std::mutex> lck(m_dataMutex);
+  m_delegateSectorMinDistance = m_pendingDelegateSectorMinDistance;
+  m_sectorMinDistances.assign(m_pendingNumberOfSectors, UINT16_MAX);
+  m_sectorDistances.resize(m_pendingNumberOfSectors * sizeof(float));
+  m_sectorsPending = false;
+}
+
+void RPLidarDecoder::addToSectors(uint16_t angleQ6, uint16_t distanceQ2) noexcept {
+  const size_t numberOfSectors{m_sectorMinDistances.size()};
+  // Distance 0 marks a sample without return.
+  if ( (0 == numberOfSectors) || (0 == distanceQ2) ) {
+    return;
+  }
+  size_t sector = (static_cast<uint32_t>(angleQ6) * numberOfSectors) / FULL_CIRCLE_Q6;
+  sector = (sector < numberOfSectors) ? sector : numberOfSectors - 1;
+  if (distanceQ2 < m_sectorMinDistances[sector]) {
+    m_sectorMinDistances[sector] = distanceQ2;
+  }
+}
+
+void RPLidarDecoder::sendValidity() noexcept {
+  if (MARK_INVALID != m_invalidSamples) {
+    return;
+  }
+  m_scanValidity.startAzimuth(m_startAzimuth)
+                .numberOfSamples(m_anglesWritten)
+                .validity(m_validity)
+                .invalidRatio(invalidRatio());
+  std::lock_guard<std::mutex> lck(m_dataMutex);
+  if (nullptr != m_delegateScanValidity) {
+    m_delegateScanValidity(m_scanValidity);
+  }
+}
+
+void RPLidarDecoder::sendSectors() noexcept {
+  const size_t numberOfSectors{m_sectorMinDistances.size()};
+  if (0 == numberOfSectors) {
+    return;
+  }
+  for (size_t i{0}; i < numberOfSectors; i++) {
+    // Turn into m; sectors without any return are reported as 0.
+    const float distance{(UINT16_MAX == m_sectorMinDistances[i]) ? 0.0f : static_cast<float>(m_sectorMinDistances[i]) / 4000.0f};
+    std::memcpy(&m_sectorDistances[i * sizeof(float)], &distance, sizeof(float));
+    m_sectorMinDistances[i] = UINT16_MAX;
+  }
+  m_sectorMinDistance.startAzimuth(m_startAzimuth)
+                     .numberOfSectors(static_cast<uint16_t>(numberOfSectors))
+                     .distances(m_sectorDistances);
+
+  if (nullptr != m_delegateSectorMinDistance) {
+    std::lock_guard<std::mutex> lck(m_dataMutex);
+    m_delegateSectorMinDistance(m_sectorMinDistance);
+  }
+}
+
 opendlv::device::lidar::rplidar::DeviceInfo RPLidarDecoder::getDeviceInfo(const uint8_t *buffer, const size_t offset, const size_t sizeOfMessage) noexcept {
   opendlv::device::lidar::rplidar::DeviceInfo data;
   if (20 == sizeOfMessage) {
@@ -20,10 +20,20 @@
 
 #include "opendlv-standard-message-set.hpp"
 #include "rplidar-message-set.hpp"
+#include "latency-tracer.hpp"
+#include "scan-pipeline.hpp"
+#include "scan-stages.hpp"
+#include "scan-frequency-estimator.hpp"
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <functional>
+#include <memory>
 #include <mutex>
-#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
 
 class RPLidarDecoder {
  public:
@@ -34,12 +44,24 @@ class RPLidarDecoder {
     GOT_SCAN    = 0x81,
   };
 
+  // Buffers are reserved for this many samples per scan up front; longer
+  // scans are still assembled but let the buffers grow.
+  static constexpr const uint32_t MAX_SAMPLES_PER_SCAN{8192};
+  static constexpr const uint32_t FULL_CIRCLE_Q6{360 * 64};
+
+  enum InvalidSamples : uint8_t {
+    KEEP_INVALID = 0, // Published as 0 m.
+    DROP_INVALID = 1,
+    MARK_INVALID = 2, // Published as 0 m and marked in ScanValidity.
+  };
+
   enum RPLidarBytes {
     GET_INFO    = 0x50,
     GET_HEALTH  = 0x52,
     RESET       = 0x40,
     SCAN        = 0x20,
     STOP        = 0x25,
+    SET_MOTOR_PWM = 0xF0,
     SYNC_BYTE0  = 0xA5,
     SYNC_BYTE1  = 0x5A,
   };
@@ -51,18 +73,147 @@ class RPLidarDecoder {
   RPLidarDecoder &operator=(RPLidarDecoder &&) = delete;
 
  public:
-  RPLidarDecoder() = default;
+  RPLidarDecoder() noexcept;
   ~RPLidarDecoder() = default;
 
  public:
   void setDelegates(std::function<void(const opendlv::device::lidar::rplidar::DeviceInfo &)> delegateDeviceInfo,
                     std::function<void(const opendlv::device::lidar::rplidar::DeviceHealth &)> delegateDeviceHealth,
-                    std::function<void(opendlv::proxy::PointCloudReading pc)> delegateCompleteScan);
+                    std::function<void(const opendlv::proxy::PointCloudReading &)> delegateCompleteScan);
+  /**
+   * Reports the closest return per sector of every scan; 0 sectors disable
+   * the reports. May be called from any thread: the sectors are replaced by
+   * the decoding thread once it is not within a scan, i.e., before decoding
+   * the next response after leaveScanningMode.
+   */
+  void setSectorDelegate(uint16_t numberOfSectors,
+                         std::function<void(const opendlv::device::lidar::rplidar::SectorMinDistance &)> delegateSectorMinDistance);
+  /**
+   * Reports samples in the vehicle frame of a device mounted at x, y (in m)
+   * and turned by yaw (in degree, counterclockwise); flip is for mounting
+   * upside down. Flip and yaw shift the fixed point angles; only an offset
+   * needs floating point per sample. To be set while not scanning.
+   */
+  void setMount(float x, float y, float yaw, bool flip) noexcept;
+  /**
+   * Drops samples at azimuths of the device within the masks before they
+   * are converted or buffered; masks are [from, to) in degree and wrap at
+   * 360. An empty list removes all masks. To be set while not scanning.
+   */
+  void setAngularMasks(const std::vector<std::pair<float, float>> &masks) noexcept;
+  /**
+   * Drops returns closer than minRange or farther than maxRange from the
+   * device (in m; 0 = no limit); samples without return are kept. To be set
+   * while not scanning.
+   */
+  void setRangeGate(float minRange, float maxRange) noexcept;
+  /**
+   * Handling of samples without return, i.e., distance 0; with
+   * MARK_INVALID, a ScanValidity is handed to the delegate after every scan.
+   * To be set while not scanning.
+   */
+  void setInvalidSamples(InvalidSamples invalidSamples,
+                         std::function<void(const opendlv::device::lidar::rplidar::ScanValidity &)> delegateScanValidity = nullptr) noexcept;
+  /**
+   * Configures the median and outliers stages of the pipeline that filter
+   * the distances of every assembled scan before it is published; removed
+   * samples are handled like samples without return. A config without
+   * median and isolation distance turns filtering off. To be set while not
+   * scanning.
+   */
+  void setScanFilter(const ScanFilter::Config &config) noexcept;
+  /**
+   * Configures the resample stage of the pipeline that thins every
+   * assembled scan to at most budget samples, keeping them about evenly
+   * spaced on the surfaces, i.e., with an angular density proportional to
+   * range up to that of the scan; samples without return are dropped.
+   * 0 turns downsampling off. To be set while not scanning.
+   */
+  void setPointBudget(uint32_t budget) noexcept;
+  /**
+   * Sets the order of the stages that process every assembled scan before
+   * it is published, from median, outliers, resample, odometry, grid, and lines
+   * separated by commas (default: in this order); stages that are not configured are
+   * skipped. Angular masks and range gates always apply first as they work
+   * on the raw nodes. To be set while not scanning.
+   * @return false for unknown or repeated stages.
+   */
+  bool setPipeline(const std::string &stages) noexcept;
+  /**
+   * Configures the odometry stage of the pipeline that matches every scan
+   * against the previous one; a ScanOdometry is handed to the delegate
+   * before the PointCloudReading of the same scan. nullptr turns odometry
+   * off. To be set while not scanning.
+   */
+  void setOdometry(const ScanMatcher::Config &config,
+                   std::function<void(const opendlv::device::lidar::rplidar::ScanOdometry &)> delegateScanOdometry) noexcept;
+  /**
+   * Configures the grid stage of the pipeline that integrates every scan
+   * into a rolling occupancy grid at the pose from the odometry stage, if
+   * configured and run before; an OccupancyGridSnapshot is handed to the
+   * delegate with the given period. nullptr turns the grid off. To be set
+   * while not scanning.
+   */
+  void setOccupancyGrid(const OccupancyGrid::Config &config, std::chrono::milliseconds snapshotPeriod,
+                        std::function<void(const opendlv::device::lidar::rplidar::OccupancyGridSnapshot &)> delegateOccupancyGridSnapshot) noexcept;
+  /**
+   * Configures the lines stage of the pipeline that fits line segments to
+   * every scan; LineSegments are handed to the delegate before the
+   * PointCloudReading of the same scan. nullptr turns it off. To be set
+   * while not scanning.
+   */
+  void setLineSegments(const LineExtractor::Config &config,
+                       std::function<void(const opendlv::device::lidar::rplidar::LineSegments &)> delegateLineSegments) noexcept;
+  /**
+   * @return mean and max time and removed samples per pipeline stage.
+   */
+  std::string getPipelineStatistics() const noexcept;
+  /**
+   * Parses from:to[,from:to...] in degree.
+   */
+  static bool parseAngularMasks(const std::string &text, std::vector<std::pair<float, float>> &masks) noexcept;
+  /**
+   * Marks NODE_DECODE and SCAN_COMPLETE for every scan and completes it
+   * after the delegates returned; the tracer must outlive the decoder.
+   */
+  void setLatencyTracer(LatencyTracer *latencyTracer) noexcept;
   size_t decode(const uint8_t *buffer, const size_t size) noexcept;
+  /**
+   * Leaves scanning mode with the next call to decode, e.g., after STOP was
+   * sent and the remaining nodes were decoded; the scan being assembled is
+   * dropped. Also clears the last received message. Can be called from any
+   * thread.
+   */
+  void leaveScanningMode() noexcept;
+  /**
+   * Waits until the given message was decoded last or the timeout passed.
+   */
+  bool waitForMessage(RPLidarMessages message, std::chrono::milliseconds timeout) const noexcept;
+
+  /**
+   * Appends one 5 bytes measurement node as sent by the RPLidar in scanning
+   * mode; angle in 1/64 degree, distance in 1/4 mm.
+   */
+  static void encodeScanNode(std::vector<uint8_t> &buffer, bool startFlag, uint8_t quality, uint16_t angleQ6, uint16_t distanceQ2) noexcept;
 
  private:
   bool parseMessage(const uint8_t *buf, const size_t offset, const size_t sizeOfMessage, RPLidarMessages type) noexcept;
   bool parseScan(const uint8_t *buf, const size_t offset, const size_t length) noexcept;
+  void resetScan() noexcept;
+  bool isFiltered(uint16_t angleQ6, uint16_t distanceQ2) const noexcept;
+  void appendSample(float angle, float distance, uint16_t angleQ6, uint16_t distanceQ2) noexcept;
+  /**
+   * @return nodes of the scan being assembled including dropped ones.
+   */
+  uint32_t nodesInScan() const noexcept;
+  float invalidRatio() const noexcept;
+  void sendValidity() noexcept;
+  void processScan() noexcept;
+
+  void updateStatistics() noexcept;
+  void applySectors() noexcept;
+  void addToSectors(uint16_t angleQ6, uint16_t distanceQ2) noexcept;
+  void sendSectors() noexcept;
 
   opendlv::device::lidar::rplidar::DeviceInfo getDeviceInfo(const uint8_t *buffer, const size_t offset, const size_t sizeOfMessage) noexcept;
   opendlv::device::lidar::rplidar::DeviceHealth getDeviceHealth(const uint8_t *buffer, const size_t offset, const size_t sizeOfMessage) noexcept;
@@ -70,28 +221,91 @@ class RPLidarDecoder {
  private:
   std::function<void(const opendlv::device::lidar::rplidar::DeviceInfo &)> m_delegateDeviceInfo{nullptr};
   std::function<void(const opendlv::device::lidar::rplidar::DeviceHealth &)> m_delegateDeviceHealth{nullptr};
-  std::function<void(opendlv::proxy::PointCloudReading pc)> m_delegateCompleteScan{nullptr};
+  std::function<void(const opendlv::proxy::PointCloudReading &)> m_delegateCompleteScan{nullptr};
+  LatencyTracer *m_latencyTracer{nullptr};
+
+  uint16_t m_mountAngleQ6{0};
+  bool m_mountFlip{false};
+  bool m_mountTranslation{false};
+  float m_mountX{0.0f};
+  float m_mountY{0.0f};
+
+  // One bit per raw angle in 1/64 degree; empty without masks.
+  std::vector<uint64_t> m_angularMask{};
+  uint16_t m_minRangeQ2{0};
+  uint16_t m_maxRangeQ2{UINT16_MAX};
+  uint32_t m_nodesFiltered{0};
+  InvalidSamples m_invalidSamples{KEEP_INVALID};
+  // Samples without return among those not filtered, dropped or not.
+  uint32_t m_nodesInvalid{0};
+  std::string m_validity{};
+  std::function<void(const opendlv::device::lidar::rplidar::ScanValidity &)> m_delegateScanValidity{nullptr};
+  opendlv::device::lidar::rplidar::ScanValidity m_scanValidity{};
+  using Pipeline = ScanPipeline<MedianStage, OutlierStage, ResampleStage, OdometryStage, GridStage, LineStage>;
+  Pipeline m_pipeline{};
+  ScanBuffer m_scanBuffer{};
+  opendlv::device::lidar::rplidar::ScanOdometry m_scanOdometry{};
+  std::string m_gridCells{};
+  opendlv::device::lidar::rplidar::OccupancyGridSnapshot m_occupancyGridSnapshot{};
+  std::string m_segments{};
+  opendlv::device::lidar::rplidar::LineSegments m_lineSegments{};
 
   bool m_inScanningMode{false};
+  std::atomic<bool> m_leaveScanningMode{false};
   uint32_t m_payloadSize{0};
   RPLidarMessages m_nextRPLidarMessage{RPLidarDecoder::UNKNOWN};
   bool m_foundFirstStart{false};
   float m_startAzimuth{0};
   uint32_t m_anglesWritten{0};
-  std::stringstream m_angles{};
-  std::stringstream m_distances{};
+  // Reused for every scan to not allocate once warmed up.
+  std::string m_angles{};
+  std::string m_distances{};
+
+  // Closest raw distance (in 1/4 mm) per sector of the scan being assembled.
+  std::function<void(const opendlv::device::lidar::rplidar::SectorMinDistance &)> m_delegateSectorMinDistance{nullptr};
+  std::vector<uint16_t> m_sectorMinDistances{};
+  std::string m_sectorDistances{};
+  opendlv::device::lidar::rplidar::SectorMinDistance m_sectorMinDistance{};
+  // Requested sectors (guarded by m_dataMutex) until applySectors.
+  std::atomic<bool> m_sectorsPending{false};
+  uint16_t m_pendingNumberOfSectors{0};
+  std::function<void(const opendlv::device::lidar::rplidar::SectorMinDistance &)> m_pendingDelegateSectorMinDistance{nullptr};
 
  public:
   RPLidarMessages getLastRPLidarMessage() const noexcept;
   opendlv::device::lidar::rplidar::DeviceInfo getDeviceInfo() const noexcept;
   opendlv::device::lidar::rplidar::DeviceHealth getDeviceHealth() const noexcept;
+  /**
+   * @return counters of the decoder; bytesReceived is left to the caller.
+   */
+  opendlv::device::lidar::rplidar::DriverStatistics getStatistics() const noexcept;
+  /**
+   * @return scan frequency in Hz estimated from the timing of start flags.
+   */
+  float getScanFrequency() const noexcept;
 
  private:
   mutable std::mutex m_dataMutex{};
+  mutable std::condition_variable m_messageReceived{};
   RPLidarMessages m_lastRPLidarMessage{RPLidarDecoder::UNKNOWN};
   opendlv::device::lidar::rplidar::DeviceInfo m_deviceInfo{};
   opendlv::device::lidar::rplidar::DeviceHealth m_deviceHealth{};
   opendlv::proxy::PointCloudReading m_pointCloudReading{};
+
+ private:
+  // Written by the decoding thread only and read from anywhere; hence, relaxed.
+  std::atomic<uint64_t> m_bytesDiscarded{0};
+  std::atomic<uint64_t> m_invalidNodes{0};
+  std::atomic<uint64_t> m_resyncs{0};
+  std::atomic<uint64_t> m_scansEmitted{0};
+  std::atomic<uint32_t> m_samplesPerScan{0};
+  std::atomic<float> m_scanFrequency{0.0f};
+  std::atomic<uint64_t> m_publishesDropped{0};
+  std::atomic<uint64_t> m_samplesFiltered{0};
+  std::atomic<uint64_t> m_samplesInvalid{0};
+  std::atomic<float> m_invalidRatio{0.0f};
+  bool m_outOfSync{false};
+  ScanFrequencyEstimator m_scanFrequencyEstimator{};
 };
 
 #endif
@@ -0,0 +1,325 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "rplidar-emulator.hpp"
+#include "rplidar-decoder.hpp"
+
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cmath>
+#include <cstdlib>
+
+namespace {
+// Default scan: a 4 m x 3 m rectangular room with the sensor in its center.
+void rectangularRoom(uint32_t, uint32_t samplesPerScan, std::vector<uint8_t> &nodes) {
+  constexpr const float PI{3.14159265f};
+  for (uint32_t i{0}; i < samplesPerScan; i++) {
+    const uint16_t angleQ6{static_cast<uint16_t>((i * 360ull * 64ull) / samplesPerScan)};
+    const float angle{static_cast<float>(angleQ6) / 64.0f * PI / 180.0f};
+    const float c{std::fabs(std::cos(angle))};
+    const float s{std::fabs(std::sin(angle))};
+    const float toSide{(c > 1e-6f) ? 2.0f / c : 1e6f};
+    const float toFront{(s > 1e-6f) ? 1.5f / s : 1e6f};
+    const float distance{(toSide < toFront) ? toSide : toFront};
+    RPLidarDecoder::encodeScanNode(nodes, 0 == i, 47, angleQ6, static_cast<uint16_t>(distance * 4000.0f));
+  }
+}
+}
+
+constexpr const uint8_t RPLidarEmulator::MODEL_A1;
+constexpr const uint8_t RPLidarEmulator::MODEL_A2;
+constexpr const uint8_t RPLidarEmulator::MODEL_A3;
+constexpr const float RPLidarEmulator::MOTOR_GAIN;
+constexpr const uint8_t RPLidarEmulator::HEALTH_GOOD;
+constexpr const uint8_t RPLidarEmulator::HEALTH_WARNING;
+constexpr const uint8_t RPLidarEmulator::HEALTH_ERROR;
+
+RPLidarEmulator::RPLidarEmulator(float scanFrequency, uint32_t samplesPerScan) noexcept
+  : m_nominalScanFrequency{(0.0f < scanFrequency) ? scanFrequency : 10.0f}
+  , m_samplesPerScan{(0 < samplesPerScan) ? samplesPerScan : 720}
+  , m_scanGenerator{rectangularRoom} {
+  m_scanFrequency = m_nominalScanFrequency;
+  m_targetScanFrequency = m_nominalScanFrequency;
+  m_master = ::posix_openpt(O_RDWR | O_NOCTTY);
+  if ( (-1 == m_master) || (0 != ::grantpt(m_master)) || (0 != ::unlockpt(m_master)) ) {
+    if (-1 != m_master) {
+      ::close(m_master);
+      m_master = -1;
+    }
+    return;
+  }
+  ::fcntl(m_master, F_SETFL, ::fcntl(m_master, F_GETFL) | O_NONBLOCK);
+  const char *name = ::ptsname(m_master);
+  m_deviceName = (nullptr != name) ? name : "";
+
+  // Keep the slave side open in raw mode so that the master does not see a
+  // hangup whenever a client closes the device.
+  m_slave = ::open(m_deviceName.c_str(), O_RDWR | O_NOCTTY);
+  if (-1 != m_slave) {
+    struct termios options;
+    if (0 == ::tcgetattr(m_slave, &options)) {
+      options.c_iflag &= static_cast<tcflag_t>(~(IGNBRK | BRKINT | PARMRK | ISTRIP | INLCR | IGNCR | ICRNL | IXON));
+      options.c_oflag &= static_cast<tcflag_t>(~OPOST);
+      options.c_lflag &= static_cast<tcflag_t>(~(ECHO | ECHONL | ICANON | ISIG | IEXTEN));
+      options.c_cflag &= static_cast<tcflag_t>(~(CSIZE | PARENB));
+      options.c_cflag |= CS8;
+      ::tcsetattr(m_slave, TCSANOW, &options);
+    }
+  }
+
+  m_running = true;
+  m_thread.reset(new std::thread(&RPLidarEmulator::run, this));
+}
+
+RPLidarEmulator::~RPLidarEmulator() {
+  m_running = false;
+  if (m_thread) {
+    m_thread->join();
+  }
+  if (-1 != m_slave) {
+    ::close(m_slave);
+  }
+  if (-1 != m_master) {
+    ::close(m_master);
+  }
+}
+
+bool RPLidarEmulator::isOpen() const noexcept {
+  return (-1 != m_master) && !m_deviceName.empty();
+}
+
+std::string RPLidarEmulator::getDeviceName() const noexcept {
+  return m_deviceName;
+}
+
+void RPLidarEmulator::setScanGenerator(ScanGenerator scanGenerator) noexcept {
+  std::lock_guard<std::mutex> lck(m_scanGeneratorMutex);
+  m_scanGenerator = scanGenerator;
+}
+
+void RPLidarEmulator::setFaultProfile(const FaultInjector::Profile &profile, uint32_t seed) noexcept {
+  std::unique_ptr<FaultInjector> faultInjector{new FaultInjector(profile, seed, true)};
+  faultInjector->setDelegate([this](const uint8_t *buffer, size_t size, int64_t){
+    write(buffer, size);
+  });
+  std::lock_guard<std::mutex> lck(m_faultInjectorMutex);
+  m_faultInjector = std::move(faultInjector);
+}
+
+void RPLidarEmulator::setModel(uint8_t model) noexcept {
+  m_model = model;
+}
+
+void RPLidarEmulator::setHealth(uint8_t status, uint16_t errorCode) noexcept {
+  m_healthErrorCode = errorCode;
+  m_healthStatus = status;
+  if (HEALTH_ERROR == status) {
+    m_scanning = false;
+  }
+}
+
+float RPLidarEmulator::scanFrequency() const noexcept {
+  return m_scanFrequency.load(std::memory_order_relaxed);
+}
+
+uint16_t RPLidarEmulator::motorPwm() const noexcept {
+  return m_motorPwm.load(std::memory_order_relaxed);
+}
+
+bool RPLidarEmulator::isScanning() const noexcept {
+  return m_scanning.load();
+}
+
+uint64_t RPLidarEmulator::scansSent() const noexcept {
+  return m_scansSent.load(std::memory_order_relaxed);
+}
+
+uint64_t RPLidarEmulator::bytesSent() const noexcept {
+  return m_bytesSent.load(std::memory_order_relaxed);
+}
+
+uint64_t RPLidarEmulator::bytesDropped() const noexcept {
+  return m_bytesDropped.load(std::memory_order_relaxed);
+}
+
+int64_t RPLidarEmulator::lastScanCompleted() const noexcept {
+  return m_lastScanCompleted.load(std::memory_order_relaxed);
+}
+
+void RPLidarEmulator::run() noexcept {
+  uint8_t buffer[256];
+  while (m_running) {
+    struct pollfd fds{m_master, POLLIN, 0};
+    // Wake up every ms to keep streaming nodes at a steady pace.
+    if (0 < ::poll(&fds, 1, 1)) {
+      if (0 != (fds.revents & POLLIN)) {
+        const ssize_t bytesRead = ::read(m_master, buffer, sizeof(buffer));
+        if (0 < bytesRead) {
+          handleCommands(buffer, static_cast<size_t>(bytesRead));
+        }
+      }
+      else if (0 != (fds.revents & (POLLHUP | POLLERR))) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      }
+    }
+    if (m_scanning) {
+      stream(std::chrono::steady_clock::now());
+    }
+  }
+}
+
+void RPLidarEmulator::handleCommands(const uint8_t *buffer, size_t size) noexcept {
+  m_pendingCommand.insert(m_pendingCommand.end(), buffer, buffer + size);
+  size_t offset{0};
+  while (offset + 2 <= m_pendingCommand.size()) {
+    if (RPLidarDecoder::SYNC_BYTE0 != m_pendingCommand[offset]) {
+      offset++;
+      continue;
+    }
+    const uint8_t command{m_pendingCommand[offset + 1]};
+    if (0 != (command & 0x80)) {
+      // Commands with payload: A5 cmd size payload checksum.
+      if (offset + 3 > m_pendingCommand.size()) {
+        break;
+      }
+      const size_t length{3u + m_pendingCommand[offset + 2] + 1u};
+      if (offset + length > m_pendingCommand.size()) {
+        break;
+      }
+      uint8_t checksum{0};
+      for (size_t i{0}; i < length - 1; i++) {
+        checksum ^= m_pendingCommand[offset + i];
+      }
+      if (checksum == m_pendingCommand[offset + length - 1]) {
+        handleCommandWithPayload(command, m_pendingCommand.data() + offset + 3, m_pendingCommand[offset + 2]);
+      }
+      offset += length;
+      continue;
+    }
+    handleCommand(command);
+    offset += 2;
+  }
+  m_pendingCommand.erase(m_pendingCommand.begin(), m_pendingCommand.begin() + static_cast<std::ptrdiff_t>(offset));
+}
+
+void RPLidarEmulator::handleCommand(uint8_t command) noexcept {
+  if ( (RPLidarDecoder::RESET == command) || (RPLidarDecoder::STOP == command) ) {
+    m_scanning = false;
+    if (RPLidarDecoder::RESET == command) {
+      m_healthStatus = HEALTH_GOOD;
+      m_healthErrorCode = 0;
+    }
+  }
+  else if (RPLidarDecoder::GET_INFO == command) {
+    const uint8_t response[]{RPLidarDecoder::SYNC_BYTE0, RPLidarDecoder::SYNC_BYTE1, 0x14, 0x0, 0x0, 0x0, RPLidarDecoder::GOT_INFO,
+                             m_model, 0x1d, 0x1, 0x7, 0x45, 0x4d, 0x55, 0x4c, 0x41, 0x54, 0x4f, 0x52, 0x52, 0x50, 0x4c, 0x49, 0x44, 0x41, 0x52, 0x0};
+    send(response, sizeof(response));
+  }
+  else if (RPLidarDecoder::GET_HEALTH == command) {
+    const uint8_t response[]{RPLidarDecoder::SYNC_BYTE0, RPLidarDecoder::SYNC_BYTE1, 0x3, 0x0, 0x0, 0x0, RPLidarDecoder::GOT_HEALTH,
+                             m_healthStatus, static_cast<uint8_t>(m_healthErrorCode & 0xFF), static_cast<uint8_t>((m_healthErrorCode >> 8) & 0xFF)};
+    send(response, sizeof(response));
+  }
+  else if ( (RPLidarDecoder::SCAN == command) && (HEALTH_ERROR != m_healthStatus) ) {
+    const uint8_t response[]{RPLidarDecoder::SYNC_BYTE0, RPLidarDecoder::SYNC_BYTE1, 0x5, 0x0, 0x0, 0x40, RPLidarDecoder::GOT_SCAN};
+    send(response, sizeof(response));
+    m_scan.clear();
+    m_nextNode = 0;
+    m_nextNodeDue = std::chrono::steady_clock::now();
+    m_scanning = true;
+  }
+}
+
+void RPLidarEmulator::handleCommandWithPayload(uint8_t command, const uint8_t *payload, size_t size) noexcept {
+  // SET_MOTOR_PWM is not supported by the A1, which uses DTR only.
+  if ( (RPLidarDecoder::SET_MOTOR_PWM == command) && (2 == size) && (MODEL_A2 <= m_model) ) {
+    const uint16_t pwm{static_cast<uint16_t>(payload[0] | (payload[1] << 8))};
+    m_motorPwm = pwm;
+    m_targetScanFrequency = MOTOR_GAIN * m_nominalScanFrequency * static_cast<float>(pwm) / 660.0f;
+  }
+}
+
+void RPLidarEmulator::send(const uint8_t *buffer, size_t size) noexcept {
+  std::lock_guard<std::mutex> lck(m_faultInjectorMutex);
+  if (m_faultInjector) {
+    m_faultInjector->inject(buffer, size, std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+  }
+  else {
+    write(buffer, size);
+  }
+}
+
+void RPLidarEmulator::write(const uint8_t *buffer, size_t size) noexcept {
+  while (0 < size) {
+    const ssize_t written = ::write(m_master, buffer, size);
+    if (0 >= written) {
+      // Nobody is reading fast enough; a real device would lose these bytes as well.
+      m_bytesDropped.fetch_add(size, std::memory_order_relaxed);
+      return;
+    }
+    m_bytesSent.fetch_add(static_cast<uint64_t>(written), std::memory_order_relaxed);
+    buffer += written;
+    size -= static_cast<size_t>(written);
+  }
+}
+
+void RPLidarEmulator::stream(std::chrono::steady_clock::time_point now) noexcept {
+  // A stopped motor does not produce any measurements.
+  constexpr const float MIN_SCAN_FREQUENCY{0.5f};
+  if (m_scanFrequency < MIN_SCAN_FREQUENCY) {
+    m_scanFrequency = m_targetScanFrequency.load();
+    m_nextNodeDue = now;
+    return;
+  }
+  std::chrono::nanoseconds nodeInterval{static_cast<int64_t>(1e9 / (static_cast<double>(m_scanFrequency) * m_samplesPerScan))};
+  while (m_nextNodeDue <= now) {
+    if (m_nextNode * 5 >= m_scan.size()) {
+      // The motor follows its target with a lag of about three rotations.
+      const float scanFrequency{m_scanFrequency};
+      m_scanFrequency = scanFrequency + (m_targetScanFrequency - scanFrequency) * 0.3f;
+      nodeInterval = std::chrono::nanoseconds{static_cast<int64_t>(1e9 / (static_cast<double>(m_scanFrequency) * m_samplesPerScan))};
+      m_scan.clear();
+      m_nextNode = 0;
+      {
+        std::lock_guard<std::mutex> lck(m_scanGeneratorMutex);
+        if (nullptr != m_scanGenerator) {
+          m_scanGenerator(m_scanIndex++, m_samplesPerScan, m_scan);
+        }
+      }
+      if (m_scan.empty()) {
+        return;
+      }
+    }
+
+    // Send all nodes that are due within the current rotation at once.
+    size_t nodes{0};
+    while ( (m_nextNodeDue <= now) && ((m_nextNode + nodes) * 5 < m_scan.size()) ) {
+      m_nextNodeDue += nodeInterval;
+      nodes++;
+    }
+    if (0 == m_nextNode) {
+      m_lastScanCompleted.store(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count(), std::memory_order_relaxed);
+      m_scansSent.fetch_add(1, std::memory_order_relaxed);
+    }
+    send(m_scan.data() + m_nextNode * 5, nodes * 5);
+    m_nextNode += nodes;
+  }
+}
@@ -0,0 +1,161 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef RPLIDAR_EMULATOR
+#define RPLIDAR_EMULATOR
+
+#include "fault-injector.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * RPLidarEmulator opens a pseudo-terminal pair and speaks the RPLidar serial
+ * protocol (RESET, GET_INFO, GET_HEALTH, SCAN, STOP) on its master side. The
+ * slave side returned by getDeviceName() can be opened by RPLidar like a real
+ * serial port. While scanning, nodes are streamed paced at the configured
+ * scan frequency and sample density.
+ *
+ * A device in error state does not scan until it was reset, like the real
+ * one after a protection stop.
+ *
+ * Models A2 and above also accept SET_MOTOR_PWM; the motor then approaches
+ * MOTOR_GAIN * scanFrequency * pwm / 660 with a lag of some rotations.
+ */
+class RPLidarEmulator {
+ public:
+  /**
+   * Fills nodes with the 5 bytes measurement nodes for one full rotation;
+   * the first node must carry the start flag.
+   */
+  using ScanGenerator = std::function<void(uint32_t scanIndex, uint32_t samplesPerScan, std::vector<uint8_t> &nodes)>;
+
+  static constexpr const uint8_t MODEL_A1{0x18};
+  static constexpr const uint8_t MODEL_A2{0x28};
+  static constexpr const uint8_t MODEL_A3{0x31};
+  // Emulated motors run slightly slower than nominal to need closed-loop control.
+  static constexpr const float MOTOR_GAIN{0.95f};
+  // Status reported with GET_HEALTH.
+  static constexpr const uint8_t HEALTH_GOOD{0};
+  static constexpr const uint8_t HEALTH_WARNING{1};
+  static constexpr const uint8_t HEALTH_ERROR{2};
+
+ private:
+  RPLidarEmulator(const RPLidarEmulator &) = delete;
+  RPLidarEmulator(RPLidarEmulator &&)      = delete;
+  RPLidarEmulator &operator=(const RPLidarEmulator &) = delete;
+  RPLidarEmulator &operator=(RPLidarEmulator &&) = delete;
+
+ public:
+  RPLidarEmulator(float scanFrequency = 10.0f, uint32_t samplesPerScan = 720) noexcept;
+  ~RPLidarEmulator();
+
+ public:
+  bool isOpen() const noexcept;
+  std::string getDeviceName() const noexcept;
+  void setScanGenerator(ScanGenerator scanGenerator) noexcept;
+  /**
+   * Injects faults into everything sent to the pseudo terminal from now on.
+   */
+  void setFaultProfile(const FaultInjector::Profile &profile, uint32_t seed = 0) noexcept;
+  /**
+   * Model reported with GET_INFO; default: MODEL_A1.
+   */
+  void setModel(uint8_t model) noexcept;
+  /**
+   * Health reported with GET_HEALTH; HEALTH_ERROR also stops scanning. RESET
+   * returns to HEALTH_GOOD.
+   */
+  void setHealth(uint8_t status, uint16_t errorCode = 0) noexcept;
+
+  /**
+   * @return current rotation rate of the emulated motor in Hz.
+   */
+  float scanFrequency() const noexcept;
+  /**
+   * @return latest duty cycle received with SET_MOTOR_PWM; 0 if none.
+   */
+  uint16_t motorPwm() const noexcept;
+
+  bool isScanning() const noexcept;
+  uint64_t scansSent() const noexcept;
+  uint64_t bytesSent() const noexcept;
+  uint64_t bytesDropped() const noexcept;
+  /**
+   * @return steady_clock time stamp in ns when the start node of the latest
+   *         rotation was written, i.e., when the previous rotation was complete.
+   */
+  int64_t lastScanCompleted() const noexcept;
+
+ private:
+  void run() noexcept;
+  void handleCommands(const uint8_t *buffer, size_t size) noexcept;
+  void handleCommand(uint8_t command) noexcept;
+  void handleCommandWithPayload(uint8_t command, const uint8_t *payload, size_t size) noexcept;
+  void send(const uint8_t *buffer, size_t size) noexcept;
+  void write(const uint8_t *buffer, size_t size) noexcept;
+  void stream(std::chrono::steady_clock::time_point now) noexcept;
+
+ private:
+  const float m_nominalScanFrequency;
+  const uint32_t m_samplesPerScan;
+  std::atomic<uint8_t> m_model{MODEL_A1};
+
+  // Motor state; the target is changed by SET_MOTOR_PWM.
+  std::atomic<float> m_scanFrequency{0.0f};
+  std::atomic<float> m_targetScanFrequency{0.0f};
+  std::atomic<uint16_t> m_motorPwm{0};
+
+  std::atomic<uint8_t> m_healthStatus{HEALTH_GOOD};
+  std::atomic<uint16_t> m_healthErrorCode{0};
+
+  int m_master{-1};
+  int m_slave{-1};
+  std::string m_deviceName{};
+
+  std::mutex m_scanGeneratorMutex{};
+  ScanGenerator m_scanGenerator{nullptr};
+
+  std::mutex m_faultInjectorMutex{};
+  std::unique_ptr<FaultInjector> m_faultInjector{nullptr};
+
+  // Command parser state for commands carrying a payload.
+  std::vector<uint8_t> m_pendingCommand{};
+
+  std::atomic<bool> m_scanning{false};
+  std::vector<uint8_t> m_scan{};
+  size_t m_nextNode{0};
+  uint32_t m_scanIndex{0};
+  std::chrono::steady_clock::time_point m_nextNodeDue{};
+
+  std::atomic<uint64_t> m_scansSent{0};
+  std::atomic<uint64_t> m_bytesSent{0};
+  std::atomic<uint64_t> m_bytesDropped{0};
+  std::atomic<int64_t> m_lastScanCompleted{0};
+
+  std::atomic<bool> m_running{false};
+  std::unique_ptr<std::thread> m_thread{nullptr};
+};
+
+#endif
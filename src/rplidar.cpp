@@ -17,45 +17,33 @@
 
 #include "rplidar.hpp"
 
-RPLidar::RPLidar(const std::string &device) noexcept {
+#include <chrono>
+#include <cmath>
+
+namespace {
+// Upper nibble of DeviceInfo::model: 1 = A1, 2 = A2, 3 = A3.
+constexpr const uint8_t MODEL_MAJOR_A2{2};
+}
+
+
+RPLidar::RPLidar(const std::string &device, const std::string &captureFile, IoLoop *ioLoop) noexcept
+  : m_ioLoop{ioLoop} {
   constexpr const uint32_t BAUDRATE{115200};
-  constexpr const uint32_t TIMEOUT{500};
-  try {
-    m_rplidarDevice.reset(new serial::Serial(device, BAUDRATE, serial::Timeout::simpleTimeout(TIMEOUT)));
-    if (isOpen()) {
-      m_rplidarDevice->setDTR(false);
-
-      m_readingBytesFromDeviceThread.reset(new std::thread(
-        [&rplidarDevice = m_rplidarDevice,
-         &decoder = m_decoder](){
-            const uint16_t BUFFER_SIZE{2048};
-            uint8_t *data = new uint8_t[BUFFER_SIZE];
-            size_t size{0};
-            while (rplidarDevice->isOpen()) {
-              if (rplidarDevice->waitReadable()) {
-                size_t bytesAvailable{rplidarDevice->available()};
-                size_t bytesRead = rplidarDevice->read(data+size, ((BUFFER_SIZE - size) < bytesAvailable) ? (BUFFER_SIZE - size) : bytesAvailable);
-                size += bytesRead;
-
-                size_t consumed = decoder.decode(data, size);
-                for (size_t i{0}; (0 < consumed) && (i < (size - consumed)); i++) {
-                  data[i] = data[i + consumed];
-                }
-
-                size -= consumed;
-                // If the parser does not work at all, cancel it.
-                if (size >= BUFFER_SIZE) {
-                  break;
-                }
-              }
-            }
-            delete [] data;
-            data = nullptr;
-          }
-      ));
+  if (!captureFile.empty()) {
+    m_capture.reset(new ByteCapture(captureFile));
+    if (!m_capture->isOpen()) {
+      m_capture.reset(nullptr);
     }
   }
-  catch(...) {}
+  m_rplidarDevice.reset(new SerialPort(device, BAUDRATE));
+  if (isOpen()) {
+    // Adapters without modem control lines (and pseudo terminals) cannot
+    // drive DTR; the motor is then simply left as is.
+    m_rplidarDevice->setDTR(false);
+
+    m_decoder.setLatencyTracer(&m_latencyTracer);
+    startReading();
+  }
 }
 
 RPLidar::~RPLidar() {
@@ -66,59 +54,352 @@ RPLidar::~RPLidar() {
       const std::vector<uint8_t> COMMAND_RESET{RPLidarDecoder::SYNC_BYTE0, RPLidarDecoder::RESET};
       m_rplidarDevice->write(COMMAND_RESET);
     }
+  }
+  // Stop reading before closing the device that is waited on.
+  stopReading();
+  m_rplidarDevice.reset(nullptr);
+  m_capture.reset(nullptr);
+}
+
+void RPLidar::startReading() noexcept {
+  m_buffer.clear();
+  if (nullptr != m_ioLoop) {
+    m_ioLoop->add(m_rplidarDevice->fd(), [this](){ return readAvailable(); });
+    return;
+  }
+  m_readingBytes = true;
+  m_readingBytesFromDeviceThread.reset(new std::thread([this](){
+    constexpr const std::chrono::milliseconds TIMEOUT{500};
+    while (m_readingBytes && isOpen()) {
+      if (m_rplidarDevice->waitReadable(TIMEOUT) && !readAvailable()) {
+        // The device disappeared or the parser does not work at all; a
+        // watchdog can reconnect.
+        break;
+      }
+    }
+  }));
+}
 
-    m_rplidarDevice->close();
+void RPLidar::stopReading() noexcept {
+  if ( (nullptr != m_ioLoop) && m_rplidarDevice ) {
+    m_ioLoop->remove(m_rplidarDevice->fd());
+  }
+  m_readingBytes = false;
+  if (m_readingBytesFromDeviceThread) {
     m_readingBytesFromDeviceThread->join();
   }
-  m_rplidarDevice.reset(nullptr);
+  m_readingBytesFromDeviceThread.reset(nullptr);
+}
+
+bool RPLidar::readAvailable() noexcept {
+  const int64_t bytesRead{m_rplidarDevice->read(m_buffer.tail(), m_buffer.space())};
+  if (0 > bytesRead) {
+    return false;
+  }
+  const int64_t now{LatencyTracer::now()};
+  m_latencyTracer.mark(LatencyTracer::SERIAL_READ, now);
+  m_bytesReceived.fetch_add(static_cast<uint64_t>(bytesRead), std::memory_order_relaxed);
+  if (m_capture) {
+    m_capture->append(m_buffer.tail(), static_cast<size_t>(bytesRead), now);
+  }
+  // If the parser does not work at all, cancel it.
+  const bool decoding{m_buffer.decode(m_decoder, static_cast<size_t>(bytesRead))};
+  controlMotor(now);
+  return decoding;
+}
+
+void RPLidar::setTargetScanFrequency(float targetScanFrequency) noexcept {
+  m_targetScanFrequency = (0.0f < targetScanFrequency) ? targetScanFrequency : 0.0f;
+}
+
+bool RPLidar::hasMotorSpeedControl() const noexcept {
+  return m_motorSpeedControl;
+}
+
+void RPLidar::setMotorPwm(uint16_t pwm) noexcept {
+  pwm = (pwm < MotorController::MAX_PWM) ? pwm : MotorController::MAX_PWM;
+  std::vector<uint8_t> command{RPLidarDecoder::SYNC_BYTE0, RPLidarDecoder::SET_MOTOR_PWM, 0x2, static_cast<uint8_t>(pwm & 0xFF), static_cast<uint8_t>((pwm >> 8) & 0xFF)};
+  uint8_t checksum{0};
+  for (auto b : command) {
+    checksum ^= b;
+  }
+  command.push_back(checksum);
+  if (m_rplidarDevice->write(command)) {
+    m_motorPwm = pwm;
+  }
+}
+
+void RPLidar::controlMotor(int64_t now) noexcept {
+  constexpr const int64_t CONTROL_PERIOD{500 * 1000 * 1000};
+  const float target{m_targetScanFrequency.load(std::memory_order_relaxed)};
+  if ( !m_motorSpeedControl || (0.0f >= target) || ((now - m_lastMotorControl) < CONTROL_PERIOD) ) {
+    return;
+  }
+  if (std::fabs(target - m_motorController.targetFrequency()) > 1e-3f) {
+    m_motorController.setTargetFrequency(target);
+  }
+  const float dt{(0 < m_lastMotorControl) ? static_cast<float>(now - m_lastMotorControl) / 1e9f : 0.0f};
+  m_lastMotorControl = now;
+  const uint16_t pwm{m_motorController.update(m_decoder.getScanFrequency(), dt)};
+  if (pwm != m_motorPwm) {
+    setMotorPwm(pwm);
+  }
 }
 
 bool RPLidar::isOpen() const noexcept {
   return (m_rplidarDevice) && m_rplidarDevice->isOpen();
 }
 
+bool RPLidar::isCapturing() const noexcept {
+  return (nullptr != m_capture);
+}
+
+LatencyTracer &RPLidar::getLatencyTracer() noexcept {
+  return m_latencyTracer;
+}
+
+float RPLidar::getScanFrequency() const noexcept {
+  return m_decoder.getScanFrequency();
+}
+
+std::string RPLidar::getPipelineStatistics() const noexcept {
+  return m_decoder.getPipelineStatistics();
+}
+
+opendlv::device::lidar::rplidar::DriverStatistics RPLidar::getStatistics() const noexcept {
+  opendlv::device::lidar::rplidar::DriverStatistics statistics{m_decoder.getStatistics()};
+  statistics.bytesReceived(m_bytesReceived.load(std::memory_order_relaxed))
+            .targetScanFrequency(m_targetScanFrequency.load(std::memory_order_relaxed))
+            .motorPwm(m_motorPwm.load(std::memory_order_relaxed))
+            .healthChecks(m_healthChecks.load(std::memory_order_relaxed))
+            .healthCheckGap(m_healthCheckGap.load(std::memory_order_relaxed))
+            .deviceResets(m_deviceResets.load(std::memory_order_relaxed))
+            .reconnects(m_reconnects.load(std::memory_order_relaxed))
+            .recoveryTime(m_recoveryTime.load(std::memory_order_relaxed));
+  return statistics;
+}
+
+void RPLidar::setSectorDelegate(
+    uint16_t numberOfSectors,
+    std::function<void(const opendlv::device::lidar::rplidar::SectorMinDistance &)> delegateSectorMinDistance) {
+  m_decoder.setSectorDelegate(numberOfSectors, delegateSectorMinDistance);
+}
+
+void RPLidar::setMount(float x, float y, float yaw, bool flip) noexcept {
+  m_decoder.setMount(x, y, yaw, flip);
+}
+
+void RPLidar::setAngularMasks(const std::vector<std::pair<float, float>> &masks) noexcept {
+  m_decoder.setAngularMasks(masks);
+}
+
+void RPLidar::setRangeGate(float minRange, float maxRange) noexcept {
+  m_decoder.setRangeGate(minRange, maxRange);
+}
+
+void RPLidar::setInvalidSamples(RPLidarDecoder::InvalidSamples invalidSamples,
+    std::function<void(const opendlv::device::lidar::rplidar::ScanValidity &)> delegateScanValidity) noexcept {
+  m_decoder.setInvalidSamples(invalidSamples, delegateScanValidity);
+}
+
+void RPLidar::setScanFilter(const ScanFilter::Config &config) noexcept {
+  m_decoder.setScanFilter(config);
+}
+
+void RPLidar::setPointBudget(uint32_t budget) noexcept {
+  m_decoder.setPointBudget(budget);
+}
+
+bool RPLidar::setPipeline(const std::string &stages) noexcept {
+  return m_decoder.setPipeline(stages);
+}
+
+void RPLidar::setOdometry(const ScanMatcher::Config &config,
+    std::function<void(const opendlv::device::lidar::rplidar::ScanOdometry &)> delegateScanOdometry) noexcept {
+  m_decoder.setOdometry(config, delegateScanOdometry);
+}
+
+void RPLidar::setOccupancyGrid(const OccupancyGrid::Config &config, std::chrono::milliseconds snapshotPeriod,
+    std::function<void(const opendlv::device::lidar::rplidar::OccupancyGridSnapshot &)> delegateOccupancyGridSnapshot) noexcept {
+  m_decoder.setOccupancyGrid(config, snapshotPeriod, delegateOccupancyGridSnapshot);
+}
+
+void RPLidar::setLineSegments(const LineExtractor::Config &config,
+    std::function<void(const opendlv::device::lidar::rplidar::LineSegments &)> delegateLineSegments) noexcept {
+  m_decoder.setLineSegments(config, delegateLineSegments);
+}
+
 void RPLidar::startScanning(
     std::function<void(const opendlv::device::lidar::rplidar::DeviceInfo &)> delegateDeviceInfo,
     std::function<void(const opendlv::device::lidar::rplidar::DeviceHealth &)> delegateDeviceHealth,
-    std::function<void(opendlv::proxy::PointCloudReading pc)> delegateCompleteScan) {
+    std::function<void(const opendlv::proxy::PointCloudReading &)> delegateCompleteScan) {
   // Setup delegates to distribute information.
   m_decoder.setDelegates(delegateDeviceInfo, delegateDeviceHealth, delegateCompleteScan);
 
+  std::this_thread::sleep_for(std::chrono::seconds(1));
+  handshake();
+}
+
+bool RPLidar::handshake() noexcept {
+  m_scanningRequested = true;
+  resetWatchdog();
   // Reset device.
-  {
-    std::this_thread::sleep_for(std::chrono::seconds(1));
-    const std::vector<uint8_t> COMMAND_RESET{RPLidarDecoder::SYNC_BYTE0, RPLidarDecoder::RESET};
-    m_rplidarDevice->write(COMMAND_RESET);
+  const std::vector<uint8_t> COMMAND_RESET{RPLidarDecoder::SYNC_BYTE0, RPLidarDecoder::RESET};
+  if (!m_rplidarDevice->write(COMMAND_RESET)) {
+    return false;
   }
+  // Give the device time to reboot.
+  std::this_thread::sleep_for(std::chrono::milliseconds(500));
+  m_decoder.leaveScanningMode();
 
-  RPLidarDecoder::RPLidarMessages lastMessage{RPLidarDecoder::UNKNOWN};
-  uint8_t attempts{0};
+  // Get device info and health; every attempt waits up to 1 s for the response.
+  const std::chrono::milliseconds RESPONSE_TIMEOUT{1000};
+  uint8_t attempts{4};
+  while (!request(RPLidarDecoder::GET_INFO, RPLidarDecoder::GOT_INFO, RESPONSE_TIMEOUT) && (attempts-- > 0)) {}
 
-  // Get device info.
-  attempts = 4;
-  do {
-    std::this_thread::sleep_for(std::chrono::seconds(1));
-    const std::vector<uint8_t> COMMAND_GET_INFO{RPLidarDecoder::SYNC_BYTE0, RPLidarDecoder::GET_INFO};
-    m_rplidarDevice->write(COMMAND_GET_INFO);
-    lastMessage = m_decoder.getLastRPLidarMessage();
-  } while ((lastMessage != RPLidarDecoder::GOT_INFO) && (attempts-- > 0));
-
-  // Get device health.
   attempts = 4;
-  do {
-    std::this_thread::sleep_for(std::chrono::seconds(1));
-    const std::vector<uint8_t> COMMAND_GET_HEALTH{RPLidarDecoder::SYNC_BYTE0, RPLidarDecoder::GET_HEALTH};
-    m_rplidarDevice->write(COMMAND_GET_HEALTH);
-    lastMessage = m_decoder.getLastRPLidarMessage();
-  } while ((lastMessage != RPLidarDecoder::GOT_HEALTH) && (attempts-- > 0));
+  while (!request(RPLidarDecoder::GET_HEALTH, RPLidarDecoder::GOT_HEALTH, RESPONSE_TIMEOUT) && (attempts-- > 0)) {}
+
+  // A2 and above control the motor speed via SET_MOTOR_PWM; start at the
+  // latest or the feed forward PWM for the target before scanning.
+  m_motorSpeedControl = (MODEL_MAJOR_A2 <= (m_decoder.getDeviceInfo().model() >> 4));
+  if (m_motorSpeedControl && (0.0f < m_targetScanFrequency)) {
+    MotorController initial(m_targetScanFrequency);
+    setMotorPwm((0 < m_motorPwm) ? m_motorPwm.load() : initial.pwm());
+  }
 
   // Enter scanning mode.
-  attempts = 4;
-  do {
-    std::this_thread::sleep_for(std::chrono::seconds(1));
-    const std::vector<uint8_t> COMMAND_GET_SCAN{RPLidarDecoder::SYNC_BYTE0, RPLidarDecoder::SCAN};
-    m_rplidarDevice->write(COMMAND_GET_SCAN);
-    lastMessage = m_decoder.getLastRPLidarMessage();
-  } while ((lastMessage != RPLidarDecoder::GOT_SCAN) && (attempts-- > 0));
+  for (uint8_t attempt{0}; attempt < 5; attempt++) {
+    if (request(RPLidarDecoder::SCAN, RPLidarDecoder::GOT_SCAN, RESPONSE_TIMEOUT)) {
+      resetWatchdog();
+      return true;
+    }
+  }
+  return false;
+}
+
+void RPLidar::resetWatchdog() noexcept {
+  m_watchdogScans = m_decoder.getStatistics().scansEmitted();
+  m_watchdogLastScan = LatencyTracer::now();
 }
 
+bool RPLidar::isStalled(std::chrono::milliseconds deadline) noexcept {
+  if (!m_scanningRequested) {
+    return false;
+  }
+  const int64_t now{LatencyTracer::now()};
+  const uint64_t scans{m_decoder.getStatistics().scansEmitted()};
+  if (scans != m_watchdogScans) {
+    m_watchdogScans = scans;
+    m_watchdogLastScan = now;
+    return false;
+  }
+  return (now - m_watchdogLastScan) > std::chrono::duration_cast<std::chrono::nanoseconds>(deadline).count();
+}
+
+bool RPLidar::reconnect() noexcept {
+  if (!m_rplidarDevice) {
+    return false;
+  }
+  m_reconnects++;
+  stopReading();
+  if (!m_rplidarDevice->open()) {
+    return false;
+  }
+  m_rplidarDevice->setDTR(false);
+  startReading();
+
+  const int64_t lastScan{m_watchdogLastScan};
+  const bool scanning{handshake()};
+  if (scanning) {
+    // Until the first scan after the stall is complete.
+    const uint64_t scans{m_decoder.getStatistics().scansEmitted()};
+    const auto end{std::chrono::steady_clock::now() + std::chrono::seconds(1)};
+    while ( (scans == m_decoder.getStatistics().scansEmitted()) && (std::chrono::steady_clock::now() < end) ) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    m_recoveryTime = static_cast<uint32_t>((LatencyTracer::now() - lastScan) / (1000 * 1000));
+    resetWatchdog();
+  }
+  return scanning;
+}
+
+void RPLidar::stopScanning() noexcept {
+  if (!isOpen()) {
+    return;
+  }
+  const std::vector<uint8_t> COMMAND_STOP{RPLidarDecoder::SYNC_BYTE0, RPLidarDecoder::STOP};
+  m_rplidarDevice->write(COMMAND_STOP);
+  m_scanningRequested = false;
+  // Nodes sent before STOP was processed are still decoded as such; the
+  // device needs at least 1 ms before it accepts the next request.
+  constexpr const std::chrono::milliseconds DRAIN_TIME{10};
+  std::this_thread::sleep_for(DRAIN_TIME);
+  m_decoder.leaveScanningMode();
+}
+
+bool RPLidar::resumeScanning() noexcept {
+  if (!isOpen()) {
+    return false;
+  }
+  m_scanningRequested = true;
+  resetWatchdog();
+  // The device is up already; hence, retry quickly.
+  const std::chrono::milliseconds RESPONSE_TIMEOUT{100};
+  for (uint8_t attempt{0}; attempt < 5; attempt++) {
+    if (request(RPLidarDecoder::SCAN, RPLidarDecoder::GOT_SCAN, RESPONSE_TIMEOUT)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+int8_t RPLidar::checkHealth() noexcept {
+  constexpr const uint8_t HEALTH_ERROR{2};
+  if (!isOpen()) {
+    return -1;
+  }
+
+  // Stop just after a rotation was sent to drop as few samples as possible.
+  {
+    const uint64_t scans{m_decoder.getStatistics().scansEmitted()};
+    const auto end{std::chrono::steady_clock::now() + std::chrono::milliseconds(250)};
+    while ( (scans == m_decoder.getStatistics().scansEmitted()) && (std::chrono::steady_clock::now() < end) ) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+  }
+
+  const auto start{std::chrono::steady_clock::now()};
+  stopScanning();
+  int8_t status{-1};
+  if (request(RPLidarDecoder::GET_HEALTH, RPLidarDecoder::GOT_HEALTH, std::chrono::milliseconds(100))) {
+    status = static_cast<int8_t>(m_decoder.getDeviceHealth().status());
+  }
+  if ( (HEALTH_ERROR == status) || (0 > status) || !resumeScanning() ) {
+    resetAndResumeScanning();
+  }
+  m_healthCheckGap = static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count());
+  m_healthChecks++;
+  return status;
+}
+
+bool RPLidar::resetAndResumeScanning() noexcept {
+  m_deviceResets++;
+  const std::vector<uint8_t> COMMAND_RESET{RPLidarDecoder::SYNC_BYTE0, RPLidarDecoder::RESET};
+  m_rplidarDevice->write(COMMAND_RESET);
+  // Give the device time to reboot; it then also needs the motor PWM again.
+  std::this_thread::sleep_for(std::chrono::milliseconds(500));
+  m_decoder.leaveScanningMode();
+  if (m_motorSpeedControl && (0 < m_motorPwm)) {
+    setMotorPwm(m_motorPwm);
+  }
+  return resumeScanning();
+}
+
+bool RPLidar::request(RPLidarDecoder::RPLidarBytes command, RPLidarDecoder::RPLidarMessages response, std::chrono::milliseconds timeout) noexcept {
+  const std::vector<uint8_t> COMMAND{RPLidarDecoder::SYNC_BYTE0, static_cast<uint8_t>(command)};
+  if (!m_rplidarDevice->write(COMMAND)) {
+    return false;
+  }
+  return m_decoder.waitForMessage(response, timeout);
+}
@@ -20,12 +20,20 @@
 
 #include "opendlv-standard-message-set.hpp"
 #include "rplidar-message-set.hpp"
-#include "serialport.hpp"
 
+#include "byte-capture.hpp"
+#include "decode-buffer.hpp"
+#include "io-loop.hpp"
+#include "latency-tracer.hpp"
+#include "motor-controller.hpp"
 #include "rplidar-decoder.hpp"
+#include "serial-port.hpp"
 
+#include <atomic>
+#include <chrono>
 #include <functional>
 #include <memory>
+#include <string>
 #include <thread>
 
 class RPLidar {
@@ -36,20 +44,168 @@ class RPLidar {
   RPLidar &operator=(RPLidar &&) = delete;
 
  public:
-  RPLidar(const std::string &device) noexcept;
+  /**
+   * Reads from the device with an own thread unless an IoLoop is given that
+   * serves several devices from its thread; the loop must outlive this object.
+   */
+  RPLidar(const std::string &device, const std::string &captureFile = "", IoLoop *ioLoop = nullptr) noexcept;
   ~RPLidar();
 
  public:
   bool isOpen() const noexcept;
+  bool isCapturing() const noexcept;
+  /**
+   * @return tracer for the latencies from reading bytes to publishing scans;
+   * delegates may mark SERIALIZATION_START and UDP_SEND.
+   */
+  LatencyTracer &getLatencyTracer() noexcept;
+  opendlv::device::lidar::rplidar::DriverStatistics getStatistics() const noexcept;
+  /**
+   * @return scan frequency in Hz as estimated by the decoder.
+   */
+  float getScanFrequency() const noexcept;
+  /**
+   * See RPLidarDecoder::getPipelineStatistics.
+   */
+  std::string getPipelineStatistics() const noexcept;
+  /**
+   * Holds the given scan frequency (in Hz) by adjusting the motor PWM; to be
+   * set before startScanning. Only A2 and A3 support SET_MOTOR_PWM; on A1,
+   * DTR can only switch the motor on and off.
+   */
+  void setTargetScanFrequency(float targetScanFrequency) noexcept;
+  /**
+   * @return true if the connected model supports SET_MOTOR_PWM; known after startScanning.
+   */
+  bool hasMotorSpeedControl() const noexcept;
   void startScanning(std::function<void(const opendlv::device::lidar::rplidar::DeviceInfo &)> delegateDeviceInfo,
                      std::function<void(const opendlv::device::lidar::rplidar::DeviceHealth &)> delegateDeviceHealth,
-                     std::function<void(opendlv::proxy::PointCloudReading pc)> delegateCompleteScan);
+                     std::function<void(const opendlv::proxy::PointCloudReading &)> delegateCompleteScan);
+  /**
+   * See RPLidarDecoder::setSectorDelegate; takes effect after stopScanning.
+   */
+  void setSectorDelegate(uint16_t numberOfSectors,
+                         std::function<void(const opendlv::device::lidar::rplidar::SectorMinDistance &)> delegateSectorMinDistance);
+  /**
+   * See RPLidarDecoder::setMount; to be set before startScanning.
+   */
+  void setMount(float x, float y, float yaw, bool flip) noexcept;
+  /**
+   * See RPLidarDecoder::setAngularMasks and setRangeGate; to be set before startScanning.
+   */
+  void setAngularMasks(const std::vector<std::pair<float, float>> &masks) noexcept;
+  void setRangeGate(float minRange, float maxRange) noexcept;
+  /**
+   * See RPLidarDecoder::setScanFilter; to be set before startScanning.
+   */
+  void setScanFilter(const ScanFilter::Config &config) noexcept;
+  /**
+   * See RPLidarDecoder::setPointBudget; to be set before startScanning.
+   */
+  void setPointBudget(uint32_t budget) noexcept;
+  /**
+   * See RPLidarDecoder::setPipeline; to be set before startScanning.
+   */
+  bool setPipeline(const std::string &stages) noexcept;
+  /**
+   * See RPLidarDecoder::setOdometry; to be set before startScanning.
+   */
+  void setOdometry(const ScanMatcher::Config &config,
+                   std::function<void(const opendlv::device::lidar::rplidar::ScanOdometry &)> delegateScanOdometry) noexcept;
+  /**
+   * See RPLidarDecoder::setOccupancyGrid; to be set before startScanning.
+   */
+  void setOccupancyGrid(const OccupancyGrid::Config &config, std::chrono::milliseconds snapshotPeriod,
+                        std::function<void(const opendlv::device::lidar::rplidar::OccupancyGridSnapshot &)> delegateOccupancyGridSnapshot) noexcept;
+  /**
+   * See RPLidarDecoder::setLineSegments; to be set before startScanning.
+   */
+  void setLineSegments(const LineExtractor::Config &config,
+                       std::function<void(const opendlv::device::lidar::rplidar::LineSegments &)> delegateLineSegments) noexcept;
+  /**
+   * See RPLidarDecoder::setInvalidSamples; to be set before startScanning.
+   */
+  void setInvalidSamples(RPLidarDecoder::InvalidSamples invalidSamples,
+                         std::function<void(const opendlv::device::lidar::rplidar::ScanValidity &)> delegateScanValidity = nullptr) noexcept;
+  /**
+   * Sends STOP and lets the decoder leave scanning mode once the nodes still
+   * in flight were decoded; the motor keeps spinning. Settings like sectors
+   * or the target scan frequency can be changed safely afterwards.
+   */
+  void stopScanning() noexcept;
+  /**
+   * Enters scanning mode again after stopScanning without resetting the device.
+   * @return true if the device acknowledged SCAN.
+   */
+  bool resumeScanning() noexcept;
+  /**
+   * Stops scanning right after a rotation was completed, queries the health,
+   * and resumes scanning. A device that reports an error or does not respond
+   * is reset and restarted.
+   * @return status reported by the device (0 = good, 1 = warning, 2 = error); -1 if there was no response.
+   */
+  int8_t checkHealth() noexcept;
+  /**
+   * @return true if scanning was requested but no scan was completed within
+   * the deadline; to be called periodically from one thread.
+   */
+  bool isStalled(std::chrono::milliseconds deadline) noexcept;
+  /**
+   * Reopens the serial port, restarts reading, and repeats the handshake
+   * from startScanning; the time from the last scan before the stall until
+   * the first one afterwards is reported as recoveryTime.
+   * @return true if the device is scanning again.
+   */
+  bool reconnect() noexcept;
 
  private:
-  std::unique_ptr<serial::Serial> m_rplidarDevice{nullptr};
+  /**
+   * Sends the command and waits for the expected response; polling ends as
+   * soon as the response was decoded.
+   */
+  bool request(RPLidarDecoder::RPLidarBytes command, RPLidarDecoder::RPLidarMessages response, std::chrono::milliseconds timeout) noexcept;
+  bool resetAndResumeScanning() noexcept;
+  bool handshake() noexcept;
+  void resetWatchdog() noexcept;
+  void startReading() noexcept;
+  void stopReading() noexcept;
+  /**
+   * Reads and decodes the bytes available; false if the device failed or
+   * the decoder did not consume anything from a full buffer.
+   */
+  bool readAvailable() noexcept;
+  void setMotorPwm(uint16_t pwm) noexcept;
+  void controlMotor(int64_t now) noexcept;
+
+ private:
+  std::unique_ptr<SerialPort> m_rplidarDevice{nullptr};
+  std::unique_ptr<ByteCapture> m_capture{nullptr};
+  IoLoop *m_ioLoop{nullptr};
+  std::atomic<bool> m_readingBytes{true};
+  std::atomic<uint64_t> m_bytesReceived{0};
   std::unique_ptr<std::thread> m_readingBytesFromDeviceThread{nullptr};
+  // Only used from the thread reading bytes.
+  DecodeBuffer m_buffer{};
 
+  LatencyTracer m_latencyTracer{};
   RPLidarDecoder m_decoder{};
+
+  std::atomic<float> m_targetScanFrequency{0.0f};
+  std::atomic<bool> m_motorSpeedControl{false};
+  std::atomic<uint16_t> m_motorPwm{0};
+  // Only used from the thread reading bytes.
+  MotorController m_motorController{};
+  int64_t m_lastMotorControl{0};
+
+  std::atomic<uint64_t> m_healthChecks{0};
+  std::atomic<uint32_t> m_healthCheckGap{0};
+  std::atomic<uint64_t> m_deviceResets{0};
+
+  std::atomic<bool> m_scanningRequested{false};
+  std::atomic<uint64_t> m_watchdogScans{0};
+  std::atomic<int64_t> m_watchdogLastScan{0};
+  std::atomic<uint64_t> m_reconnects{0};
+  std::atomic<uint32_t> m_recoveryTime{0};
 };
 
 #endif
@@ -0,0 +1,89 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "scan-downsampler.hpp"
+
+#include <algorithm>
+
+namespace {
+// Sum of min(1, d / spacing) over all samples; samples without return weigh 0.
+float weights(const float *distances, uint32_t size, float spacing) noexcept {
+  const float inverse{1.0f / spacing};
+  float sum{0.0f};
+  for (uint32_t i{0}; i < size; i++) {
+    sum += std::min(1.0f, std::max(0.0f, distances[i]) * inverse);
+  }
+  return sum;
+}
+}
+
+ScanDownsampler::ScanDownsampler(uint32_t budget) noexcept
+  : m_budget{budget} {
+}
+
+uint32_t ScanDownsampler::budget() const noexcept {
+  return m_budget;
+}
+
+uint32_t ScanDownsampler::apply(float *angles, float *distances, uint32_t size) noexcept {
+  if ( (nullptr == angles) || (nullptr == distances) || (0 == m_budget) ) {
+    return size;
+  }
+
+  uint32_t returns{0};
+  float maxDistance{0.0f};
+  for (uint32_t i{0}; i < size; i++) {
+    returns += (0.0f < distances[i]) ? 1 : 0;
+    maxDistance = std::max(maxDistance, distances[i]);
+  }
+
+  // The weights shrink monotonically with the spacing; bisect for the
+  // spacing at which they add up to the budget.
+  float spacing{0.0f};
+  if (returns > m_budget) {
+    float lower{0.0f};
+    float upper{maxDistance * static_cast<float>(returns) / static_cast<float>(m_budget)};
+    for (uint32_t i{0}; i < 20; i++) {
+      const float middle{0.5f * (lower + upper)};
+      if (weights(distances, size, middle) > static_cast<float>(m_budget)) {
+        lower = middle;
+      }
+      else {
+        upper = middle;
+      }
+    }
+    spacing = upper;
+  }
+
+  const float inverse{(0.0f < spacing) ? 1.0f / spacing : 0.0f};
+  // Starting half way rounds the sum of the weights to the nearest count.
+  float accumulated{0.5f};
+  uint32_t kept{0};
+  for (uint32_t i{0}; (i < size) && (kept < m_budget); i++) {
+    if (!(0.0f < distances[i])) {
+      continue;
+    }
+    accumulated += (0.0f < spacing) ? std::min(1.0f, distances[i] * inverse) : 1.0f;
+    if (1.0f <= accumulated) {
+      accumulated -= 1.0f;
+      angles[kept] = angles[i];
+      distances[kept] = distances[i];
+      kept++;
+    }
+  }
+  return kept;
+}
@@ -0,0 +1,57 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SCAN_DOWNSAMPLER
+#define SCAN_DOWNSAMPLER
+
+#include <cstdint>
+
+/**
+ * ScanDownsampler bounds the number of points per scan by thinning the
+ * samples so that the kept ones are about evenly spaced on the surfaces,
+ * i.e., their angular density grows with range: as samples are about evenly
+ * spaced in azimuth, a sample covers an arc proportional to its distance.
+ * Every sample gets the weight min(1, d / s)
+ * with s chosen so that the weights add up to the budget, and samples are
+ * kept whenever the accumulated weight reaches one. Hence, close surfaces
+ * are thinned while distant, sparse returns are kept. Samples without
+ * return are dropped as well.
+ */
+class ScanDownsampler {
+ private:
+  ScanDownsampler(const ScanDownsampler &) = delete;
+  ScanDownsampler(ScanDownsampler &&)      = delete;
+  ScanDownsampler &operator=(const ScanDownsampler &) = delete;
+  ScanDownsampler &operator=(ScanDownsampler &&) = delete;
+
+ public:
+  explicit ScanDownsampler(uint32_t budget) noexcept;
+  ~ScanDownsampler() = default;
+
+ public:
+  /**
+   * Keeps at most budget samples of the scan at the front of both arrays.
+   * @return number of samples kept.
+   */
+  uint32_t apply(float *angles, float *distances, uint32_t size) noexcept;
+  uint32_t budget() const noexcept;
+
+ private:
+  const uint32_t m_budget;
+};
+
+#endif
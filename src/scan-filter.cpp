@@ -0,0 +1,100 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "scan-filter.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+constexpr const uint32_t ScanFilter::PADDING;
+
+namespace {
+inline float median3(float a, float b, float c) noexcept {
+  return std::max(std::min(a, b), std::min(std::max(a, b), c));
+}
+
+// Neighbours without return take the value of the centre sample.
+inline float orCentre(float neighbour, float centre) noexcept {
+  return (0.0f < neighbour) ? neighbour : centre;
+}
+}
+
+ScanFilter::ScanFilter(const Config &config, uint32_t samplesPerScan) noexcept
+  : m_config{config} {
+  m_padded.reserve(samplesPerScan + 2 * PADDING);
+}
+
+const ScanFilter::Config &ScanFilter::config() const noexcept {
+  return m_config;
+}
+
+void ScanFilter::pad(const float *distances, uint32_t size) noexcept {
+  m_padded.resize(size + 2 * PADDING);
+  for (uint32_t i{0}; i < PADDING; i++) {
+    m_padded[i] = distances[(size - PADDING + i) % size];
+    m_padded[size + PADDING + i] = distances[i % size];
+  }
+  std::memcpy(m_padded.data() + PADDING, distances, size * sizeof(float));
+}
+
+uint32_t ScanFilter::apply(float *distances, uint32_t size) noexcept {
+  if ( (nullptr == distances) || (3 > size) ) {
+    return 0;
+  }
+
+  if (3 == m_config.medianWindow) {
+    pad(distances, size);
+    // q[i + PADDING] is the sample i.
+    const float *q{m_padded.data()};
+    for (uint32_t i{0}; i < size; i++) {
+      const float centre{q[i + 2]};
+      const float median{median3(orCentre(q[i + 1], centre), centre, orCentre(q[i + 3], centre))};
+      distances[i] = (0.0f < centre) ? median : 0.0f;
+    }
+  }
+  else if (5 == m_config.medianWindow) {
+    pad(distances, size);
+    const float *q{m_padded.data()};
+    for (uint32_t i{0}; i < size; i++) {
+      // Median of five from min/max only.
+      const float centre{q[i + 2]};
+      const float a{orCentre(q[i], centre)};
+      const float b{orCentre(q[i + 1], centre)};
+      const float c{orCentre(q[i + 3], centre)};
+      const float d{orCentre(q[i + 4], centre)};
+      const float f{std::max(std::min(a, b), std::min(c, d))};
+      const float g{std::min(std::max(a, b), std::max(c, d))};
+      const float median{median3(centre, f, g)};
+      distances[i] = (0.0f < centre) ? median : 0.0f;
+    }
+  }
+
+  uint32_t removed{0};
+  if (0.0f < m_config.isolationDistance) {
+    pad(distances, size);
+    const float *q{m_padded.data()};
+    const float threshold{m_config.isolationDistance};
+    for (uint32_t i{0}; i < size; i++) {
+      const float d{q[i + 2]};
+      const bool isolated{(0.0f < d) && (threshold < std::fabs(d - q[i + 1])) && (threshold < std::fabs(d - q[i + 3]))};
+      distances[i] = isolated ? 0.0f : d;
+      removed += isolated ? 1 : 0;
+    }
+  }
+  return removed;
+}
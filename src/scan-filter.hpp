@@ -0,0 +1,75 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SCAN_FILTER
+#define SCAN_FILTER
+
+#include <cstdint>
+#include <vector>
+
+/**
+ * ScanFilter removes single-sample spikes from the distances of one scan,
+ * e.g., from dust or mixed pixels at edges: a median over the angular
+ * neighbourhood followed by the removal of isolated samples that differ
+ * from both neighbours by more than a threshold. Scans are treated as
+ * circular. Samples without return (0 m) stay without return and count as
+ * the centre sample in the median, i.e., the median is taken over the
+ * returns and keeps a return whose window holds too few others; removed
+ * samples become samples without return.
+ *
+ * Both passes run over a padded copy of the distances as branchless loops
+ * that the compiler can vectorize.
+ */
+class ScanFilter {
+ public:
+  struct Config {
+    uint32_t medianWindow{0};      // 3 or 5 samples; 0 = off
+    float isolationDistance{0.0f}; // in m; 0 = off
+  };
+
+ private:
+  ScanFilter(const ScanFilter &) = delete;
+  ScanFilter(ScanFilter &&)      = delete;
+  ScanFilter &operator=(const ScanFilter &) = delete;
+  ScanFilter &operator=(ScanFilter &&) = delete;
+
+ public:
+  /**
+   * Buffers are reserved for the given number of samples per scan.
+   */
+  ScanFilter(const Config &config, uint32_t samplesPerScan = 8192) noexcept;
+  ~ScanFilter() = default;
+
+ public:
+  /**
+   * Filters the distances in place.
+   * @return number of samples removed as isolated.
+   */
+  uint32_t apply(float *distances, uint32_t size) noexcept;
+  const Config &config() const noexcept;
+
+ private:
+  void pad(const float *distances, uint32_t size) noexcept;
+
+ private:
+  static constexpr const uint32_t PADDING{2};
+  const Config m_config;
+  // Distances with the last PADDING samples in front and the first ones behind.
+  std::vector<float> m_padded{};
+};
+
+#endif
@@ -0,0 +1,54 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "scan-frequency-estimator.hpp"
+
+constexpr const uint32_t ScanFrequencyEstimator::WINDOW;
+constexpr const float ScanFrequencyEstimator::MAX_FREQUENCY;
+constexpr const int64_t ScanFrequencyEstimator::MAX_GAP;
+
+bool ScanFrequencyEstimator::addStartFlag(int64_t timeStampInNanoseconds) noexcept {
+  if (0 < m_count) {
+    const int64_t latest{m_startFlags[(m_next + WINDOW - 1) % WINDOW]};
+    const int64_t interval{timeStampInNanoseconds - latest};
+    if (static_cast<float>(interval) < 1e9f / MAX_FREQUENCY) {
+      return false;
+    }
+    if (interval > MAX_GAP) {
+      reset();
+    }
+  }
+
+  m_startFlags[m_next] = timeStampInNanoseconds;
+  m_next = (m_next + 1) % WINDOW;
+  m_count = (m_count < WINDOW) ? m_count + 1 : WINDOW;
+  if (1 < m_count) {
+    const int64_t oldest{m_startFlags[(m_next + WINDOW - m_count) % WINDOW]};
+    m_frequency = static_cast<float>(m_count - 1) * 1e9f / static_cast<float>(timeStampInNanoseconds - oldest);
+  }
+  return true;
+}
+
+float ScanFrequencyEstimator::frequency() const noexcept {
+  return m_frequency;
+}
+
+void ScanFrequencyEstimator::reset() noexcept {
+  m_next = 0;
+  m_count = 0;
+  m_frequency = 0.0f;
+}
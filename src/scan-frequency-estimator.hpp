@@ -0,0 +1,59 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SCAN_FREQUENCY_ESTIMATOR
+#define SCAN_FREQUENCY_ESTIMATOR
+
+#include <array>
+#include <cstdint>
+
+/**
+ * ScanFrequencyEstimator derives the rotation rate from the time stamps of
+ * start flags over a window of rotations, which averages out the jitter of
+ * reading the serial port in chunks. Start flags closer than a rotation at
+ * MAX_FREQUENCY are ignored as they stem from corrupted nodes; after a gap of
+ * MAX_GAP, e.g., a stopped motor, the estimation starts over.
+ */
+class ScanFrequencyEstimator {
+ public:
+  static constexpr const uint32_t WINDOW{10};
+  static constexpr const float MAX_FREQUENCY{50.0f};
+  static constexpr const int64_t MAX_GAP{2000 * 1000 * 1000};
+
+ public:
+  ScanFrequencyEstimator() = default;
+  ~ScanFrequencyEstimator() = default;
+
+ public:
+  /**
+   * @return true if the start flag was used for the estimation.
+   */
+  bool addStartFlag(int64_t timeStampInNanoseconds) noexcept;
+  /**
+   * @return scan frequency in Hz; 0 until two start flags were seen.
+   */
+  float frequency() const noexcept;
+  void reset() noexcept;
+
+ private:
+  std::array<int64_t, WINDOW> m_startFlags{};
+  uint32_t m_next{0};
+  uint32_t m_count{0};
+  float m_frequency{0.0f};
+};
+
+#endif
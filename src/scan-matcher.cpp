@@ -0,0 +1,261 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "scan-matcher.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+constexpr const float PI{3.14159265f};
+// Residuals beyond this in m are weighted down.
+constexpr const float HUBER{0.05f};
+// Updates below, i.e., well below the range noise, end the iterations.
+constexpr const float MIN_UPDATE_TRANSLATION{5e-4f};
+constexpr const float MIN_UPDATE_ROTATION{5e-4f};
+
+ScanMatcher::Config sanitized(ScanMatcher::Config config) noexcept {
+  config.angularBins = std::max(config.angularBins, 4u);
+  return config;
+}
+
+float wrap(float angle) noexcept {
+  while (angle > PI) {
+    angle -= 2.0f * PI;
+  }
+  while (angle < -PI) {
+    angle += 2.0f * PI;
+  }
+  return angle;
+}
+}
+
+ScanMatcher::ScanMatcher(const Config &config, uint32_t samplesPerScan) noexcept
+  : m_config{sanitized(config)} {
+  m_currentX.reserve(samplesPerScan);
+  m_currentY.reserve(samplesPerScan);
+  m_referenceX.reserve(samplesPerScan);
+  m_referenceY.reserve(samplesPerScan);
+  m_normalX.reserve(samplesPerScan);
+  m_normalY.reserve(samplesPerScan);
+  m_binStart.reserve(m_config.angularBins + 1);
+  m_binSamples.reserve(samplesPerScan);
+  m_referenceBin.reserve(samplesPerScan);
+}
+
+ScanMatcher::Pose ScanMatcher::pose() const noexcept {
+  return m_pose;
+}
+
+void ScanMatcher::restart() noexcept {
+  m_hasReference = false;
+  m_guess = Pose();
+}
+
+void ScanMatcher::reset() noexcept {
+  restart();
+  m_pose = Pose();
+}
+
+uint32_t ScanMatcher::bin(float x, float y) const noexcept {
+  // Diamond angle in [0, 4): monotonic in the bearing without atan2.
+  const float ax{std::fabs(x)};
+  const float ay{std::fabs(y)};
+  const float sum{ax + ay};
+  if (!(0.0f < sum)) {
+    return 0;
+  }
+  float diamond{0.0f};
+  if (0.0f <= y) {
+    diamond = (0.0f <= x) ? y / sum : 1.0f - x / sum;
+  }
+  else {
+    diamond = (0.0f > x) ? 2.0f - y / sum : 3.0f + x / sum;
+  }
+  const uint32_t b{static_cast<uint32_t>(diamond * 0.25f * static_cast<float>(m_config.angularBins))};
+  return std::min(b, m_config.angularBins - 1);
+}
+
+void ScanMatcher::buildIndex() noexcept {
+  const uint32_t size{static_cast<uint32_t>(m_referenceX.size())};
+  const float MAX_NEIGHBOUR_DISTANCE2{m_config.maxCorrespondenceDistance * m_config.maxCorrespondenceDistance};
+  m_normalX.assign(size, 0.0f);
+  m_normalY.assign(size, 0.0f);
+  m_referenceBin.assign(size, m_config.angularBins);
+  m_binStart.assign(m_config.angularBins + 1, 0);
+
+  // Normals from the neighbours in scan order that lie on the same surface.
+  for (uint32_t i{0}; (2 < size) && (i < size); i++) {
+    const uint32_t previous{(0 == i) ? size - 1 : i - 1};
+    const uint32_t next{(size - 1 == i) ? 0 : i + 1};
+    auto close = [this, i, MAX_NEIGHBOUR_DISTANCE2](uint32_t j){
+      const float dx{m_referenceX[j] - m_referenceX[i]};
+      const float dy{m_referenceY[j] - m_referenceY[i]};
+      return (dx * dx + dy * dy) < MAX_NEIGHBOUR_DISTANCE2;
+    };
+    const uint32_t from{close(previous) ? previous : i};
+    const uint32_t to{close(next) ? next : i};
+    const float tx{m_referenceX[to] - m_referenceX[from]};
+    const float ty{m_referenceY[to] - m_referenceY[from]};
+    const float length{std::sqrt(tx * tx + ty * ty)};
+    if (0.0f < length) {
+      m_normalX[i] = -ty / length;
+      m_normalY[i] = tx / length;
+      m_referenceBin[i] = bin(m_referenceX[i], m_referenceY[i]);
+      m_binStart[m_referenceBin[i]]++;
+    }
+  }
+
+  // Counting sort of the samples with a normal by bin: cumulative counts
+  // are decremented while filling, which leaves the start of every bin.
+  for (uint32_t b{1}; b < m_config.angularBins; b++) {
+    m_binStart[b] += m_binStart[b - 1];
+  }
+  m_binStart[m_config.angularBins] = (0 < m_config.angularBins) ? m_binStart[m_config.angularBins - 1] : 0;
+  m_binSamples.resize(m_binStart[m_config.angularBins]);
+  for (uint32_t i{size}; 0 < i; i--) {
+    if (m_config.angularBins > m_referenceBin[i - 1]) {
+      m_binSamples[--m_binStart[m_referenceBin[i - 1]]] = i - 1;
+    }
+  }
+}
+
+bool ScanMatcher::match(const float *angles, const float *distances, uint32_t size, Result &result) noexcept {
+  result = Result();
+  m_currentX.clear();
+  m_currentY.clear();
+  for (uint32_t i{0}; (nullptr != angles) && (nullptr != distances) && (i < size); i++) {
+    if (0.0f < distances[i]) {
+      // Azimuths are clockwise.
+      const float a{-angles[i] * PI / 180.0f};
+      m_currentX.push_back(distances[i] * std::cos(a));
+      m_currentY.push_back(distances[i] * std::sin(a));
+    }
+  }
+
+  bool matched{false};
+  if (m_hasReference) {
+    const float MAX_DISTANCE2{m_config.maxCorrespondenceDistance * m_config.maxCorrespondenceDistance};
+    const uint32_t BINS{m_config.angularBins};
+    const uint32_t WINDOW{std::min(m_config.searchWindow, BINS / 2)};
+    Pose estimate{m_guess};
+    for (uint32_t iteration{0}; iteration < m_config.maxIterations; iteration++) {
+      const float c{std::cos(estimate.yaw)};
+      const float s{std::sin(estimate.yaw)};
+      // Upper triangle of J^T W J and J^T W e.
+      double h00{0}, h01{0}, h02{0}, h11{0}, h12{0}, h22{0};
+      double g0{0}, g1{0}, g2{0};
+      double squares{0};
+      uint32_t correspondences{0};
+      for (uint32_t i{0}; i < m_currentX.size(); i++) {
+        const float rx{c * m_currentX[i] - s * m_currentY[i]};
+        const float ry{s * m_currentX[i] + c * m_currentY[i]};
+        const float qx{rx + estimate.x};
+        const float qy{ry + estimate.y};
+
+        const uint32_t b{bin(qx, qy)};
+        uint32_t closest{UINT32_MAX};
+        float closestDistance2{MAX_DISTANCE2};
+        for (uint32_t k{0}; k <= 2 * WINDOW; k++) {
+          const uint32_t bb{(b + BINS - WINDOW + k) % BINS};
+          for (uint32_t j{m_binStart[bb]}; j < m_binStart[bb + 1]; j++) {
+            const uint32_t r{m_binSamples[j]};
+            const float dx{qx - m_referenceX[r]};
+            const float dy{qy - m_referenceY[r]};
+            const float d2{dx * dx + dy * dy};
+            if (d2 < closestDistance2) {
+              closestDistance2 = d2;
+              closest = r;
+            }
+          }
+        }
+        if (UINT32_MAX == closest) {
+          continue;
+        }
+
+        const float nx{m_normalX[closest]};
+        const float ny{m_normalY[closest]};
+        const float e{nx * (qx - m_referenceX[closest]) + ny * (qy - m_referenceY[closest])};
+        const float j2{ny * rx - nx * ry};
+        const float w{(std::fabs(e) <= HUBER) ? 1.0f : HUBER / std::fabs(e)};
+        h00 += w * nx * nx; h01 += w * nx * ny; h02 += w * nx * j2;
+        h11 += w * ny * ny; h12 += w * ny * j2; h22 += w * j2 * j2;
+        g0 += w * nx * e; g1 += w * ny * e; g2 += w * j2 * e;
+        squares += e * e;
+        correspondences++;
+      }
+
+      result.iterations = iteration + 1;
+      result.correspondences = correspondences;
+      result.residual = (0 < correspondences) ? static_cast<float>(std::sqrt(squares / correspondences)) : 0.0f;
+      if (correspondences < m_config.minCorrespondences) {
+        break;
+      }
+
+      // Slight damping keeps directions without constraints, e.g., along a
+      // corridor, at the guess; then, Cholesky of the 3x3 system.
+      const double damping{1e-6 * (h00 + h11 + h22) + 1e-9};
+      h00 += damping; h11 += damping; h22 += damping;
+      const double l00{std::sqrt(h00)};
+      const double l10{h01 / l00};
+      const double l20{h02 / l00};
+      const double d11{h11 - l10 * l10};
+      if (!(0.0 < d11)) {
+        break;
+      }
+      const double l11{std::sqrt(d11)};
+      const double l21{(h12 - l20 * l10) / l11};
+      const double d22{h22 - l20 * l20 - l21 * l21};
+      if (!(0.0 < d22)) {
+        break;
+      }
+      const double l22{std::sqrt(d22)};
+      // L y = -g, then L^T x = y.
+      const double y0{-g0 / l00};
+      const double y1{(-g1 - l10 * y0) / l11};
+      const double y2{(-g2 - l20 * y0 - l21 * y1) / l22};
+      const double x2{y2 / l22};
+      const double x1{(y1 - l21 * x2) / l11};
+      const double x0{(y0 - l10 * x1 - l20 * x2) / l00};
+
+      estimate.x += static_cast<float>(x0);
+      estimate.y += static_cast<float>(x1);
+      estimate.yaw = wrap(estimate.yaw + static_cast<float>(x2));
+      if ( (std::fabs(x0) < MIN_UPDATE_TRANSLATION) && (std::fabs(x1) < MIN_UPDATE_TRANSLATION) && (std::fabs(x2) < MIN_UPDATE_ROTATION) ) {
+        result.converged = true;
+        break;
+      }
+    }
+
+    // Without convergence, the motion of the latest converged match is
+    // assumed to go on rather than losing the motion of this scan.
+    result.delta = result.converged ? estimate : m_guess;
+    m_guess = result.delta;
+    const float c{std::cos(m_pose.yaw)};
+    const float s{std::sin(m_pose.yaw)};
+    m_pose.x += c * result.delta.x - s * result.delta.y;
+    m_pose.y += s * result.delta.x + c * result.delta.y;
+    m_pose.yaw = wrap(m_pose.yaw + result.delta.yaw);
+    matched = true;
+  }
+
+  m_referenceX.swap(m_currentX);
+  m_referenceY.swap(m_currentY);
+  buildIndex();
+  m_hasReference = true;
+  return matched;
+}
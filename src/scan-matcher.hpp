@@ -0,0 +1,118 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SCAN_MATCHER
+#define SCAN_MATCHER
+
+#include <cstdint>
+#include <vector>
+
+/**
+ * ScanMatcher estimates the motion of the device between two consecutive
+ * scans with point-to-line ICP: every sample of the current scan is
+ * associated with the closest sample of the previous scan and the distance
+ * along that sample's normal is minimized by Gauss-Newton with a Huber
+ * weight. The motion of the previous scan is the initial guess.
+ *
+ * Candidates are looked up in an angular index of the previous scan: its
+ * samples are grouped by bearing in bins, and only the bins around the
+ * bearing of the transformed sample are searched.
+ *
+ * Poses are in the frame of the device: x forward, y left, yaw
+ * counterclockwise in rad.
+ */
+class ScanMatcher {
+ public:
+  struct Config {
+    uint32_t maxIterations{30};
+    float maxCorrespondenceDistance{0.3f}; // in m
+    uint32_t angularBins{720};
+    uint32_t searchWindow{6};              // bins to either side
+    uint32_t minCorrespondences{30};
+  };
+
+  struct Pose {
+    float x{0.0f};
+    float y{0.0f};
+    float yaw{0.0f};
+  };
+
+  struct Result {
+    Pose delta{};                // current scan in the frame of the previous one
+    uint32_t correspondences{0};
+    uint32_t iterations{0};
+    float residual{0.0f};        // RMS point-to-line distance in m
+    bool converged{false};
+  };
+
+ private:
+  ScanMatcher(const ScanMatcher &) = delete;
+  ScanMatcher(ScanMatcher &&)      = delete;
+  ScanMatcher &operator=(const ScanMatcher &) = delete;
+  ScanMatcher &operator=(ScanMatcher &&) = delete;
+
+ public:
+  /**
+   * Buffers are reserved for the given number of samples per scan.
+   */
+  ScanMatcher(const Config &config, uint32_t samplesPerScan = 8192) noexcept;
+  ~ScanMatcher() = default;
+
+ public:
+  /**
+   * Matches the scan (azimuth clockwise in degree, distance in m; 0 = no
+   * return) against the previous one and keeps it as reference for the
+   * next. If the match does not converge, the initial guess is taken as
+   * the motion and added to the pose, which is less reliable then.
+   * @return false for the first scan.
+   */
+  bool match(const float *angles, const float *distances, uint32_t size, Result &result) noexcept;
+  /**
+   * @return pose of the latest scan in the frame of the first one.
+   */
+  Pose pose() const noexcept;
+  /**
+   * Forgets the reference scan and the motion guess, e.g., after scanning
+   * paused; the next scan becomes the reference. The pose is kept so that
+   * it stays in the same frame.
+   */
+  void restart() noexcept;
+  void reset() noexcept;
+
+ private:
+  void buildIndex() noexcept;
+  uint32_t bin(float x, float y) const noexcept;
+
+ private:
+  const Config m_config;
+  std::vector<float> m_currentX{};
+  std::vector<float> m_currentY{};
+  std::vector<float> m_referenceX{};
+  std::vector<float> m_referenceY{};
+  std::vector<float> m_normalX{};
+  std::vector<float> m_normalY{};
+  // Bin of every reference sample; angularBins for those without normal.
+  std::vector<uint32_t> m_referenceBin{};
+  // Samples of the reference with a normal, grouped by bin.
+  std::vector<uint32_t> m_binStart{};
+  std::vector<uint32_t> m_binSamples{};
+  bool m_hasReference{false};
+  Pose m_guess{};
+  Pose m_pose{};
+};
+
+#endif
@@ -0,0 +1,286 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "scan-merger.hpp"
+
+#include <cmath>
+#include <cstring>
+#include <sstream>
+
+namespace {
+int64_t now() noexcept {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+}
+
+ScanMerger::ScanMerger(const std::vector<Extrinsics> &extrinsics, std::chrono::milliseconds maxScanAge, Delegate delegate) noexcept
+  : m_maxScanAge{std::chrono::duration_cast<std::chrono::nanoseconds>(maxScanAge).count()}
+  , m_delegate{delegate} {
+  for (const auto &e : extrinsics) {
+    std::unique_ptr<Slot> slot{new Slot()};
+    slot->extrinsics = e;
+    m_slots.push_back(std::move(slot));
+  }
+  // The first device is converted by the thread that merges.
+  for (size_t i{1}; i < m_slots.size(); i++) {
+    m_workers.emplace_back(&ScanMerger::work, this, i);
+  }
+}
+
+ScanMerger::~ScanMerger() {
+  {
+    std::lock_guard<std::mutex> lck(m_workMutex);
+    m_running = false;
+  }
+  m_workAvailable.notify_all();
+  if (m_thread) {
+    m_thread->join();
+  }
+  for (auto &worker : m_workers) {
+    worker.join();
+  }
+}
+
+bool ScanMerger::parseExtrinsics(const std::string &text, Extrinsics &extrinsics) noexcept {
+  std::stringstream sstr(text);
+  std::string entry;
+  std::vector<float> values;
+  try {
+    while (std::getline(sstr, entry, ':')) {
+      values.push_back(std::stof(entry));
+    }
+  }
+  catch (...) {
+    return false;
+  }
+  if (3 != values.size()) {
+    return false;
+  }
+  extrinsics.x = values[0];
+  extrinsics.y = values[1];
+  extrinsics.yaw = values[2] * static_cast<float>(M_PI) / 180.0f;
+  return true;
+}
+
+void ScanMerger::addScan(uint32_t device, const opendlv::proxy::PointCloudReading &pc, int64_t endTimeStamp, float scanFrequency) noexcept {
+  if (device < m_slots.size()) {
+    Slot &slot{*m_slots[device]};
+    std::lock_guard<std::mutex> lck(slot.scanMutex);
+    slot.angles = pc.azimuthAngles();
+    slot.distances = pc.distances();
+    slot.endTimeStamp = endTimeStamp;
+    slot.scanFrequency = scanFrequency;
+    slot.fresh = true;
+  }
+}
+
+void ScanMerger::setDeskew(bool deskew) noexcept {
+  std::lock_guard<std::mutex> lck(m_workMutex);
+  m_deskew = deskew;
+}
+
+void ScanMerger::setMotion(float vx, float vy, float yawRate) noexcept {
+  std::lock_guard<std::mutex> lck(m_workMutex);
+  m_motion.vx = vx;
+  m_motion.vy = vy;
+  m_motion.yawRate = yawRate;
+}
+
+void ScanMerger::setVelocity(float vx, float vy) noexcept {
+  std::lock_guard<std::mutex> lck(m_workMutex);
+  m_motion.vx = vx;
+  m_motion.vy = vy;
+}
+
+void ScanMerger::setYawRate(float yawRate) noexcept {
+  std::lock_guard<std::mutex> lck(m_workMutex);
+  m_motion.yawRate = yawRate;
+}
+
+uint32_t ScanMerger::merge(int64_t timeStamp) noexcept {
+  const int64_t start{now()};
+  bool deskew{false};
+  Motion motion;
+  {
+    std::lock_guard<std::mutex> lck(m_workMutex);
+    deskew = m_deskew;
+    motion = m_motion;
+    m_mergeTimeStamp = timeStamp;
+    m_mergeDeskew = deskew;
+    m_mergeMotion = motion;
+    m_pendingWorkers = m_workers.size();
+    m_generation++;
+  }
+  m_workAvailable.notify_all();
+  if (!m_slots.empty()) {
+    convert(*m_slots[0], timeStamp, deskew, motion);
+  }
+  {
+    std::unique_lock<std::mutex> lck(m_workMutex);
+    m_workDone.wait(lck, [this](){ return 0 == m_pendingWorkers; });
+  }
+
+  uint32_t devices{0};
+  uint32_t numberOfPoints{0};
+  int64_t maxScanAge{0};
+  m_points.clear();
+  m_pointsPerDevice.clear();
+  for (const auto &slot : m_slots) {
+    m_points.append(reinterpret_cast<const char*>(slot->points.data()), slot->numberOfPoints * 2 * sizeof(float));
+    m_pointsPerDevice.append(reinterpret_cast<const char*>(&slot->numberOfPoints), sizeof(uint32_t));
+    numberOfPoints += slot->numberOfPoints;
+    if (0 < slot->numberOfPoints) {
+      devices++;
+      maxScanAge = (slot->age > maxScanAge) ? slot->age : maxScanAge;
+    }
+  }
+  m_mergedPointCloud.numberOfPoints(numberOfPoints)
+                    .points(m_points)
+                    .pointsPerDevice(m_pointsPerDevice)
+                    .maxScanAge(static_cast<uint32_t>(maxScanAge / 1000))
+                    .deskewed(deskew);
+  if (nullptr != m_delegate) {
+    m_delegate(m_mergedPointCloud, timeStamp);
+  }
+  m_merges.fetch_add(1, std::memory_order_relaxed);
+  m_mergeDuration.store(static_cast<uint32_t>((now() - start) / 1000), std::memory_order_relaxed);
+  return devices;
+}
+
+void ScanMerger::start(std::chrono::milliseconds period) noexcept {
+  if (m_thread || (0 >= period.count())) {
+    return;
+  }
+  m_thread.reset(new std::thread([this, period](){
+    auto next{std::chrono::steady_clock::now() + period};
+    while (true) {
+      {
+        std::unique_lock<std::mutex> lck(m_workMutex);
+        if (m_workAvailable.wait_until(lck, next, [this](){ return !m_running; })) {
+          return;
+        }
+      }
+      merge(now());
+      next += period;
+      const auto afterMerge{std::chrono::steady_clock::now()};
+      if (afterMerge > next) {
+        m_overruns.fetch_add(1, std::memory_order_relaxed);
+        next = afterMerge + period;
+      }
+    }
+  }));
+}
+
+uint64_t ScanMerger::merges() const noexcept {
+  return m_merges.load(std::memory_order_relaxed);
+}
+
+uint64_t ScanMerger::overruns() const noexcept {
+  return m_overruns.load(std::memory_order_relaxed);
+}
+
+uint32_t ScanMerger::mergeDuration() const noexcept {
+  return m_mergeDuration.load(std::memory_order_relaxed);
+}
+
+void ScanMerger::convert(Slot &slot, int64_t timeStamp, bool deskew, const Motion &motion) noexcept {
+  {
+    std::lock_guard<std::mutex> lck(slot.scanMutex);
+    if (slot.fresh) {
+      slot.angles.swap(slot.mergeAngles);
+      slot.distances.swap(slot.mergeDistances);
+      slot.mergeEndTimeStamp = slot.endTimeStamp;
+      slot.mergeScanFrequency = slot.scanFrequency;
+      slot.fresh = false;
+    }
+  }
+
+  slot.numberOfPoints = 0;
+  slot.age = timeStamp - slot.mergeEndTimeStamp;
+  const size_t N{((slot.mergeAngles.size() < slot.mergeDistances.size()) ? slot.mergeAngles.size() : slot.mergeDistances.size()) / sizeof(float)};
+  if ( (0 == N) || (0 == slot.mergeEndTimeStamp) || (slot.age > m_maxScanAge) ) {
+    return;
+  }
+  if (slot.points.size() < 2 * N) {
+    slot.points.resize(2 * N);
+  }
+
+  // Samples are spread evenly over the scan that ended at mergeEndTimeStamp.
+  const double scanDuration{(0.0f < slot.mergeScanFrequency) ? 1.0 / static_cast<double>(slot.mergeScanFrequency) : 0.0};
+  const double scanAge{static_cast<double>(slot.age) * 1e-9};
+  const float *angles{reinterpret_cast<const float*>(slot.mergeAngles.data())};
+  const float *distances{reinterpret_cast<const float*>(slot.mergeDistances.data())};
+  const Extrinsics &e{slot.extrinsics};
+  const float DEG_TO_RAD{static_cast<float>(M_PI) / 180.0f};
+  float *points{slot.points.data()};
+  uint32_t n{0};
+  for (size_t i{0}; i < N; i++) {
+    float angle;
+    float distance;
+    std::memcpy(&angle, angles + i, sizeof(float));
+    std::memcpy(&distance, distances + i, sizeof(float));
+    if (!(0.0f < distance)) {
+      continue;
+    }
+    // Azimuths of the RPLidar are clockwise.
+    const float phi{e.yaw - angle * DEG_TO_RAD};
+    float x{e.x + distance * std::cos(phi)};
+    float y{e.y + distance * std::sin(phi)};
+    if (deskew) {
+      // Move the sample from the vehicle frame at its time to the one at timeStamp.
+      const float dt{static_cast<float>(scanAge + scanDuration * static_cast<double>(N - i) / static_cast<double>(N))};
+      const float dYaw{motion.yawRate * dt};
+      const float px{x - motion.vx * dt};
+      const float py{y - motion.vy * dt};
+      const float c{std::cos(dYaw)};
+      const float s{std::sin(dYaw)};
+      x = c * px + s * py;
+      y = -s * px + c * py;
+    }
+    points[2 * n] = x;
+    points[2 * n + 1] = y;
+    n++;
+  }
+  slot.numberOfPoints = n;
+}
+
+void ScanMerger::work(size_t slot) noexcept {
+  uint64_t generation{0};
+  while (true) {
+    int64_t timeStamp{0};
+    bool deskew{false};
+    Motion motion;
+    {
+      std::unique_lock<std::mutex> lck(m_workMutex);
+      m_workAvailable.wait(lck, [this, &generation](){ return !m_running || (generation != m_generation); });
+      // Finish a merge that is waiting for this worker before stopping.
+      if (generation == m_generation) {
+        return;
+      }
+      generation = m_generation;
+      timeStamp = m_mergeTimeStamp;
+      deskew = m_mergeDeskew;
+      motion = m_mergeMotion;
+    }
+    convert(*m_slots[slot], timeStamp, deskew, motion);
+    {
+      std::lock_guard<std::mutex> lck(m_workMutex);
+      m_pendingWorkers--;
+    }
+    m_workDone.notify_one();
+  }
+}
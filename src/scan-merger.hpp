@@ -0,0 +1,167 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SCAN_MERGER
+#define SCAN_MERGER
+
+#include "opendlv-standard-message-set.hpp"
+#include "rplidar-message-set.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * ScanMerger combines the latest scans of several devices into one
+ * Cartesian cloud in the vehicle frame (x forward, y left). Every sample is
+ * given the time at which it was measured by spreading the scan period over
+ * the samples that precede the end of the scan; scans that ended longer than
+ * the maximum age before the merge are left out. When deskewing, samples are
+ * moved by the vehicle motion from their time to the time of the merge.
+ *
+ * The scans are converted concurrently with one thread per additional device.
+ */
+class ScanMerger {
+ public:
+  // Pose of a device in the vehicle frame; yaw in rad, counterclockwise.
+  struct Extrinsics {
+    float x{0.0f};
+    float y{0.0f};
+    float yaw{0.0f};
+  };
+
+  using Delegate = std::function<void(opendlv::device::lidar::rplidar::MergedPointCloud &mpc, int64_t timeStamp)>;
+
+ private:
+  ScanMerger(const ScanMerger &) = delete;
+  ScanMerger(ScanMerger &&)      = delete;
+  ScanMerger &operator=(const ScanMerger &) = delete;
+  ScanMerger &operator=(ScanMerger &&) = delete;
+
+ public:
+  ScanMerger(const std::vector<Extrinsics> &extrinsics, std::chrono::milliseconds maxScanAge, Delegate delegate) noexcept;
+  ~ScanMerger();
+
+ public:
+  /**
+   * Parses x:y:yaw with x and y in m and yaw in degree.
+   */
+  static bool parseExtrinsics(const std::string &text, Extrinsics &extrinsics) noexcept;
+
+  /**
+   * Keeps the scan as the latest one of the device; to be called from the
+   * delegate of the decoder.
+   * @param endTimeStamp steady clock time in ns when the scan was completed.
+   * @param scanFrequency in Hz; 0 if unknown to treat all samples as measured at the end.
+   */
+  void addScan(uint32_t device, const opendlv::proxy::PointCloudReading &pc, int64_t endTimeStamp, float scanFrequency) noexcept;
+  void setDeskew(bool deskew) noexcept;
+  /**
+   * Velocity in m/s and yaw rate in rad/s of the vehicle in its own frame.
+   */
+  void setMotion(float vx, float vy, float yawRate) noexcept;
+  void setVelocity(float vx, float vy) noexcept;
+  void setYawRate(float yawRate) noexcept;
+
+  /**
+   * Merges the latest scans at the given steady clock time in ns and hands
+   * the result to the delegate; to be called from one thread at a time.
+   * @return number of devices whose scans were merged.
+   */
+  uint32_t merge(int64_t timeStamp) noexcept;
+  /**
+   * Merges with the given period from an own thread until destruction.
+   */
+  void start(std::chrono::milliseconds period) noexcept;
+
+  uint64_t merges() const noexcept;
+  /**
+   * @return periodic merges that took longer than the period.
+   */
+  uint64_t overruns() const noexcept;
+  /**
+   * @return duration of the latest merge in us.
+   */
+  uint32_t mergeDuration() const noexcept;
+
+ private:
+  struct Motion {
+    float vx{0.0f};
+    float vy{0.0f};
+    float yawRate{0.0f};
+  };
+
+  struct Slot {
+    Extrinsics extrinsics{};
+    // Latest scan as handed over by addScan.
+    std::mutex scanMutex{};
+    std::string angles{};
+    std::string distances{};
+    int64_t endTimeStamp{0};
+    float scanFrequency{0.0f};
+    bool fresh{false};
+    // Only used while merging.
+    std::string mergeAngles{};
+    std::string mergeDistances{};
+    int64_t mergeEndTimeStamp{0};
+    float mergeScanFrequency{0.0f};
+    std::vector<float> points{};
+    uint32_t numberOfPoints{0};
+    int64_t age{0};
+  };
+
+  void convert(Slot &slot, int64_t timeStamp, bool deskew, const Motion &motion) noexcept;
+  void work(size_t slot) noexcept;
+
+ private:
+  const int64_t m_maxScanAge;
+  Delegate m_delegate;
+  std::vector<std::unique_ptr<Slot>> m_slots{};
+
+  std::mutex m_workMutex{};
+  std::condition_variable m_workAvailable{};
+  std::condition_variable m_workDone{};
+  uint64_t m_generation{0};
+  size_t m_pendingWorkers{0};
+  bool m_deskew{false};
+  Motion m_motion{};
+  // Settings of the merge in progress.
+  int64_t m_mergeTimeStamp{0};
+  bool m_mergeDeskew{false};
+  Motion m_mergeMotion{};
+  bool m_running{true};
+  std::vector<std::thread> m_workers{};
+  std::unique_ptr<std::thread> m_thread{nullptr};
+
+  // Reused for every merge.
+  std::string m_points{};
+  std::string m_pointsPerDevice{};
+  opendlv::device::lidar::rplidar::MergedPointCloud m_mergedPointCloud{};
+
+  std::atomic<uint64_t> m_merges{0};
+  std::atomic<uint64_t> m_overruns{0};
+  std::atomic<uint32_t> m_mergeDuration{0};
+};
+
+#endif
@@ -0,0 +1,141 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "scan-options.hpp"
+
+#include <algorithm>
+#include <sstream>
+#include <thread>
+
+bool ScanOptions::parse(std::map<std::string, std::string> &commandlineArguments, size_t numberOfDevices, std::string &error) {
+  sectors = (commandlineArguments.count("sectors") != 0) ? static_cast<uint16_t>(std::stoi(commandlineArguments["sectors"])) : static_cast<uint16_t>(0);
+
+  devices.assign(numberOfDevices, Device());
+  auto perDevice = [&commandlineArguments](const std::string &key, size_t i){
+    const std::vector<std::string> values{(commandlineArguments.count(key) != 0) ? split(commandlineArguments[key]) : std::vector<std::string>()};
+    return (i < values.size()) ? std::stof(values[i]) : 0.0f;
+  };
+  for (size_t i{0}; i < devices.size(); i++) {
+    devices[i].mountX = perDevice("mount-x", i);
+    devices[i].mountY = perDevice("mount-y", i);
+    devices[i].mountYaw = perDevice("mount-yaw", i);
+    devices[i].mountFlip = (0.0f < perDevice("mount-flip", i));
+    devices[i].minRange = perDevice("min-range", i);
+    devices[i].maxRange = perDevice("max-range", i);
+  }
+  if (commandlineArguments.count("mask") != 0) {
+    std::stringstream sstr{commandlineArguments["mask"]};
+    std::string entry;
+    for (size_t i{0}; (i < devices.size()) && std::getline(sstr, entry, '/'); i++) {
+      if (!RPLidarDecoder::parseAngularMasks(entry, devices[i].masks)) {
+        error = "Invalid mask " + entry;
+        return false;
+      }
+    }
+  }
+
+  const std::string INVALID{(commandlineArguments.count("invalid") != 0) ? commandlineArguments["invalid"] : "keep"};
+  if ( ("keep" != INVALID) && ("drop" != INVALID) && ("mark" != INVALID) ) {
+    error = "Invalid --invalid=" + INVALID;
+    return false;
+  }
+  invalidSamples = ("drop" == INVALID) ? RPLidarDecoder::DROP_INVALID : (("mark" == INVALID) ? RPLidarDecoder::MARK_INVALID : RPLidarDecoder::KEEP_INVALID);
+
+  scanFilter.medianWindow = (commandlineArguments.count("median") != 0) ? static_cast<uint32_t>(std::stoi(commandlineArguments["median"])) : 0;
+  scanFilter.isolationDistance = (commandlineArguments.count("outliers") != 0) ? std::stof(commandlineArguments["outliers"]) : 0.0f;
+  if ( (0 != scanFilter.medianWindow) && (3 != scanFilter.medianWindow) && (5 != scanFilter.medianWindow) ) {
+    error = "--median must be 3 or 5";
+    return false;
+  }
+  budget = (commandlineArguments.count("budget") != 0) ? static_cast<uint32_t>(std::stoi(commandlineArguments["budget"])) : 0;
+  odometry = (commandlineArguments.count("odometry") != 0);
+
+  grid.size = (commandlineArguments.count("grid") != 0) ? static_cast<uint32_t>(std::stoi(commandlineArguments["grid"])) : 0;
+  grid.resolution = (commandlineArguments.count("grid-resolution") != 0) ? std::stof(commandlineArguments["grid-resolution"]) : 0.05f;
+  grid.threads = (commandlineArguments.count("grid-threads") != 0) ? static_cast<uint32_t>(std::stoi(commandlineArguments["grid-threads"])) : std::min(4u, std::max(1u, std::thread::hardware_concurrency()));
+  gridRate = (commandlineArguments.count("grid-rate") != 0) ? std::stof(commandlineArguments["grid-rate"]) : 1.0f;
+  if ( (0 < grid.size) && (!(0.0f < grid.resolution) || !(0.0f < gridRate)) ) {
+    error = "--grid-resolution and --grid-rate must be > 0";
+    return false;
+  }
+  if (OccupancyGrid::MAX_SIZE < grid.size) {
+    error = "--grid must be at most " + std::to_string(OccupancyGrid::MAX_SIZE) + " cells per side";
+    return false;
+  }
+
+  lines.splitDistance = (commandlineArguments.count("lines") != 0) ? std::stof(commandlineArguments["lines"]) : 0.0f;
+  linesOnly = (commandlineArguments.count("lines-only") != 0);
+  if (linesOnly && !(0.0f < lines.splitDistance)) {
+    error = "--lines-only needs --lines";
+    return false;
+  }
+
+  pipeline = (commandlineArguments.count("pipeline") != 0) ? commandlineArguments["pipeline"] : "";
+  for (const auto &stage : split(pipeline)) {
+    const bool configured{("median" == stage) ? (0 != scanFilter.medianWindow) : (("outliers" == stage) ? (0.0f < scanFilter.isolationDistance) : (("resample" == stage) ? (0 < budget) : (("odometry" == stage) ? odometry : (("grid" == stage) ? (0 < grid.size) : (("lines" == stage) && (0.0f < lines.splitDistance))))))};
+    if (!configured) {
+      error = "Stage " + stage + " of --pipeline is unknown or not configured by --median, --outliers, --budget, --odometry, --grid, or --lines";
+      return false;
+    }
+  }
+  return true;
+}
+
+std::string ScanOptions::warning() const noexcept {
+  if ( (0 < grid.size) && !odometry ) {
+    return "--grid without --odometry integrates all scans at the pose of the device; only use it for a device standing still";
+  }
+  return "";
+}
+
+std::string ScanOptions::synopsis() noexcept {
+  return "[--sectors=<n>] [--mount-x=<m>] [--mount-y=<m>] [--mount-yaw=<deg>] [--mount-flip=<0|1>] [--mask=<from:to>[,<from:to>...][/...]] [--min-range=<m>] [--max-range=<m>] [--invalid=<keep|drop|mark>] [--median=<3|5>] [--outliers=<m>] [--budget=<n>] [--pipeline=<stage>[,<stage>...]] [--odometry] [--grid=<cells>] [--grid-resolution=<m>] [--grid-rate=<Hz>] [--grid-threads=<n>] [--lines=<m>] [--lines-only]";
+}
+
+std::string ScanOptions::usage() noexcept {
+  std::stringstream sstr;
+  sstr << "         --sectors: additionally send the closest distance per sector for n sectors per scan (default: 0 = off)" << std::endl;
+  sstr << "         --mount-x, --mount-y, --mount-yaw: pose of the device in the vehicle frame to report samples in; m and degree counterclockwise, separated by commas per device (default: 0)" << std::endl;
+  sstr << "         --mount-flip: 1 for a device mounted upside down, separated by commas per device (default: 0)" << std::endl;
+  sstr << "         --mask:    drop samples in these azimuth ranges of the device in degree, e.g., where the vehicle blocks the view; separate devices by / (default: none)" << std::endl;
+  sstr << "         --min-range, --max-range: drop returns closer or farther than this from the device in m, separated by commas per device (default: 0 = no limit)" << std::endl;
+  sstr << "         --invalid: samples without return are kept as 0 m, dropped, or kept and marked in opendlv.device.lidar.rplidar.ScanValidity sent after each scan (default: keep)" << std::endl;
+  sstr << "         --median:  replace every distance by the median of 3 or 5 neighbouring samples (default: 0 = off)" << std::endl;
+  sstr << "         --outliers: remove samples differing from both neighbours by more than this in m, e.g., dust (default: 0 = off)" << std::endl;
+  sstr << "         --budget:  send at most n samples per scan by thinning close surfaces more than distant ones; samples without return are dropped (default: 0 = off)" << std::endl;
+  sstr << "         --odometry: estimate the motion between consecutive scans of every device by ICP and send it as opendlv.device.lidar.rplidar.ScanOdometry" << std::endl;
+  sstr << "         --grid:    integrate the scans of every device into a rolling occupancy grid of this many cells per side around it, at most " << OccupancyGrid::MAX_SIZE << ", at the pose from --odometry; without, the device is assumed to stand still; send it as opendlv.device.lidar.rplidar.OccupancyGridSnapshot (default: 0 = off)" << std::endl;
+  sstr << "         --grid-resolution: size of a grid cell in m (default: 0.05)" << std::endl;
+  sstr << "         --grid-rate: snapshots of the grid per second (default: 1)" << std::endl;
+  sstr << "         --grid-threads: threads that trace angular sectors of a scan in parallel (default: number of cores, at most 4)" << std::endl;
+  sstr << "         --lines:   fit wall segments to every scan with samples at most this far from their segment in m and send them as opendlv.device.lidar.rplidar.LineSegments (default: 0 = off)" << std::endl;
+  sstr << "         --lines-only: send the segments from --lines instead of the PointCloudReading of every scan to save bandwidth" << std::endl;
+  sstr << "         --pipeline: order of median, outliers, resample, odometry, grid, and lines as configured above; masks and range gates always apply first (default: median,outliers,resample,odometry,grid,lines)" << std::endl;
+  return sstr.str();
+}
+
+std::vector<std::string> ScanOptions::split(const std::string &list) noexcept {
+  std::vector<std::string> entries;
+  std::stringstream sstr{list};
+  std::string entry;
+  while (std::getline(sstr, entry, ',')) {
+    if (!entry.empty()) {
+      entries.push_back(entry);
+    }
+  }
+  return entries;
+}
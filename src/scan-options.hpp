@@ -0,0 +1,134 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SCAN_OPTIONS
+#define SCAN_OPTIONS
+
+#include "cluon-complete.hpp"
+
+#include "opendlv-standard-message-set.hpp"
+#include "rplidar-message-set.hpp"
+#include "rplidar-decoder.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * ScanOptions are the command line options that configure how the scans of
+ * a device are decoded and processed. The driver and the replay share them
+ * so that a capture is replayed with the same settings it was recorded with.
+ */
+struct ScanOptions {
+  // Mounting, masks, and range gates of one device.
+  struct Device {
+    float mountX{0.0f};
+    float mountY{0.0f};
+    float mountYaw{0.0f};
+    bool mountFlip{false};
+    std::vector<std::pair<float, float>> masks{};
+    float minRange{0.0f};
+    float maxRange{0.0f};
+  };
+
+  uint16_t sectors{0};
+  std::vector<Device> devices{};
+  RPLidarDecoder::InvalidSamples invalidSamples{RPLidarDecoder::KEEP_INVALID};
+  ScanFilter::Config scanFilter{};
+  uint32_t budget{0};
+  bool odometry{false};
+  OccupancyGrid::Config grid{};
+  float gridRate{1.0f};
+  LineExtractor::Config lines{};
+  bool linesOnly{false};
+  std::string pipeline{};
+
+  /**
+   * Parses the options for the given number of devices; values per device
+   * are separated by commas, masks by /.
+   * @return false with the reason in error for invalid options.
+   */
+  bool parse(std::map<std::string, std::string> &commandlineArguments, size_t numberOfDevices, std::string &error);
+  /**
+   * @return a remark on a valid but questionable combination of options, or
+   * an empty string.
+   */
+  std::string warning() const noexcept;
+
+  /**
+   * Configures the decoder of the given device, either an RPLidarDecoder or
+   * an RPLidar, to send its messages with the sender stamp; to be called
+   * while not scanning.
+   * @return false if the pipeline was rejected.
+   */
+  template <typename Decoder>
+  bool apply(Decoder &decoder, size_t device, cluon::OD4Session &od4, uint32_t senderStamp) const {
+    const Device mount{(device < devices.size()) ? devices[device] : Device()};
+    if (0 < sectors) {
+      decoder.setSectorDelegate(sectors, [&od4, senderStamp](const opendlv::device::lidar::rplidar::SectorMinDistance &smd){
+        opendlv::device::lidar::rplidar::SectorMinDistance msg{smd};
+        od4.send(msg, cluon::time::now(), senderStamp);
+      });
+    }
+    decoder.setMount(mount.mountX, mount.mountY, mount.mountYaw, mount.mountFlip);
+    decoder.setAngularMasks(mount.masks);
+    decoder.setRangeGate(mount.minRange, mount.maxRange);
+    decoder.setScanFilter(scanFilter);
+    decoder.setPointBudget(budget);
+    if (odometry) {
+      decoder.setOdometry(ScanMatcher::Config(), [&od4, senderStamp](const opendlv::device::lidar::rplidar::ScanOdometry &so){
+        opendlv::device::lidar::rplidar::ScanOdometry msg{so};
+        od4.send(msg, cluon::time::now(), senderStamp);
+      });
+    }
+    if (0 < grid.size) {
+      decoder.setOccupancyGrid(grid, std::chrono::milliseconds(static_cast<int64_t>(1000.0f / gridRate)), [&od4, senderStamp](const opendlv::device::lidar::rplidar::OccupancyGridSnapshot &ogs){
+        opendlv::device::lidar::rplidar::OccupancyGridSnapshot msg{ogs};
+        od4.send(msg, cluon::time::now(), senderStamp);
+      });
+    }
+    if (0.0f < lines.splitDistance) {
+      decoder.setLineSegments(lines, [&od4, senderStamp](const opendlv::device::lidar::rplidar::LineSegments &ls){
+        opendlv::device::lidar::rplidar::LineSegments msg{ls};
+        od4.send(msg, cluon::time::now(), senderStamp);
+      });
+    }
+    decoder.setInvalidSamples(invalidSamples, [&od4, senderStamp](const opendlv::device::lidar::rplidar::ScanValidity &sv){
+      opendlv::device::lidar::rplidar::ScanValidity msg{sv};
+      od4.send(msg, cluon::time::now(), senderStamp);
+    });
+    return pipeline.empty() || decoder.setPipeline(pipeline);
+  }
+
+  /**
+   * @return the options in the form of the usage line.
+   */
+  static std::string synopsis() noexcept;
+  /**
+   * @return one line of help per option, indented like the usage.
+   */
+  static std::string usage() noexcept;
+  /**
+   * Splits a list separated by commas and skips empty entries.
+   */
+  static std::vector<std::string> split(const std::string &list) noexcept;
+};
+
+#endif
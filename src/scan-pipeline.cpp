@@ -0,0 +1,33 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "scan-pipeline.hpp"
+
+#include <cstring>
+
+void ScanBuffer::reserve(uint32_t samples) noexcept {
+  angles.reserve(samples);
+  distances.reserve(samples);
+}
+
+void ScanBuffer::assign(const char *a, const char *d, uint32_t samples) noexcept {
+  angles.resize(samples);
+  distances.resize(samples);
+  std::memcpy(angles.data(), a, samples * sizeof(float));
+  std::memcpy(distances.data(), d, samples * sizeof(float));
+  size = samples;
+}
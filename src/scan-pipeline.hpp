@@ -0,0 +1,229 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SCAN_PIPELINE
+#define SCAN_PIPELINE
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <sstream>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+/**
+ * One assembled scan as structure of arrays: azimuth in degree and distance
+ * in m per sample. Stages work in place on the first size samples; removed
+ * samples are either set to 0 m or compacted away.
+ */
+struct ScanBuffer {
+  std::vector<float> angles{};
+  std::vector<float> distances{};
+  uint32_t size{0};
+
+  void reserve(uint32_t samples) noexcept;
+  void assign(const char *angles, const char *distances, uint32_t samples) noexcept;
+};
+
+/**
+ * ScanPipeline runs an ordered subset of its stages over one ScanBuffer per
+ * scan. Stages are plain classes with
+ *   static constexpr const char *NAME
+ *   bool enabled() const noexcept
+ *   uint32_t process(ScanBuffer &) noexcept // samples removed
+ * like the ones in scan-stages.hpp. The stages are fixed at compile time
+ * and dispatched by index, so the calls can be inlined; only their order is
+ * chosen at runtime. Every stage that ran is timed.
+ *
+ * Stages are run and configured from the decoding thread only; statistics
+ * can be read from anywhere.
+ */
+template <typename... Stages>
+class ScanPipeline {
+ public:
+  static constexpr const uint32_t NUMBER_OF_STAGES{sizeof...(Stages)};
+
+  struct Statistics {
+    uint64_t runs{0};
+    uint64_t samplesRemoved{0};
+    int64_t duration{0}; // All in ns.
+    int64_t maxDuration{0};
+  };
+
+ private:
+  ScanPipeline(const ScanPipeline &) = delete;
+  ScanPipeline(ScanPipeline &&)      = delete;
+  ScanPipeline &operator=(const ScanPipeline &) = delete;
+  ScanPipeline &operator=(ScanPipeline &&) = delete;
+
+ public:
+  ScanPipeline() noexcept {
+    for (uint32_t i{0}; i < NUMBER_OF_STAGES; i++) {
+      m_order.push_back(i);
+    }
+  }
+  ~ScanPipeline() = default;
+
+ public:
+  template <typename Stage>
+  Stage &stage() noexcept {
+    return std::get<Stage>(m_stages);
+  }
+
+  template <typename Stage>
+  static constexpr uint32_t indexOf() noexcept {
+    return IndexOf<0, Stage, Stages...>::value;
+  }
+
+  static const char* name(uint32_t index) noexcept {
+    const std::array<const char*, NUMBER_OF_STAGES> NAMES{{Stages::NAME...}};
+    return (NUMBER_OF_STAGES > index) ? NAMES[index] : "unknown";
+  }
+
+  /**
+   * Sets the stages to run from names separated by commas; all stages
+   * run in their declared order by default. Disabled stages are skipped.
+   * @return false for unknown or repeated names; the order is kept then.
+   */
+  bool setOrder(const std::string &names) noexcept {
+    std::vector<uint32_t> order;
+    std::stringstream sstr(names);
+    std::string entry;
+    while (std::getline(sstr, entry, ',')) {
+      uint32_t index{0};
+      while ( (index < NUMBER_OF_STAGES) && (entry != name(index)) ) {
+        index++;
+      }
+      if ( (NUMBER_OF_STAGES == index) || (order.end() != std::find(order.begin(), order.end(), index)) ) {
+        return false;
+      }
+      order.push_back(index);
+    }
+    m_order.swap(order);
+    return true;
+  }
+
+  const std::vector<uint32_t> &order() const noexcept {
+    return m_order;
+  }
+
+  bool enabled() const noexcept {
+    bool enabled{false};
+    for (auto index : m_order) {
+      enabled |= isEnabled<0>(index);
+    }
+    return enabled;
+  }
+
+  /**
+   * @return samples removed by all stages.
+   */
+  uint32_t run(ScanBuffer &buffer) noexcept {
+    uint32_t removed{0};
+    for (auto index : m_order) {
+      if (isEnabled<0>(index)) {
+        const auto start{std::chrono::steady_clock::now()};
+        const uint32_t removedByStage{process<0>(index, buffer)};
+        const int64_t duration{std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count()};
+        Counters &c{m_counters[index]};
+        c.runs.fetch_add(1, std::memory_order_relaxed);
+        c.samplesRemoved.fetch_add(removedByStage, std::memory_order_relaxed);
+        c.duration.fetch_add(duration, std::memory_order_relaxed);
+        if (duration > c.maxDuration.load(std::memory_order_relaxed)) {
+          c.maxDuration.store(duration, std::memory_order_relaxed);
+        }
+        removed += removedByStage;
+      }
+    }
+    return removed;
+  }
+
+  Statistics statistics(uint32_t index) const noexcept {
+    Statistics s;
+    if (NUMBER_OF_STAGES > index) {
+      const Counters &c{m_counters[index]};
+      s.runs = c.runs.load(std::memory_order_relaxed);
+      s.samplesRemoved = c.samplesRemoved.load(std::memory_order_relaxed);
+      s.duration = c.duration.load(std::memory_order_relaxed);
+      s.maxDuration = c.maxDuration.load(std::memory_order_relaxed);
+    }
+    return s;
+  }
+
+  /**
+   * @return one line with mean/max in us and removed samples per stage in
+   * the configured order.
+   */
+  std::string toString() const noexcept {
+    std::stringstream sstr;
+    for (uint32_t i{0}; i < m_order.size(); i++) {
+      const Statistics s{statistics(m_order[i])};
+      sstr << ((0 < i) ? ", " : "") << name(m_order[i]) << ": "
+           << ((0 < s.runs) ? static_cast<double>(s.duration) / static_cast<double>(s.runs) / 1000.0 : 0.0)
+           << "/" << static_cast<double>(s.maxDuration) / 1000.0 << " us, "
+           << s.samplesRemoved << " removed";
+    }
+    return sstr.str();
+  }
+
+ private:
+  template <uint32_t I, typename Stage, typename... Rest>
+  struct IndexOf;
+  template <uint32_t I, typename Stage, typename... Rest>
+  struct IndexOf<I, Stage, Stage, Rest...> : std::integral_constant<uint32_t, I> {};
+  template <uint32_t I, typename Stage, typename Other, typename... Rest>
+  struct IndexOf<I, Stage, Other, Rest...> : IndexOf<I + 1, Stage, Rest...> {};
+
+  template <uint32_t I>
+  typename std::enable_if<(I < NUMBER_OF_STAGES), bool>::type isEnabled(uint32_t index) const noexcept {
+    return (I == index) ? std::get<I>(m_stages).enabled() : isEnabled<I + 1>(index);
+  }
+  template <uint32_t I>
+  typename std::enable_if<(I == NUMBER_OF_STAGES), bool>::type isEnabled(uint32_t) const noexcept {
+    return false;
+  }
+
+  template <uint32_t I>
+  typename std::enable_if<(I < NUMBER_OF_STAGES), uint32_t>::type process(uint32_t index, ScanBuffer &buffer) noexcept {
+    return (I == index) ? std::get<I>(m_stages).process(buffer) : process<I + 1>(index, buffer);
+  }
+  template <uint32_t I>
+  typename std::enable_if<(I == NUMBER_OF_STAGES), uint32_t>::type process(uint32_t, ScanBuffer &) noexcept {
+    return 0;
+  }
+
+ private:
+  struct Counters {
+    std::atomic<uint64_t> runs{0};
+    std::atomic<uint64_t> samplesRemoved{0};
+    std::atomic<int64_t> duration{0};
+    std::atomic<int64_t> maxDuration{0};
+  };
+
+  std::tuple<Stages...> m_stages{};
+  std::vector<uint32_t> m_order{};
+  std::array<Counters, NUMBER_OF_STAGES> m_counters{};
+};
+
+template <typename... Stages>
+constexpr const uint32_t ScanPipeline<Stages...>::NUMBER_OF_STAGES;
+
+#endif
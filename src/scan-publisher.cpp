@@ -0,0 +1,100 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "scan-publisher.hpp"
+
+ScanPublisher::ScanPublisher(Delegate delegate, size_t capacity) noexcept
+  : m_delegate{delegate}
+  , m_entries((0 < capacity) ? capacity : 1) {
+  m_thread.reset(new std::thread(&ScanPublisher::run, this));
+}
+
+ScanPublisher::~ScanPublisher() {
+  stop();
+}
+
+void ScanPublisher::stop() noexcept {
+  {
+    std::lock_guard<std::mutex> lck(m_entriesMutex);
+    m_running = false;
+  }
+  m_entriesAvailable.notify_all();
+  if (m_thread && m_thread->joinable()) {
+    m_thread->join();
+  }
+}
+
+bool ScanPublisher::publish(const opendlv::proxy::PointCloudReading &pc, uint32_t senderStamp, LatencyTracer *latencyTracer) noexcept {
+  {
+    std::lock_guard<std::mutex> lck(m_entriesMutex);
+    if (!m_running || (m_count == m_entries.size())) {
+      m_dropped.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+    Entry &entry = m_entries[(m_head + m_count) % m_entries.size()];
+    entry.pc = pc;
+    entry.senderStamp = senderStamp;
+    entry.latencyTracer = latencyTracer;
+    if (nullptr != latencyTracer) {
+      entry.marks = latencyTracer->release();
+    }
+    m_count++;
+  }
+  m_entriesAvailable.notify_one();
+  return true;
+}
+
+uint64_t ScanPublisher::published() const noexcept {
+  return m_published.load(std::memory_order_relaxed);
+}
+
+uint64_t ScanPublisher::dropped() const noexcept {
+  return m_dropped.load(std::memory_order_relaxed);
+}
+
+void ScanPublisher::run() noexcept {
+  while (true) {
+    Entry *entry{nullptr};
+    {
+      std::unique_lock<std::mutex> lck(m_entriesMutex);
+      m_entriesAvailable.wait(lck, [this](){ return !m_running || (0 < m_count); });
+      if (0 == m_count) {
+        return;
+      }
+      entry = &m_entries[m_head];
+    }
+
+    // Producers only write behind the queued entries; hence, the entry can
+    // be sent without holding the lock.
+    entry->marks[LatencyTracer::SERIALIZATION_START] = LatencyTracer::now();
+    if (nullptr != m_delegate) {
+      try {
+        m_delegate(entry->pc, entry->senderStamp);
+      }
+      catch (...) {}
+    }
+    if (nullptr != entry->latencyTracer) {
+      entry->marks[LatencyTracer::UDP_SEND] = LatencyTracer::now();
+      entry->latencyTracer->complete(entry->marks);
+    }
+    m_published.fetch_add(1, std::memory_order_relaxed);
+
+    std::lock_guard<std::mutex> lck(m_entriesMutex);
+    m_head = (m_head + 1) % m_entries.size();
+    m_count--;
+  }
+}
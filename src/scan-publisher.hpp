@@ -0,0 +1,94 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SCAN_PUBLISHER
+#define SCAN_PUBLISHER
+
+#include "latency-tracer.hpp"
+#include "opendlv-standard-message-set.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * ScanPublisher decouples decoding from sending: scans of several devices
+ * are queued and handed to the delegate from one thread. The queue is a ring
+ * of messages that are reused, i.e., queuing copies into buffers that were
+ * allocated for earlier scans. A scan arriving at a full queue is dropped.
+ */
+class ScanPublisher {
+ public:
+  using Delegate = std::function<void(opendlv::proxy::PointCloudReading &pc, uint32_t senderStamp)>;
+
+ private:
+  ScanPublisher(const ScanPublisher &) = delete;
+  ScanPublisher(ScanPublisher &&)      = delete;
+  ScanPublisher &operator=(const ScanPublisher &) = delete;
+  ScanPublisher &operator=(ScanPublisher &&) = delete;
+
+ public:
+  ScanPublisher(Delegate delegate, size_t capacity = 16) noexcept;
+  ~ScanPublisher();
+
+ public:
+  /**
+   * Takes over the points marked by the given tracer for this scan and
+   * records them including SERIALIZATION_START and UDP_SEND once sent.
+   * @return false if the queue was full or stopped and the scan was dropped.
+   */
+  bool publish(const opendlv::proxy::PointCloudReading &pc, uint32_t senderStamp, LatencyTracer *latencyTracer = nullptr) noexcept;
+  /**
+   * Sends the scans still queued before returning; later ones are dropped.
+   * Call before destroying the tracers that queued scans refer to.
+   */
+  void stop() noexcept;
+  uint64_t published() const noexcept;
+  uint64_t dropped() const noexcept;
+
+ private:
+  void run() noexcept;
+
+ private:
+  struct Entry {
+    opendlv::proxy::PointCloudReading pc{};
+    uint32_t senderStamp{0};
+    LatencyTracer *latencyTracer{nullptr};
+    LatencyTracer::Marks marks{};
+  };
+
+  Delegate m_delegate;
+
+  std::mutex m_entriesMutex{};
+  std::condition_variable m_entriesAvailable{};
+  std::vector<Entry> m_entries;
+  // The entry at m_head stays in place while it is being sent.
+  size_t m_head{0};
+  size_t m_count{0};
+
+  std::atomic<uint64_t> m_published{0};
+  std::atomic<uint64_t> m_dropped{0};
+  bool m_running{true};
+  std::unique_ptr<std::thread> m_thread{nullptr};
+};
+
+#endif
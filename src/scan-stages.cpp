@@ -0,0 +1,147 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "scan-stages.hpp"
+
+constexpr const char *MedianStage::NAME;
+constexpr const char *OutlierStage::NAME;
+constexpr const char *ResampleStage::NAME;
+constexpr const char *OdometryStage::NAME;
+constexpr const char *GridStage::NAME;
+constexpr const char *LineStage::NAME;
+
+void MedianStage::configure(uint32_t window, uint32_t samplesPerScan) noexcept {
+  const bool enabled{(3 == window) || (5 == window)};
+  m_scanFilter.reset(enabled ? new ScanFilter(ScanFilter::Config{window, 0.0f}, samplesPerScan) : nullptr);
+}
+
+bool MedianStage::enabled() const noexcept {
+  return static_cast<bool>(m_scanFilter);
+}
+
+uint32_t MedianStage::process(ScanBuffer &buffer) noexcept {
+  return m_scanFilter->apply(buffer.distances.data(), buffer.size);
+}
+
+void OutlierStage::configure(float isolationDistance, uint32_t samplesPerScan) noexcept {
+  const bool enabled{0.0f < isolationDistance};
+  m_scanFilter.reset(enabled ? new ScanFilter(ScanFilter::Config{0, isolationDistance}, samplesPerScan) : nullptr);
+}
+
+bool OutlierStage::enabled() const noexcept {
+  return static_cast<bool>(m_scanFilter);
+}
+
+uint32_t OutlierStage::process(ScanBuffer &buffer) noexcept {
+  return m_scanFilter->apply(buffer.distances.data(), buffer.size);
+}
+
+void ResampleStage::configure(uint32_t budget) noexcept {
+  m_scanDownsampler.reset((0 < budget) ? new ScanDownsampler(budget) : nullptr);
+}
+
+bool ResampleStage::enabled() const noexcept {
+  return static_cast<bool>(m_scanDownsampler);
+}
+
+uint32_t ResampleStage::process(ScanBuffer &buffer) noexcept {
+  // Count thinned returns only; samples without return, e.g., removed by an
+  // earlier stage, are dropped as well but were counted there.
+  uint32_t returns{0};
+  for (uint32_t i{0}; i < buffer.size; i++) {
+    returns += (0.0f < buffer.distances[i]) ? 1 : 0;
+  }
+  buffer.size = m_scanDownsampler->apply(buffer.angles.data(), buffer.distances.data(), buffer.size);
+  return returns - buffer.size;
+}
+
+void OdometryStage::configure(const ScanMatcher::Config &config, uint32_t samplesPerScan,
+    std::function<void(const ScanMatcher::Result &, const ScanMatcher::Pose &)> delegate) noexcept {
+  m_scanMatcher.reset((nullptr != delegate) ? new ScanMatcher(config, samplesPerScan) : nullptr);
+  m_delegate = delegate;
+}
+
+bool OdometryStage::enabled() const noexcept {
+  return static_cast<bool>(m_scanMatcher);
+}
+
+uint32_t OdometryStage::process(ScanBuffer &buffer) noexcept {
+  if (m_scanMatcher->match(buffer.angles.data(), buffer.distances.data(), buffer.size, m_result)) {
+    try {
+      m_delegate(m_result, m_scanMatcher->pose());
+    }
+    catch (...) {}
+  }
+  return 0;
+}
+
+void OdometryStage::restart() noexcept {
+  if (m_scanMatcher) {
+    m_scanMatcher->restart();
+  }
+}
+
+ScanMatcher::Pose OdometryStage::pose() const noexcept {
+  return m_scanMatcher ? m_scanMatcher->pose() : ScanMatcher::Pose();
+}
+
+void GridStage::configure(const OccupancyGrid::Config &config, std::chrono::milliseconds snapshotPeriod,
+    std::function<ScanMatcher::Pose()> pose,
+    std::function<void(const OccupancyGrid &, const ScanMatcher::Pose &)> delegate) noexcept {
+  m_occupancyGrid.reset((nullptr != delegate) ? new OccupancyGrid(config) : nullptr);
+  m_snapshotPeriod = snapshotPeriod;
+  m_lastSnapshot = std::chrono::steady_clock::time_point();
+  m_pose = pose;
+  m_delegate = delegate;
+}
+
+bool GridStage::enabled() const noexcept {
+  return static_cast<bool>(m_occupancyGrid);
+}
+
+uint32_t GridStage::process(ScanBuffer &buffer) noexcept {
+  const ScanMatcher::Pose pose{(nullptr != m_pose) ? m_pose() : ScanMatcher::Pose()};
+  m_occupancyGrid->integrate(buffer.angles.data(), buffer.distances.data(), buffer.size, pose.x, pose.y, pose.yaw);
+  const auto now{std::chrono::steady_clock::now()};
+  if ((now - m_lastSnapshot) >= m_snapshotPeriod) {
+    m_lastSnapshot = now;
+    try {
+      m_delegate(*m_occupancyGrid, pose);
+    }
+    catch (...) {}
+  }
+  return 0;
+}
+
+void LineStage::configure(const LineExtractor::Config &config, uint32_t samplesPerScan,
+    std::function<void(const LineExtractor &)> delegate) noexcept {
+  m_lineExtractor.reset((nullptr != delegate) ? new LineExtractor(config, samplesPerScan) : nullptr);
+  m_delegate = delegate;
+}
+
+bool LineStage::enabled() const noexcept {
+  return static_cast<bool>(m_lineExtractor);
+}
+
+uint32_t LineStage::process(ScanBuffer &buffer) noexcept {
+  m_lineExtractor->extract(buffer.angles.data(), buffer.distances.data(), buffer.size);
+  try {
+    m_delegate(*m_lineExtractor);
+  }
+  catch (...) {}
+  return 0;
+}
@@ -0,0 +1,212 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SCAN_STAGES
+#define SCAN_STAGES
+
+#include "line-extractor.hpp"
+#include "occupancy-grid.hpp"
+#include "scan-downsampler.hpp"
+#include "scan-filter.hpp"
+#include "scan-matcher.hpp"
+#include "scan-pipeline.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+
+/**
+ * Runs a median over the distances of every scan; see ScanFilter.
+ */
+class MedianStage {
+ private:
+  MedianStage(const MedianStage &) = delete;
+  MedianStage(MedianStage &&)      = delete;
+  MedianStage &operator=(const MedianStage &) = delete;
+  MedianStage &operator=(MedianStage &&) = delete;
+
+ public:
+  static constexpr const char *NAME{"median"};
+  MedianStage() = default;
+  ~MedianStage() = default;
+
+  /**
+   * @param window 3 or 5; 0 = off.
+   */
+  void configure(uint32_t window, uint32_t samplesPerScan) noexcept;
+  bool enabled() const noexcept;
+  uint32_t process(ScanBuffer &buffer) noexcept;
+
+ private:
+  std::unique_ptr<ScanFilter> m_scanFilter{nullptr};
+};
+
+/**
+ * Removes isolated samples from every scan; see ScanFilter.
+ */
+class OutlierStage {
+ private:
+  OutlierStage(const OutlierStage &) = delete;
+  OutlierStage(OutlierStage &&)      = delete;
+  OutlierStage &operator=(const OutlierStage &) = delete;
+  OutlierStage &operator=(OutlierStage &&) = delete;
+
+ public:
+  static constexpr const char *NAME{"outliers"};
+  OutlierStage() = default;
+  ~OutlierStage() = default;
+
+  /**
+   * @param isolationDistance in m; 0 = off.
+   */
+  void configure(float isolationDistance, uint32_t samplesPerScan) noexcept;
+  bool enabled() const noexcept;
+  uint32_t process(ScanBuffer &buffer) noexcept;
+
+ private:
+  std::unique_ptr<ScanFilter> m_scanFilter{nullptr};
+};
+
+/**
+ * Thins every scan to a point budget; see ScanDownsampler.
+ */
+class ResampleStage {
+ private:
+  ResampleStage(const ResampleStage &) = delete;
+  ResampleStage(ResampleStage &&)      = delete;
+  ResampleStage &operator=(const ResampleStage &) = delete;
+  ResampleStage &operator=(ResampleStage &&) = delete;
+
+ public:
+  static constexpr const char *NAME{"resample"};
+  ResampleStage() = default;
+  ~ResampleStage() = default;
+
+  /**
+   * @param budget samples per scan; 0 = off.
+   */
+  void configure(uint32_t budget) noexcept;
+  bool enabled() const noexcept;
+  uint32_t process(ScanBuffer &buffer) noexcept;
+
+ private:
+  std::unique_ptr<ScanDownsampler> m_scanDownsampler{nullptr};
+};
+
+/**
+ * Matches every scan against the previous one and hands the result and the
+ * accumulated pose to the delegate; the scan is left unchanged.
+ */
+class OdometryStage {
+ private:
+  OdometryStage(const OdometryStage &) = delete;
+  OdometryStage(OdometryStage &&)      = delete;
+  OdometryStage &operator=(const OdometryStage &) = delete;
+  OdometryStage &operator=(OdometryStage &&) = delete;
+
+ public:
+  static constexpr const char *NAME{"odometry"};
+  OdometryStage() = default;
+  ~OdometryStage() = default;
+
+  /**
+   * @param delegate nullptr = off.
+   */
+  void configure(const ScanMatcher::Config &config, uint32_t samplesPerScan,
+                 std::function<void(const ScanMatcher::Result &, const ScanMatcher::Pose &)> delegate) noexcept;
+  bool enabled() const noexcept;
+  uint32_t process(ScanBuffer &buffer) noexcept;
+  /**
+   * See ScanMatcher::restart.
+   */
+  void restart() noexcept;
+  /**
+   * @return pose of the latest scan; 0 when off.
+   */
+  ScanMatcher::Pose pose() const noexcept;
+
+ private:
+  std::unique_ptr<ScanMatcher> m_scanMatcher{nullptr};
+  std::function<void(const ScanMatcher::Result &, const ScanMatcher::Pose &)> m_delegate{nullptr};
+  ScanMatcher::Result m_result{};
+};
+
+/**
+ * Integrates every scan into a rolling OccupancyGrid at the pose from the
+ * pose delegate and hands the grid to the snapshot delegate with the given
+ * period; the scan is left unchanged.
+ */
+class GridStage {
+ private:
+  GridStage(const GridStage &) = delete;
+  GridStage(GridStage &&)      = delete;
+  GridStage &operator=(const GridStage &) = delete;
+  GridStage &operator=(GridStage &&) = delete;
+
+ public:
+  static constexpr const char *NAME{"grid"};
+  GridStage() = default;
+  ~GridStage() = default;
+
+  /**
+   * @param delegate nullptr = off.
+   */
+  void configure(const OccupancyGrid::Config &config, std::chrono::milliseconds snapshotPeriod,
+                 std::function<ScanMatcher::Pose()> pose,
+                 std::function<void(const OccupancyGrid &, const ScanMatcher::Pose &)> delegate) noexcept;
+  bool enabled() const noexcept;
+  uint32_t process(ScanBuffer &buffer) noexcept;
+
+ private:
+  std::unique_ptr<OccupancyGrid> m_occupancyGrid{nullptr};
+  std::chrono::steady_clock::duration m_snapshotPeriod{0};
+  std::chrono::steady_clock::time_point m_lastSnapshot{};
+  std::function<ScanMatcher::Pose()> m_pose{nullptr};
+  std::function<void(const OccupancyGrid &, const ScanMatcher::Pose &)> m_delegate{nullptr};
+};
+
+/**
+ * Extracts line segments from every scan and hands the extractor to the
+ * delegate; the scan is left unchanged.
+ */
+class LineStage {
+ private:
+  LineStage(const LineStage &) = delete;
+  LineStage(LineStage &&)      = delete;
+  LineStage &operator=(const LineStage &) = delete;
+  LineStage &operator=(LineStage &&) = delete;
+
+ public:
+  static constexpr const char *NAME{"lines"};
+  LineStage() = default;
+  ~LineStage() = default;
+
+  /**
+   * @param delegate nullptr = off.
+   */
+  void configure(const LineExtractor::Config &config, uint32_t samplesPerScan,
+                 std::function<void(const LineExtractor &)> delegate) noexcept;
+  bool enabled() const noexcept;
+  uint32_t process(ScanBuffer &buffer) noexcept;
+
+ private:
+  std::unique_ptr<LineExtractor> m_lineExtractor{nullptr};
+  std::function<void(const LineExtractor &)> m_delegate{nullptr};
+};
+
+#endif
@@ -0,0 +1,180 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "scan-synthesizer.hpp"
+#include "rplidar-decoder.hpp"
+
+#include <cmath>
+#include <fstream>
+#include <sstream>
+
+namespace {
+constexpr const float PI{3.14159265f};
+}
+
+ScanSynthesizer::ScanSynthesizer(uint32_t seed, float scanFrequency) noexcept
+  : m_seed{seed}
+  , m_scanFrequency{(0.0f < scanFrequency) ? scanFrequency : 10.0f} {
+}
+
+ScanSynthesizer ScanSynthesizer::defaultRoom(uint32_t seed, float scanFrequency) noexcept {
+  ScanSynthesizer synthesizer(seed, scanFrequency);
+  synthesizer.addPolygon({{-5.0f, -3.0f}, {5.0f, -3.0f}, {5.0f, 3.0f}, {-5.0f, 3.0f}});
+  synthesizer.addPolygon({{1.5f, 1.0f}, {2.0f, 1.0f}, {2.0f, 1.5f}, {1.5f, 1.5f}});
+  synthesizer.addPolygon({{-2.5f, -1.5f}, {-2.0f, -1.5f}, {-2.0f, -1.0f}, {-2.5f, -1.0f}});
+  synthesizer.addPolygon({{-1.0f, 2.0f}, {1.0f, 2.2f}});
+  return synthesizer;
+}
+
+bool ScanSynthesizer::loadMap(const std::string &filename) noexcept {
+  bool retVal{false};
+  std::ifstream in(filename);
+  std::string line;
+  while (std::getline(in, line)) {
+    if (line.empty() || ('#' == line[0])) {
+      continue;
+    }
+    std::vector<Point> polygon;
+    std::stringstream sstr(line);
+    std::string vertex;
+    while (sstr >> vertex) {
+      const size_t comma{vertex.find(',')};
+      if (std::string::npos != comma) {
+        try {
+          Point p;
+          p.x = std::stof(vertex.substr(0, comma));
+          p.y = std::stof(vertex.substr(comma + 1));
+          polygon.push_back(p);
+        }
+        catch (...) {}
+      }
+    }
+    if (1 < polygon.size()) {
+      addPolygon(polygon);
+      retVal = true;
+    }
+  }
+  return retVal;
+}
+
+void ScanSynthesizer::addPolygon(const std::vector<Point> &polygon) noexcept {
+  // A polygon with two vertices is a single wall segment; others are closed.
+  const size_t edges{(2 == polygon.size()) ? 1 : polygon.size()};
+  for (size_t i{0}; (1 < polygon.size()) && (i < edges); i++) {
+    m_segmentStarts.push_back(polygon[i]);
+    m_segmentEnds.push_back(polygon[(i + 1) % polygon.size()]);
+  }
+}
+
+void ScanSynthesizer::addObstacle(const Obstacle &obstacle) noexcept {
+  m_obstacles.push_back(obstacle);
+}
+
+void ScanSynthesizer::setNoiseModel(const NoiseModel &noiseModel) noexcept {
+  m_noiseModel = noiseModel;
+}
+
+void ScanSynthesizer::setSensorPose(float x, float y, float yaw) noexcept {
+  m_sensorPosition.x = x;
+  m_sensorPosition.y = y;
+  m_sensorYaw = yaw;
+}
+
+float ScanSynthesizer::castRay(float angle, float t) const noexcept {
+  const float dx{std::cos(angle)};
+  const float dy{std::sin(angle)};
+  float closest{0.0f};
+
+  for (size_t i{0}; i < m_segmentStarts.size(); i++) {
+    const float ex{m_segmentEnds[i].x - m_segmentStarts[i].x};
+    const float ey{m_segmentEnds[i].y - m_segmentStarts[i].y};
+    const float denominator{dx * ey - dy * ex};
+    if (std::fabs(denominator) < 1e-9f) {
+      continue;
+    }
+    const float ax{m_segmentStarts[i].x - m_sensorPosition.x};
+    const float ay{m_segmentStarts[i].y - m_sensorPosition.y};
+    const float distance{(ax * ey - ay * ex) / denominator};
+    const float u{(ax * dy - ay * dx) / denominator};
+    if ( (0.0f < distance) && (0.0f <= u) && (u <= 1.0f) && ((closest <= 0.0f) || (distance < closest)) ) {
+      closest = distance;
+    }
+  }
+
+  for (const auto &o : m_obstacles) {
+    float moving{t};
+    if (0.0f < o.period) {
+      const float phase{std::fmod(t, o.period)};
+      moving = (phase < o.period / 2.0f) ? phase : o.period - phase;
+    }
+    const float fx{m_sensorPosition.x - (o.position.x + o.velocity.x * moving)};
+    const float fy{m_sensorPosition.y - (o.position.y + o.velocity.y * moving)};
+    const float b{fx * dx + fy * dy};
+    const float c{fx * fx + fy * fy - o.radius * o.radius};
+    const float discriminant{b * b - c};
+    if (0.0f > discriminant) {
+      continue;
+    }
+    const float root{std::sqrt(discriminant)};
+    const float distance{(0.0f < -b - root) ? -b - root : -b + root};
+    if ( (0.0f < distance) && ((closest <= 0.0f) || (distance < closest)) ) {
+      closest = distance;
+    }
+  }
+  return closest;
+}
+
+void ScanSynthesizer::synthesize(uint32_t scanIndex, uint32_t samplesPerScan, std::vector<uint8_t> &nodes) noexcept {
+  // One generator per scan to regenerate any scan independently of the others.
+  std::mt19937 generator(m_seed + 0x9E3779B9u * scanIndex);
+  const float scanDuration{1.0f / m_scanFrequency};
+  const float scanStart{static_cast<float>(scanIndex) * scanDuration};
+
+  nodes.reserve(nodes.size() + samplesPerScan * 5);
+  for (uint32_t i{0}; i < samplesPerScan; i++) {
+    const uint16_t angleQ6{static_cast<uint16_t>((static_cast<uint64_t>(i) * 360 * 64) / samplesPerScan)};
+    // The RPLidar measures clockwise.
+    const float angle{m_sensorYaw - static_cast<float>(angleQ6) / 64.0f * PI / 180.0f};
+    const float t{scanStart + scanDuration * static_cast<float>(i) / static_cast<float>(samplesPerScan)};
+
+    float distance{castRay(angle, t)};
+    // Always draw both random numbers to keep the sequence independent of the map.
+    const float dropout{uniform(generator)};
+    const float noise{gaussian(generator)};
+    if (0.0f < distance) {
+      distance += noise * (m_noiseModel.sigma + m_noiseModel.sigmaPerMeter * distance);
+      if ( (dropout < m_noiseModel.dropoutProbability) || (0.0f >= distance) || (distance > m_noiseModel.maxRange) ) {
+        distance = 0.0f;
+      }
+    }
+    const float distanceQ2{std::round(distance * 4000.0f)};
+    const uint16_t rawDistance{static_cast<uint16_t>((distanceQ2 < 65535.0f) ? distanceQ2 : 65535.0f)};
+    RPLidarDecoder::encodeScanNode(nodes, 0 == i, (0 < rawDistance) ? 47 : 0, angleQ6, rawDistance);
+  }
+}
+
+float ScanSynthesizer::uniform(std::mt19937 &generator) const noexcept {
+  // std::uniform_real_distribution is implementation defined; mt19937 is not.
+  return static_cast<float>(generator()) / 4294967296.0f;
+}
+
+float ScanSynthesizer::gaussian(std::mt19937 &generator) const noexcept {
+  // Box-Muller transform.
+  const float u1{(static_cast<float>(generator()) + 1.0f) / 4294967297.0f};
+  const float u2{uniform(generator)};
+  return std::sqrt(-2.0f * std::log(u1)) * std::cos(2.0f * PI * u2);
+}
@@ -0,0 +1,98 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SCAN_SYNTHESIZER
+#define SCAN_SYNTHESIZER
+
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+/**
+ * ScanSynthesizer ray-casts against a 2D map made of polygons and moving
+ * circular obstacles to produce RPLidar measurement nodes. Results only
+ * depend on the seed and the scan index, so any scan can be regenerated
+ * byte by byte on the same platform.
+ */
+class ScanSynthesizer {
+ public:
+  struct Point {
+    float x{0.0f};
+    float y{0.0f};
+  };
+
+  struct Obstacle {
+    Point position{};
+    Point velocity{}; // in m/s
+    float radius{0.25f};
+    float period{0.0f}; // If > 0, the obstacle moves back and forth with this period in s.
+  };
+
+  struct NoiseModel {
+    float sigma{0.0f};           // Constant range noise in m.
+    float sigmaPerMeter{0.0f};   // Range dependent noise in m per m.
+    float dropoutProbability{0.0f};
+    float maxRange{12.0f};       // Beyond, the RPLidar reports no return (0).
+  };
+
+ public:
+  ScanSynthesizer(uint32_t seed = 0, float scanFrequency = 10.0f) noexcept;
+  ~ScanSynthesizer() = default;
+
+ public:
+  /**
+   * Loads polygons from a text file: one closed polygon per line as
+   * whitespace separated "x,y" vertices in m; lines starting with # are ignored.
+   * @return true if at least one polygon was read.
+   */
+  bool loadMap(const std::string &filename) noexcept;
+  void addPolygon(const std::vector<Point> &polygon) noexcept;
+  void addObstacle(const Obstacle &obstacle) noexcept;
+  void setNoiseModel(const NoiseModel &noiseModel) noexcept;
+  void setSensorPose(float x, float y, float yaw) noexcept;
+
+  /**
+   * Appends the nodes of one full rotation; usable as RPLidarEmulator::ScanGenerator.
+   */
+  void synthesize(uint32_t scanIndex, uint32_t samplesPerScan, std::vector<uint8_t> &nodes) noexcept;
+  /**
+   * @return true distance in m along the given ray at time t; 0 if nothing is hit.
+   */
+  float castRay(float angle, float t) const noexcept;
+
+  /**
+   * A 10 m x 6 m room with two pillars and one wall segment as default map.
+   */
+  static ScanSynthesizer defaultRoom(uint32_t seed = 0, float scanFrequency = 10.0f) noexcept;
+
+ private:
+  float gaussian(std::mt19937 &generator) const noexcept;
+  float uniform(std::mt19937 &generator) const noexcept;
+
+ private:
+  uint32_t m_seed;
+  float m_scanFrequency;
+  std::vector<Point> m_segmentStarts{};
+  std::vector<Point> m_segmentEnds{};
+  std::vector<Obstacle> m_obstacles{};
+  NoiseModel m_noiseModel{};
+  Point m_sensorPosition{};
+  float m_sensorYaw{0.0f};
+};
+
+#endif
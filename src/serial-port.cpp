@@ -0,0 +1,153 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "serial-port.hpp"
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include <cerrno>
+
+namespace {
+speed_t toSpeed(uint32_t baudrate) noexcept {
+  switch (baudrate) {
+    case 9600: return B9600;
+    case 19200: return B19200;
+    case 38400: return B38400;
+    case 57600: return B57600;
+    case 230400: return B230400;
+    case 460800: return B460800;
+    case 921600: return B921600;
+    case 1000000: return B1000000;
+    default: return B115200;
+  }
+}
+}
+
+SerialPort::SerialPort(const std::string &device, uint32_t baudrate) noexcept
+  : m_device{device}
+  , m_baudrate{baudrate} {
+  open();
+}
+
+SerialPort::~SerialPort() {
+  close();
+}
+
+bool SerialPort::open() noexcept {
+  close();
+  m_fd = ::open(m_device.c_str(), O_RDWR | O_NOCTTY | O_NONBLOCK);
+  if (-1 == m_fd) {
+    return false;
+  }
+  struct termios options;
+  if (0 != ::tcgetattr(m_fd, &options)) {
+    close();
+    return false;
+  }
+  ::cfmakeraw(&options);
+  options.c_cflag |= (CLOCAL | CREAD);
+  options.c_cflag &= static_cast<tcflag_t>(~(CSTOPB | CRTSCTS));
+  options.c_iflag &= static_cast<tcflag_t>(~(IXON | IXOFF | IXANY));
+  options.c_cc[VMIN] = 0;
+  options.c_cc[VTIME] = 0;
+  ::cfsetispeed(&options, toSpeed(m_baudrate));
+  ::cfsetospeed(&options, toSpeed(m_baudrate));
+  if (0 != ::tcsetattr(m_fd, TCSANOW, &options)) {
+    close();
+    return false;
+  }
+  ::tcflush(m_fd, TCIOFLUSH);
+  return true;
+}
+
+void SerialPort::close() noexcept {
+  if (-1 != m_fd) {
+    ::close(m_fd);
+    m_fd = -1;
+  }
+}
+
+bool SerialPort::isOpen() const noexcept {
+  return (-1 != m_fd);
+}
+
+int SerialPort::fd() const noexcept {
+  return m_fd;
+}
+
+bool SerialPort::waitReadable(std::chrono::milliseconds timeout) const noexcept {
+  if (-1 == m_fd) {
+    return false;
+  }
+  struct pollfd fds{m_fd, POLLIN, 0};
+  return (0 < ::poll(&fds, 1, static_cast<int>(timeout.count()))) && (0 != (fds.revents & (POLLIN | POLLHUP | POLLERR)));
+}
+
+int64_t SerialPort::read(uint8_t *buffer, size_t size) noexcept {
+  if (-1 == m_fd) {
+    return -1;
+  }
+  if (0 == size) {
+    return 0;
+  }
+  const ssize_t bytesRead = ::read(m_fd, buffer, size);
+  if (0 < bytesRead) {
+    return bytesRead;
+  }
+  if ( (0 > bytesRead) && ((EAGAIN == errno) || (EWOULDBLOCK == errno) || (EINTR == errno)) ) {
+    return 0;
+  }
+  // End of file or an error after being readable: the device is gone.
+  return -1;
+}
+
+bool SerialPort::write(const std::vector<uint8_t> &buffer) noexcept {
+  if (-1 == m_fd) {
+    return false;
+  }
+  std::lock_guard<std::mutex> lck(m_writeMutex);
+  constexpr const int TIMEOUT{500};
+  size_t offset{0};
+  while (offset < buffer.size()) {
+    const ssize_t written = ::write(m_fd, buffer.data() + offset, buffer.size() - offset);
+    if (0 < written) {
+      offset += static_cast<size_t>(written);
+    }
+    else if ( (0 > written) && ((EAGAIN == errno) || (EWOULDBLOCK == errno) || (EINTR == errno)) ) {
+      struct pollfd fds{m_fd, POLLOUT, 0};
+      if (0 >= ::poll(&fds, 1, TIMEOUT)) {
+        return false;
+      }
+    }
+    else {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool SerialPort::setDTR(bool dtr) noexcept {
+  if (-1 == m_fd) {
+    return false;
+  }
+  int flags{TIOCM_DTR};
+  return 0 == ::ioctl(m_fd, dtr ? TIOCMBIS : TIOCMBIC, &flags);
+}
@@ -0,0 +1,80 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SERIAL_PORT
+#define SERIAL_PORT
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * SerialPort is a raw 8N1 serial port without flow control on top of a
+ * non-blocking POSIX file descriptor. Unlike serial::Serial, it exposes the
+ * descriptor so that several ports can be served from one epoll loop.
+ */
+class SerialPort {
+ private:
+  SerialPort(const SerialPort &) = delete;
+  SerialPort(SerialPort &&)      = delete;
+  SerialPort &operator=(const SerialPort &) = delete;
+  SerialPort &operator=(SerialPort &&) = delete;
+
+ public:
+  SerialPort(const std::string &device, uint32_t baudrate = 115200) noexcept;
+  ~SerialPort();
+
+ public:
+  /**
+   * (Re-)opens the device given to the constructor.
+   */
+  bool open() noexcept;
+  void close() noexcept;
+  bool isOpen() const noexcept;
+  int fd() const noexcept;
+
+  /**
+   * @return true if bytes can be read; false on timeout or error.
+   */
+  bool waitReadable(std::chrono::milliseconds timeout) const noexcept;
+  /**
+   * @return bytes read, 0 if none are available, or -1 if the device failed
+   * or disappeared.
+   */
+  int64_t read(uint8_t *buffer, size_t size) noexcept;
+  /**
+   * Writes all bytes, waiting up to 500 ms for the device to accept them.
+   * May be called from several threads; every buffer is written as a whole
+   * before the next one, so that command frames do not interleave.
+   */
+  bool write(const std::vector<uint8_t> &buffer) noexcept;
+  /**
+   * Drives DTR, which switches the motor of an A1 off when set; fails on
+   * adapters without modem control lines and on pseudo terminals.
+   */
+  bool setDTR(bool dtr) noexcept;
+
+ private:
+  const std::string m_device;
+  const uint32_t m_baudrate;
+  int m_fd{-1};
+  std::mutex m_writeMutex{};
+};
+
+#endif
@@ -0,0 +1,216 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Built as its own runner as it replaces the global operator new/delete to
+// count heap allocations while decoding.
+
+#define CATCH_CONFIG_MAIN  // This tells Catch to provide a main() - only do this in one cpp file
+#include "catch.hpp"
+
+#include "decode-buffer.hpp"
+#include "fault-injector.hpp"
+#include "line-extractor.hpp"
+#include "rplidar-decoder.hpp"
+#include "scan-synthesizer.hpp"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <vector>
+
+namespace {
+std::atomic<bool> g_countAllocations{false};
+std::atomic<uint64_t> g_allocations{0};
+
+void* allocate(std::size_t size) {
+  if (g_countAllocations.load(std::memory_order_relaxed)) {
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+  }
+  void *ptr = std::malloc((0 < size) ? size : 1);
+  if (nullptr == ptr) {
+    throw std::bad_alloc();
+  }
+  return ptr;
+}
+}
+
+void* operator new(std::size_t size) {
+  return allocate(size);
+}
+
+void* operator new[](std::size_t size) {
+  return allocate(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t &) noexcept {
+  try {
+    return allocate(size);
+  }
+  catch (...) {
+    return nullptr;
+  }
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t &) noexcept {
+  try {
+    return allocate(size);
+  }
+  catch (...) {
+    return nullptr;
+  }
+}
+
+void operator delete(void *ptr) noexcept {
+  std::free(ptr);
+}
+
+void operator delete[](void *ptr) noexcept {
+  std::free(ptr);
+}
+
+void operator delete(void *ptr, std::size_t) noexcept {
+  std::free(ptr);
+}
+
+void operator delete[](void *ptr, std::size_t) noexcept {
+  std::free(ptr);
+}
+
+namespace {
+// Allocations tolerated for the whole steady state.
+constexpr const uint64_t ALLOCATION_BUDGET{0};
+
+// Decodes three minutes of 10 Hz scans in chunks of varying size as read
+// from the serial port and counts allocations after ten seconds of warm up.
+uint64_t allocationsInSteadyState(const std::string &faults, uint64_t &scans) {
+  const uint32_t SAMPLES_PER_SCAN{720};
+  const uint32_t DIFFERENT_SCANS{100};
+  const uint32_t SCANS{1800};
+  const uint32_t WARM_UP_SCANS{100};
+
+  ScanSynthesizer synthesizer{ScanSynthesizer::defaultRoom(0, 10.0f)};
+  ScanSynthesizer::NoiseModel noiseModel;
+  noiseModel.sigma = 0.01f;
+  noiseModel.dropoutProbability = 0.01f;
+  synthesizer.setNoiseModel(noiseModel);
+  std::vector<uint8_t> nodes;
+  for (uint32_t i{0}; i < DIFFERENT_SCANS; i++) {
+    synthesizer.synthesize(i, SAMPLES_PER_SCAN, nodes);
+  }
+  if (!faults.empty()) {
+    FaultInjector::Profile profile;
+    FaultInjector::parseProfile(faults, profile);
+    FaultInjector faultInjector(profile, 1);
+    std::vector<uint8_t> corrupted{nodes.begin(), nodes.begin() + 5};
+    faultInjector.setDelegate([&corrupted](const uint8_t *buffer, size_t size, int64_t){
+      corrupted.insert(corrupted.end(), buffer, buffer + size);
+    });
+    faultInjector.inject(nodes.data() + 5, nodes.size() - 5, 0);
+    faultInjector.flush();
+    corrupted.resize(corrupted.size() - corrupted.size() % 5);
+    nodes.swap(corrupted);
+  }
+
+  RPLidarDecoder decoder;
+  float lastStartAzimuth{0.0f};
+  scans = 0;
+  // Publish callbacks only look at the messages like a serializer would.
+  decoder.setDelegates(nullptr, nullptr, [&scans, &lastStartAzimuth](const opendlv::proxy::PointCloudReading &pc){
+    lastStartAzimuth = pc.startAzimuth();
+    scans++;
+  });
+  uint16_t sectors{0};
+  decoder.setSectorDelegate(36, [&sectors](const opendlv::device::lidar::rplidar::SectorMinDistance &smd){
+    sectors = smd.numberOfSectors();
+  });
+
+  // Same buffering as RPLidar.
+  DecodeBuffer buffer;
+  auto feed = [&decoder, &buffer](const uint8_t *chunk, size_t length){
+    buffer.feed(decoder, chunk, length);
+  };
+
+  const uint8_t DESCRIPTOR[]{RPLidarDecoder::SYNC_BYTE0, RPLidarDecoder::SYNC_BYTE1, 0x5, 0x0, 0x0, 0x40, RPLidarDecoder::GOT_SCAN};
+  feed(DESCRIPTOR, sizeof(DESCRIPTOR));
+
+  const size_t CHUNK_SIZES[]{1, 7, 63, 512, 2048, 13};
+  size_t chunk{0};
+  g_allocations = 0;
+  for (uint32_t i{0}; i < SCANS / DIFFERENT_SCANS; i++) {
+    for (size_t offset{0}; offset < nodes.size(); ) {
+      const size_t length{((offset + CHUNK_SIZES[chunk]) < nodes.size()) ? CHUNK_SIZES[chunk] : nodes.size() - offset};
+      feed(nodes.data() + offset, length);
+      offset += length;
+      chunk = (chunk + 1) % (sizeof(CHUNK_SIZES) / sizeof(CHUNK_SIZES[0]));
+      if (!g_countAllocations && (scans >= WARM_UP_SCANS)) {
+        g_countAllocations = true;
+      }
+    }
+  }
+  g_countAllocations = false;
+  REQUIRE(36 == sectors);
+  REQUIRE(0.0f <= lastStartAzimuth);
+  return g_allocations;
+}
+}
+
+TEST_CASE("Test allocation counting.") {
+  g_allocations = 0;
+  g_countAllocations = true;
+  std::string *s = new std::string(1000, 'x');
+  g_countAllocations = false;
+  delete s;
+  REQUIRE(2 <= g_allocations);
+}
+
+TEST_CASE("Test steady state decoding without allocations.") {
+  uint64_t scans{0};
+  const uint64_t allocations{allocationsInSteadyState("", scans)};
+  REQUIRE(1799 == scans);
+  REQUIRE(ALLOCATION_BUDGET >= allocations);
+}
+
+TEST_CASE("Test steady state decoding of a corrupted stream without allocations.") {
+  uint64_t scans{0};
+  const uint64_t allocations{allocationsInSteadyState("usb", scans)};
+  REQUIRE(1700 < scans);
+  REQUIRE(ALLOCATION_BUDGET >= allocations);
+}
+
+TEST_CASE("Test LineExtractor without allocations for the most pieces.") {
+  // A saw tooth of 2 cm per sample changing direction every 5 samples:
+  // every tooth is one piece of 6 samples sharing its end samples.
+  const uint32_t SAMPLES{720};
+  std::vector<float> angles(SAMPLES);
+  std::vector<float> distances(SAMPLES);
+  for (uint32_t i{0}; i < SAMPLES; i++) {
+    const uint32_t phase{i % 10};
+    angles[i] = static_cast<float>(i) * 0.5f;
+    distances[i] = 2.0f + 0.02f * static_cast<float>((5 > phase) ? phase : 10 - phase);
+  }
+  LineExtractor::Config config;
+  config.minLength = 0.0f;
+  LineExtractor lineExtractor(config, SAMPLES);
+
+  g_allocations = 0;
+  g_countAllocations = true;
+  const uint32_t segments{lineExtractor.extract(angles.data(), distances.data(), SAMPLES)};
+  g_countAllocations = false;
+  REQUIRE(SAMPLES / 6 < segments);
+  REQUIRE(ALLOCATION_BUDGET >= g_allocations);
+}
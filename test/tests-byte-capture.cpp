@@ -0,0 +1,166 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "catch.hpp"
+
+#include "byte-capture.hpp"
+
+#include <sys/resource.h>
+
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+TEST_CASE("Test ByteCapture across extents.") {
+  const std::string FILENAME{"tests-byte-capture.rec"};
+  const size_t EXTENT_SIZE{4096};
+  const uint32_t CHUNKS{1000};
+
+  uint64_t expectedSize{ByteCapture::HEADER_SIZE};
+  {
+    ByteCapture capture(FILENAME, EXTENT_SIZE);
+    REQUIRE(capture.isOpen());
+    std::vector<uint8_t> chunk;
+    for (uint32_t i{0}; i < CHUNKS; i++) {
+      chunk.assign(1 + (i % 37), static_cast<uint8_t>(i));
+      capture.append(chunk.data(), chunk.size(), static_cast<int64_t>(i) * 1000);
+      expectedSize += ByteCapture::RECORD_HEADER_SIZE + chunk.size();
+    }
+    REQUIRE(expectedSize == capture.bytesWritten());
+  }
+
+  std::ifstream in(FILENAME, std::ios::binary);
+  const std::vector<uint8_t> content{std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()};
+  REQUIRE(expectedSize == content.size());
+  REQUIRE(0 == std::memcmp(content.data(), ByteCapture::MAGIC, 8));
+
+  size_t position{ByteCapture::HEADER_SIZE};
+  for (uint32_t i{0}; i < CHUNKS; i++) {
+    int64_t timeStamp{0};
+    uint32_t length{0};
+    std::memcpy(&timeStamp, &content[position], sizeof(int64_t));
+    std::memcpy(&length, &content[position + sizeof(int64_t)], sizeof(uint32_t));
+    position += ByteCapture::RECORD_HEADER_SIZE;
+    REQUIRE(static_cast<int64_t>(i) * 1000 == timeStamp);
+    REQUIRE(1 + (i % 37) == length);
+    REQUIRE(static_cast<uint8_t>(i) == content[position]);
+    REQUIRE(static_cast<uint8_t>(i) == content[position + length - 1]);
+    position += length;
+  }
+  std::remove(FILENAME.c_str());
+}
+
+TEST_CASE("Test ByteCapture leaves out the record that does not fit on disk.") {
+  const std::string FILENAME{"tests-byte-capture-full.rec"};
+  const size_t EXTENT_SIZE{4096};
+  const size_t CHUNK_SIZE{1000};
+
+  // Files cannot grow beyond three extents, as with a full disk.
+  struct rlimit original;
+  REQUIRE(0 == ::getrlimit(RLIMIT_FSIZE, &original));
+  struct rlimit limit{original};
+  limit.rlim_cur = 3 * EXTENT_SIZE;
+  auto previousHandler = std::signal(SIGXFSZ, SIG_IGN);
+  REQUIRE(0 == ::setrlimit(RLIMIT_FSIZE, &limit));
+  uint64_t bytesWritten{0};
+  {
+    ByteCapture capture(FILENAME, EXTENT_SIZE);
+    REQUIRE(capture.isOpen());
+    const std::vector<uint8_t> chunk(CHUNK_SIZE, 0x55);
+    for (uint32_t i{0}; i < 20; i++) {
+      capture.append(chunk.data(), chunk.size(), i);
+    }
+    bytesWritten = capture.bytesWritten();
+  }
+  ::setrlimit(RLIMIT_FSIZE, &original);
+  std::signal(SIGXFSZ, previousHandler);
+
+  REQUIRE(3 * EXTENT_SIZE >= bytesWritten);
+  REQUIRE(0 == (bytesWritten - ByteCapture::HEADER_SIZE) % (ByteCapture::RECORD_HEADER_SIZE + CHUNK_SIZE));
+  std::ifstream in(FILENAME, std::ios::binary | std::ios::ate);
+  REQUIRE(bytesWritten == static_cast<uint64_t>(in.tellg()));
+
+  ByteCaptureReader reader(FILENAME);
+  int64_t timeStamp{0};
+  const uint8_t *data{nullptr};
+  size_t size{0};
+  uint64_t records{0};
+  while (reader.next(timeStamp, data, size)) {
+    REQUIRE(CHUNK_SIZE == size);
+    records++;
+  }
+  REQUIRE((bytesWritten - ByteCapture::HEADER_SIZE) / (ByteCapture::RECORD_HEADER_SIZE + CHUNK_SIZE) == records);
+  std::remove(FILENAME.c_str());
+}
+
+TEST_CASE("Test ByteCaptureReader.") {
+  const std::string FILENAME{"tests-byte-capture-reader.rec"};
+  const std::vector<uint8_t> CHUNK{0xa5, 0x5a, 0x14, 0x0};
+  {
+    ByteCapture capture(FILENAME);
+    capture.append(CHUNK.data(), CHUNK.size(), 10);
+    capture.append(CHUNK.data(), 2, 20);
+  }
+
+  ByteCaptureReader reader(FILENAME);
+  REQUIRE(reader.isOpen());
+  int64_t timeStamp{0};
+  const uint8_t *data{nullptr};
+  size_t size{0};
+  REQUIRE(reader.next(timeStamp, data, size));
+  REQUIRE(10 == timeStamp);
+  REQUIRE(CHUNK.size() == size);
+  REQUIRE(0 == std::memcmp(CHUNK.data(), data, size));
+  REQUIRE(reader.next(timeStamp, data, size));
+  REQUIRE(20 == timeStamp);
+  REQUIRE(2 == size);
+  REQUIRE(!reader.next(timeStamp, data, size));
+
+  reader.rewind();
+  REQUIRE(reader.next(timeStamp, data, size));
+  REQUIRE(10 == timeStamp);
+  std::remove(FILENAME.c_str());
+}
+
+TEST_CASE("Test ByteCaptureReader stops at the preallocated space of a crashed capture.") {
+  const std::string FILENAME{"tests-byte-capture-crashed.rec"};
+  const std::vector<uint8_t> CHUNK{0xa5, 0x5a, 0x14, 0x0};
+  {
+    ByteCapture capture(FILENAME);
+    capture.append(CHUNK.data(), CHUNK.size(), 10);
+  }
+  {
+    // Without the destructor, the zeros of the last extent remain.
+    std::ofstream file(FILENAME, std::ios::binary | std::ios::app);
+    const std::vector<char> reserved(4096, 0);
+    file.write(reserved.data(), static_cast<std::streamsize>(reserved.size()));
+  }
+
+  ByteCaptureReader reader(FILENAME);
+  REQUIRE(reader.isOpen());
+  int64_t timeStamp{0};
+  const uint8_t *data{nullptr};
+  size_t size{0};
+  REQUIRE(reader.next(timeStamp, data, size));
+  REQUIRE(10 == timeStamp);
+  REQUIRE(CHUNK.size() == size);
+  REQUIRE(!reader.next(timeStamp, data, size));
+  std::remove(FILENAME.c_str());
+}
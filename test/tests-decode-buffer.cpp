@@ -0,0 +1,92 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "catch.hpp"
+
+#include "decode-buffer.hpp"
+
+#include <vector>
+
+namespace {
+// Response descriptor for SCAN followed by two rotations with one sample per
+// degree and the start of the third.
+std::vector<uint8_t> twoScans() {
+  std::vector<uint8_t> bytes{0xa5, 0x5a, 0x5, 0x0, 0x0, 0x40, 0x81};
+  for (uint32_t i{0}; i <= 2 * 360; i++) {
+    const uint16_t angleQ6{static_cast<uint16_t>((i % 360) * 64)};
+    const uint16_t distanceQ2{4000};
+    bytes.push_back(static_cast<uint8_t>((0 == (i % 360) ? 0x1 : 0x2) | (15 << 2)));
+    bytes.push_back(static_cast<uint8_t>(((angleQ6 << 1) & 0xFF) | 0x1));
+    bytes.push_back(static_cast<uint8_t>((angleQ6 >> 7) & 0xFF));
+    bytes.push_back(static_cast<uint8_t>(distanceQ2 & 0xFF));
+    bytes.push_back(static_cast<uint8_t>((distanceQ2 >> 8) & 0xFF));
+  }
+  return bytes;
+}
+
+// Header of a response whose payload does not fit into the buffer.
+const std::vector<uint8_t> OVERSIZED_RESPONSE{0xa5, 0x5a, 0x0, 0x10, 0x0, 0x0, 0x81};
+}
+
+TEST_CASE("Test DecodeBuffer keeps incomplete nodes for the next read.") {
+  const std::vector<uint8_t> bytes{twoScans()};
+  REQUIRE(DecodeBuffer::SIZE < bytes.size());
+
+  for (size_t chunkSize : {size_t{1}, size_t{7}, bytes.size()}) {
+    uint32_t clouds{0};
+    RPLidarDecoder decoder;
+    decoder.setDelegates(nullptr, nullptr, [&clouds](const opendlv::proxy::PointCloudReading &pc){
+      REQUIRE(360 * sizeof(float) == pc.distances().size());
+      clouds++;
+    });
+    DecodeBuffer buffer;
+    // Responses are decoded once complete; scans are read in any chunks.
+    const size_t DESCRIPTOR_SIZE{7};
+    REQUIRE(buffer.feed(decoder, bytes.data(), DESCRIPTOR_SIZE));
+    for (size_t offset{DESCRIPTOR_SIZE}; offset < bytes.size(); offset += chunkSize) {
+      REQUIRE(buffer.feed(decoder, bytes.data() + offset, ((offset + chunkSize) < bytes.size()) ? chunkSize : bytes.size() - offset));
+    }
+    REQUIRE(2 == clouds);
+    REQUIRE(0 == decoder.getStatistics().bytesDiscarded());
+  }
+}
+
+TEST_CASE("Test DecodeBuffer stops on overflow.") {
+  std::vector<uint8_t> bytes{OVERSIZED_RESPONSE};
+  bytes.resize(DecodeBuffer::SIZE + 100, 0);
+
+  RPLidarDecoder decoder;
+  DecodeBuffer buffer;
+  REQUIRE(!buffer.feed(decoder, bytes.data(), bytes.size()));
+  REQUIRE(0 == buffer.space());
+  REQUIRE(0 == buffer.discarded());
+}
+
+TEST_CASE("Test DecodeBuffer discards on overflow and goes on.") {
+  std::vector<uint8_t> bytes{OVERSIZED_RESPONSE};
+  bytes.resize(DecodeBuffer::SIZE, 0);
+  const std::vector<uint8_t> scans{twoScans()};
+  bytes.insert(bytes.end(), scans.begin(), scans.end());
+
+  uint32_t clouds{0};
+  RPLidarDecoder decoder;
+  decoder.setDelegates(nullptr, nullptr, [&clouds](const opendlv::proxy::PointCloudReading &){ clouds++; });
+  DecodeBuffer buffer(DecodeBuffer::DISCARD_ON_OVERFLOW);
+  REQUIRE(buffer.feed(decoder, bytes.data(), bytes.size()));
+  REQUIRE(DecodeBuffer::SIZE == buffer.discarded());
+  REQUIRE(2 == clouds);
+}
@@ -0,0 +1,106 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "catch.hpp"
+
+#include "fault-injector.hpp"
+
+#include <vector>
+
+TEST_CASE("Test FaultInjector profile parsing.") {
+  FaultInjector::Profile profile;
+  REQUIRE(FaultInjector::parseProfile("drop=0.5,flip=0.25,dup=0.1,stall=0.2:30,burst=0.3:4", profile));
+  REQUIRE(Approx(0.5f) == profile.dropProbability);
+  REQUIRE(Approx(0.25f) == profile.bitFlipProbability);
+  REQUIRE(Approx(0.1f) == profile.duplicateProbability);
+  REQUIRE(Approx(0.2f) == profile.stallProbability);
+  REQUIRE(30 == profile.stallDuration);
+  REQUIRE(Approx(0.3f) == profile.burstProbability);
+  REQUIRE(4 == profile.burstLength);
+
+  REQUIRE(FaultInjector::parseProfile("usb", profile));
+  REQUIRE("usb" == profile.name);
+  REQUIRE(!FaultInjector::parseProfile("unknown=1", profile));
+  REQUIRE(!FaultInjector::parseProfile("drop", profile));
+}
+
+TEST_CASE("Test FaultInjector faults.") {
+  const std::vector<uint8_t> CHUNK{1, 2, 3, 4};
+  std::vector<uint8_t> received;
+  std::vector<int64_t> timeStamps;
+  auto sink = [&received, &timeStamps](const uint8_t *buffer, size_t size, int64_t timeStamp){
+    received.insert(received.end(), buffer, buffer + size);
+    timeStamps.push_back(timeStamp);
+  };
+
+  {
+    FaultInjector::Profile profile;
+    profile.duplicateProbability = 1.0f;
+    FaultInjector faultInjector(profile);
+    faultInjector.setDelegate(sink);
+    faultInjector.inject(CHUNK.data(), CHUNK.size(), 1);
+    REQUIRE(8 == received.size());
+    REQUIRE(1 == faultInjector.chunksDuplicated());
+  }
+
+  received.clear();
+  timeStamps.clear();
+  {
+    FaultInjector::Profile profile;
+    profile.dropProbability = 1.0f;
+    FaultInjector faultInjector(profile);
+    faultInjector.setDelegate(sink);
+    faultInjector.inject(CHUNK.data(), CHUNK.size(), 1);
+    REQUIRE(received.empty());
+    REQUIRE(4 == faultInjector.bytesDropped());
+    REQUIRE(1 == faultInjector.lastFault());
+  }
+
+  received.clear();
+  timeStamps.clear();
+  {
+    FaultInjector::Profile profile;
+    profile.stallProbability = 1.0f;
+    profile.stallDuration = 10;
+    FaultInjector faultInjector(profile);
+    faultInjector.setDelegate(sink);
+    // Everything within the stall of 10 ms is held back and delivered at its end.
+    faultInjector.inject(CHUNK.data(), CHUNK.size(), 0);
+    faultInjector.inject(CHUNK.data(), CHUNK.size(), 5 * 1000 * 1000);
+    REQUIRE(received.empty());
+    faultInjector.inject(CHUNK.data(), CHUNK.size(), 11 * 1000 * 1000);
+    REQUIRE(8 <= received.size());
+    REQUIRE(10 * 1000 * 1000 == timeStamps.front());
+  }
+
+  received.clear();
+  timeStamps.clear();
+  {
+    FaultInjector::Profile profile;
+    profile.burstProbability = 1.0f;
+    profile.burstLength = 3;
+    FaultInjector faultInjector(profile);
+    faultInjector.setDelegate(sink);
+    faultInjector.inject(CHUNK.data(), CHUNK.size(), 1);
+    faultInjector.inject(CHUNK.data(), CHUNK.size(), 2);
+    REQUIRE(received.empty());
+    faultInjector.inject(CHUNK.data(), CHUNK.size(), 3);
+    REQUIRE(12 == received.size());
+    REQUIRE(1 == timeStamps.size());
+    REQUIRE(1 == faultInjector.bursts());
+  }
+}
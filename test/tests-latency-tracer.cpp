@@ -0,0 +1,78 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "catch.hpp"
+
+#include "latency-tracer.hpp"
+#include "rplidar-decoder.hpp"
+
+#include <vector>
+
+TEST_CASE("Test LatencyTracer percentiles.") {
+  LatencyTracer latencyTracer;
+  for (int64_t i{1}; i <= 1000; i++) {
+    latencyTracer.mark(LatencyTracer::SERIAL_READ, 1000);
+    latencyTracer.mark(LatencyTracer::NODE_DECODE, 1000 + i * 1000);
+    latencyTracer.mark(LatencyTracer::SCAN_COMPLETE, 1000 + i * 1000 + 10);
+    latencyTracer.complete();
+  }
+
+  const LatencyTracer::Statistics decode{latencyTracer.statistics(LatencyTracer::NODE_DECODE)};
+  REQUIRE(1000 == decode.count);
+  REQUIRE(1000 * 1000 == decode.max);
+  // Buckets are at most 12.5% wide.
+  REQUIRE(500 * 1000 <= decode.p50);
+  REQUIRE(500 * 1000 * 1.125 >= decode.p50);
+  REQUIRE(990 * 1000 <= decode.p99);
+  REQUIRE(1000 * 1000 >= decode.p99);
+
+  const LatencyTracer::Statistics complete{latencyTracer.statistics(LatencyTracer::SCAN_COMPLETE)};
+  REQUIRE(10 == complete.p50);
+  REQUIRE(10 == complete.max);
+
+  // Stages without marks are skipped; end to end reaches to the last mark.
+  REQUIRE(0 == latencyTracer.statistics(LatencyTracer::UDP_SEND).count);
+  REQUIRE(1000 * 1000 + 10 == latencyTracer.statistics(LatencyTracer::SERIAL_READ).max);
+
+  latencyTracer.reset();
+  REQUIRE(0 == latencyTracer.statistics(LatencyTracer::NODE_DECODE).count);
+}
+
+TEST_CASE("Test LatencyTracer in RPLidarDecoder.") {
+  std::vector<uint8_t> buffer{RPLidarDecoder::SYNC_BYTE0, RPLidarDecoder::SYNC_BYTE1, 0x5, 0x0, 0x0, 0x40, RPLidarDecoder::GOT_SCAN};
+  for (uint32_t scan{0}; scan < 3; scan++) {
+    for (uint32_t i{0}; i < 360; i++) {
+      RPLidarDecoder::encodeScanNode(buffer, 0 == i, 47, static_cast<uint16_t>(i * 64), 4000);
+    }
+  }
+  RPLidarDecoder::encodeScanNode(buffer, true, 47, 0, 4000);
+
+  LatencyTracer latencyTracer;
+  RPLidarDecoder decoder;
+  decoder.setLatencyTracer(&latencyTracer);
+  decoder.setDelegates(nullptr, nullptr, [&latencyTracer](const opendlv::proxy::PointCloudReading &){
+    latencyTracer.mark(LatencyTracer::SERIALIZATION_START);
+    latencyTracer.mark(LatencyTracer::UDP_SEND);
+  });
+  latencyTracer.mark(LatencyTracer::SERIAL_READ);
+  decoder.decode(buffer.data(), buffer.size());
+
+  for (uint8_t i{0}; i < LatencyTracer::NUMBER_OF_STAGES; i++) {
+    REQUIRE(3 == latencyTracer.statistics(static_cast<LatencyTracer::Stage>(i)).count);
+  }
+  REQUIRE(std::string::npos != latencyTracer.toString().find("over 3 scans"));
+}
@@ -0,0 +1,177 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "catch.hpp"
+
+#include "line-extractor.hpp"
+#include "rplidar-decoder.hpp"
+#include "scan-synthesizer.hpp"
+
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace {
+constexpr const float PI{3.14159265f};
+
+// Scan of a 4 m x 6 m room centred at the origin from (x0, y0) with an
+// opening without return in the front wall from y = 0.5 m to 1.5 m.
+void castRoom(float x0, float y0, bool opening, float sigma, uint32_t samples, std::vector<float> &angles, std::vector<float> &distances) {
+  std::mt19937 generator(1);
+  std::normal_distribution<float> noise(0.0f, sigma);
+  angles.resize(samples);
+  distances.resize(samples);
+  for (uint32_t i{0}; i < samples; i++) {
+    angles[i] = static_cast<float>(i) * 360.0f / static_cast<float>(samples);
+    const float c{std::cos(-angles[i] * PI / 180.0f)};
+    const float s{std::sin(-angles[i] * PI / 180.0f)};
+    float distance{1000.0f};
+    const float candidates[4]{(2.0f - x0) / c, (-2.0f - x0) / c, (3.0f - y0) / s, (-3.0f - y0) / s};
+    for (auto d : candidates) {
+      distance = ( (0.0f < d) && (d < distance) ) ? d : distance;
+    }
+    const float y{y0 + distance * s};
+    const bool throughOpening{opening && (std::fabs(x0 + distance * c - 2.0f) < 1e-3f) && (0.5f < y) && (y < 1.5f)};
+    distances[i] = throughOpening ? 0.0f : distance + ((0.0f < sigma) ? noise(generator) : 0.0f);
+  }
+}
+
+// Segments are in the frame of the device at (0.5 m, -0.3 m).
+bool onWall(const LineExtractor::Segment &s, float margin) {
+  return ( ( (std::fabs(s.x1 - 1.5f) < margin) || (std::fabs(s.x1 + 2.5f) < margin) ) && (std::fabs(s.x2 - s.x1) < margin) ) ||
+         ( ( (std::fabs(s.y1 - 3.3f) < margin) || (std::fabs(s.y1 + 2.7f) < margin) ) && (std::fabs(s.y2 - s.y1) < margin) );
+}
+}
+
+TEST_CASE("Test LineExtractor finds the walls of a room.") {
+  LineExtractor extractor(LineExtractor::Config{}, 1440);
+  std::vector<float> angles;
+  std::vector<float> distances;
+  castRoom(0.5f, -0.3f, false, 0.0f, 1440, angles, distances);
+
+  // The front wall crosses the start of the scan but is one segment.
+  REQUIRE(4 == extractor.extract(angles.data(), distances.data(), 1440));
+  float length{0.0f};
+  for (const auto &s : extractor.segments()) {
+    REQUIRE(onWall(s, 0.01f));
+    REQUIRE(0.001f > s.residual);
+    length += std::sqrt((s.x2 - s.x1) * (s.x2 - s.x1) + (s.y2 - s.y1) * (s.y2 - s.y1));
+  }
+  REQUIRE(20.0f == Approx(length).margin(0.2));
+  REQUIRE(1400 < extractor.samplesFitted());
+  REQUIRE(1440 >= extractor.samplesFitted());
+
+  // Clockwise in scan order; the front wall ends at the right wall.
+  uint32_t front{0};
+  while ( (front < 4) && (1.5f != Approx(extractor.segments()[front].x1).margin(0.01)) ) {
+    front++;
+  }
+  REQUIRE(4 > front);
+  REQUIRE(3.3f == Approx(extractor.segments()[front].y1).margin(0.02));
+  REQUIRE(-2.7f == Approx(extractor.segments()[front].y2).margin(0.02));
+  REQUIRE(-2.7f == Approx(extractor.segments()[(front + 1) % 4].y1).margin(0.02));
+}
+
+TEST_CASE("Test LineExtractor breaks walls at gaps and copes with noise.") {
+  LineExtractor extractor(LineExtractor::Config{}, 1440);
+  std::vector<float> angles;
+  std::vector<float> distances;
+  castRoom(0.5f, -0.3f, true, 0.01f, 1440, angles, distances);
+
+  REQUIRE(5 == extractor.extract(angles.data(), distances.data(), 1440));
+  uint32_t onFrontWall{0};
+  for (const auto &s : extractor.segments()) {
+    REQUIRE(onWall(s, 0.05f));
+    REQUIRE(0.02f > s.residual);
+    onFrontWall += ( (1.5f == Approx(s.x1).margin(0.05)) && (1.5f == Approx(s.x2).margin(0.05)) ) ? 1 : 0;
+  }
+  REQUIRE(2 == onFrontWall);
+  REQUIRE(0.01f == Approx(extractor.residual()).margin(0.003));
+
+  // Nothing to fit.
+  std::vector<float> none(1440, 0.0f);
+  REQUIRE(0 == extractor.extract(angles.data(), none.data(), 1440));
+  REQUIRE(0 == extractor.samplesFitted());
+  REQUIRE(0.0f == Approx(extractor.residual()));
+}
+
+TEST_CASE("Test LineExtractor merges a short piece left by a split into its neighbour.") {
+  // A wall at x = 2 m seen from -45 to 45 degree; its last 4 samples bend
+  // away slightly, so the split leaves a piece of fewer than 6 samples.
+  const uint32_t WALL{91};
+  std::vector<float> angles(WALL);
+  std::vector<float> distances(WALL);
+  for (uint32_t i{0}; i < WALL; i++) {
+    angles[i] = -45.0f + static_cast<float>(i);
+    const float bend{(WALL - 4 < i) ? 0.02f * static_cast<float>(i - (WALL - 4)) : 0.0f};
+    distances[i] = (2.0f + bend) / std::cos(angles[i] * PI / 180.0f);
+  }
+  LineExtractor extractor(LineExtractor::Config{}, 1440);
+  REQUIRE(1 == extractor.extract(angles.data(), distances.data(), WALL));
+  REQUIRE(WALL == extractor.samplesFitted());
+  REQUIRE(-2.0f == Approx(extractor.segments()[0].y2).margin(0.1));
+
+  // A stub of 3 samples turning away sharply fits no neighbour.
+  for (uint32_t i{1}; i <= 3; i++) {
+    angles.push_back(45.0f + static_cast<float>(i));
+    distances.push_back(distances[WALL - 1] + 0.25f * static_cast<float>(i));
+  }
+  REQUIRE(1 == extractor.extract(angles.data(), distances.data(), WALL + 3));
+  REQUIRE(WALL == extractor.samplesFitted());
+}
+
+TEST_CASE("Test RPLidarDecoder sends line segments before every scan.") {
+  ScanSynthesizer synthesizer{ScanSynthesizer::defaultRoom(0, 10.0f)};
+  ScanSynthesizer::NoiseModel noiseModel;
+  noiseModel.sigma = 0.005f;
+  synthesizer.setNoiseModel(noiseModel);
+  std::vector<uint8_t> nodes{RPLidarDecoder::SYNC_BYTE0, RPLidarDecoder::SYNC_BYTE1, 0x5, 0x0, 0x0, 0x40, RPLidarDecoder::GOT_SCAN};
+  for (uint32_t i{0}; i < 4; i++) {
+    synthesizer.synthesize(i, 1440, nodes);
+  }
+  nodes.insert(nodes.end(), nodes.begin() + 7, nodes.begin() + 12);
+
+  RPLidarDecoder decoder;
+  uint32_t messages{0};
+  uint32_t scans{0};
+  float startAzimuth{-1.0f};
+  decoder.setLineSegments(LineExtractor::Config{}, [&messages, &scans, &startAzimuth](const opendlv::device::lidar::rplidar::LineSegments &ls){
+    REQUIRE(messages == scans);
+    REQUIRE(0 < ls.numberOfSegments());
+    REQUIRE(ls.numberOfSegments() * 4 * sizeof(int16_t) == ls.segments().size());
+    REQUIRE(0 < ls.samplesFitted());
+    REQUIRE(0.01f > ls.residual());
+    for (uint32_t i{0}; i < ls.numberOfSegments(); i++) {
+      int16_t millimetres[4];
+      std::memcpy(millimetres, ls.segments().data() + i * sizeof(millimetres), sizeof(millimetres));
+      const float dx{static_cast<float>(millimetres[2] - millimetres[0])};
+      const float dy{static_cast<float>(millimetres[3] - millimetres[1])};
+      REQUIRE(200.0f <= std::sqrt(dx * dx + dy * dy) + 1.0f);
+    }
+    startAzimuth = ls.startAzimuth();
+    messages++;
+  });
+  decoder.setDelegates(nullptr, nullptr, [&scans, &startAzimuth](const opendlv::proxy::PointCloudReading &pc){
+    REQUIRE(pc.startAzimuth() == Approx(startAzimuth));
+    scans++;
+  });
+  decoder.decode(nodes.data(), nodes.size());
+  REQUIRE(4 == scans);
+  REQUIRE(4 == messages);
+  REQUIRE(std::string::npos != decoder.getPipelineStatistics().find("lines"));
+}
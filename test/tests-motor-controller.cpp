@@ -0,0 +1,112 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "catch.hpp"
+
+#include "motor-controller.hpp"
+#include "rplidar-emulator.hpp"
+#include "scan-frequency-estimator.hpp"
+
+#include <cstdint>
+
+TEST_CASE("Test ScanFrequencyEstimator.") {
+  ScanFrequencyEstimator estimator;
+  REQUIRE(0.0f == Approx(estimator.frequency()));
+
+  // 8 Hz with up to 2 ms of jitter from reading chunks.
+  int64_t t{1000 * 1000 * 1000};
+  for (int64_t i{0}; i < 30; i++) {
+    const int64_t jitter{((i * 7) % 3) * 1000 * 1000};
+    REQUIRE(estimator.addStartFlag(t + i * 125 * 1000 * 1000 + jitter));
+  }
+  REQUIRE(Approx(8.0f).epsilon(0.005) == estimator.frequency());
+
+  // Start flags from corrupted nodes are ignored.
+  REQUIRE(!estimator.addStartFlag(t + 29ll * 125 * 1000 * 1000 + 5 * 1000 * 1000));
+  REQUIRE(Approx(8.0f).epsilon(0.005) == estimator.frequency());
+
+  // The estimation starts over after a stopped motor.
+  t += 60ll * 1000 * 1000 * 1000;
+  REQUIRE(estimator.addStartFlag(t));
+  REQUIRE(0.0f == Approx(estimator.frequency()));
+  REQUIRE(estimator.addStartFlag(t + 100 * 1000 * 1000));
+  REQUIRE(Approx(10.0f) == estimator.frequency());
+}
+
+TEST_CASE("Test MotorController holds the target frequency.") {
+  // Motor reaching 0.9 * 10 Hz * pwm / 660 with a first order lag.
+  const float GAIN{0.9f};
+  MotorController controller(8.0f);
+  REQUIRE(528 == controller.pwm());
+
+  float frequency{0.0f};
+  const float DT{0.5f};
+  for (uint32_t i{0}; i < 60; i++) {
+    const float target{GAIN * 10.0f * static_cast<float>(controller.pwm()) / 660.0f};
+    frequency += (target - frequency) * 0.7f;
+    controller.update(frequency, DT);
+  }
+  REQUIRE(Approx(8.0f).epsilon(0.01) == frequency);
+  REQUIRE(controller.pwm() > 528);
+
+  controller.setTargetFrequency(100.0f);
+  for (uint32_t i{0}; i < 10; i++) {
+    controller.update(frequency, DT);
+  }
+  REQUIRE(MotorController::MAX_PWM == controller.pwm());
+
+  controller.setTargetFrequency(0.0f);
+  REQUIRE(0 == controller.update(frequency, DT));
+}
+
+TEST_CASE("Test MotorController on start flags of the emulated motor.") {
+  // The motor of RPLidarEmulator at 10 Hz nominal: each rotation closes 30%
+  // of the gap to MOTOR_GAIN * 10 Hz * pwm / 660. Start flags are fed with
+  // synthetic time stamps and the controller runs every 500 ms like RPLidar.
+  const int64_t CONTROL_PERIOD{500 * 1000 * 1000};
+  ScanFrequencyEstimator estimator;
+  MotorController controller(6.0f);
+  uint16_t pwm{controller.pwm()};
+
+  float frequency{10.0f};
+  int64_t t{1000 * 1000 * 1000};
+  int64_t lastControl{t};
+  for (uint32_t rotation{0}; rotation < 400; rotation++) {
+    const float target{RPLidarEmulator::MOTOR_GAIN * 10.0f * static_cast<float>(pwm) / 660.0f};
+    frequency += (target - frequency) * 0.3f;
+    t += static_cast<int64_t>(1e9f / frequency);
+    estimator.addStartFlag(t);
+    if (CONTROL_PERIOD <= (t - lastControl)) {
+      pwm = controller.update(estimator.frequency(), static_cast<float>(t - lastControl) / 1e9f);
+      lastControl = t;
+    }
+  }
+  REQUIRE(Approx(6.0f).epsilon(0.01) == frequency);
+  REQUIRE(Approx(6.0f).epsilon(0.01) == estimator.frequency());
+  // The feed forward alone would be short by the motor gain.
+  REQUIRE(396 < pwm);
+
+  // Open loop, PWM 330 settles at half the nominal speed times the gain.
+  pwm = 330;
+  for (uint32_t rotation{0}; rotation < 50; rotation++) {
+    const float target{RPLidarEmulator::MOTOR_GAIN * 10.0f * static_cast<float>(pwm) / 660.0f};
+    frequency += (target - frequency) * 0.3f;
+    t += static_cast<int64_t>(1e9f / frequency);
+    estimator.addStartFlag(t);
+  }
+  REQUIRE(Approx(RPLidarEmulator::MOTOR_GAIN * 5.0f).epsilon(0.005) == estimator.frequency());
+}
@@ -0,0 +1,160 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "catch.hpp"
+
+#include "occupancy-grid.hpp"
+#include "rplidar-decoder.hpp"
+#include "scan-synthesizer.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <vector>
+
+namespace {
+constexpr const float PI{3.14159265f};
+
+// Noise-free scan of the default room from the given position.
+void castScan(float x, float y, uint32_t samples, std::vector<float> &angles, std::vector<float> &distances) {
+  ScanSynthesizer synthesizer{ScanSynthesizer::defaultRoom()};
+  synthesizer.setSensorPose(x, y, 0.0f);
+  angles.resize(samples);
+  distances.resize(samples);
+  for (uint32_t i{0}; i < samples; i++) {
+    angles[i] = static_cast<float>(i) * 360.0f / static_cast<float>(samples);
+    distances[i] = synthesizer.castRay(-angles[i] * PI / 180.0f, 0.0f);
+  }
+}
+
+int8_t wallAt(const OccupancyGrid &grid, float x, float y) {
+  // The cell boundary may be hit on either side.
+  return std::max(grid.at(x - 0.025f, y), grid.at(x + 0.025f, y));
+}
+}
+
+TEST_CASE("Test OccupancyGrid marks free space and walls.") {
+  std::vector<float> angles;
+  std::vector<float> distances;
+  castScan(0.0f, 0.0f, 1440, angles, distances);
+
+  OccupancyGrid::Config config;
+  OccupancyGrid grid(config);
+  REQUIRE(256 == grid.size());
+  REQUIRE(0 < grid.integrate(angles.data(), distances.data(), 1440, 0.0f, 0.0f, 0.0f));
+  REQUIRE(config.hit == wallAt(grid, 5.0f, 0.0f));
+  REQUIRE(config.miss == grid.at(2.5f, 0.1f));
+  REQUIRE(0 == grid.at(5.5f, 0.0f));
+  REQUIRE(-6.4f == Approx(grid.originX()));
+
+  // Saturates; a cell is updated once per scan however many rays pass it.
+  for (uint32_t i{0}; i < 20; i++) {
+    grid.integrate(angles.data(), distances.data(), 1440, 0.0f, 0.0f, 0.0f);
+  }
+  REQUIRE(config.maximum == wallAt(grid, 5.0f, 0.0f));
+  REQUIRE(config.minimum == grid.at(0.0f, 0.0f));
+}
+
+TEST_CASE("Test OccupancyGrid bounds its size.") {
+  OccupancyGrid::Config config;
+  config.size = 5;
+  REQUIRE(8 == OccupancyGrid(config).size());
+  config.size = UINT32_MAX;
+  REQUIRE(OccupancyGrid::MAX_SIZE == OccupancyGrid(config).size());
+}
+
+TEST_CASE("Test OccupancyGrid is independent of the number of threads.") {
+  std::vector<float> angles;
+  std::vector<float> distances;
+  OccupancyGrid::Config config;
+  OccupancyGrid single(config);
+  config.threads = 4;
+  OccupancyGrid parallel(config);
+  for (uint32_t i{0}; i < 5; i++) {
+    const float x{0.2f * static_cast<float>(i)};
+    castScan(x, 0.1f, 1600, angles, distances);
+    single.integrate(angles.data(), distances.data(), 1600, x, 0.1f, 0.0f);
+    parallel.integrate(angles.data(), distances.data(), 1600, x, 0.1f, 0.0f);
+  }
+  std::string a;
+  std::string b;
+  single.compress(a);
+  parallel.compress(b);
+  REQUIRE(!a.empty());
+  REQUIRE(a == b);
+  REQUIRE(single.cellsUpdated() == parallel.cellsUpdated());
+
+  std::vector<int8_t> cells;
+  REQUIRE(OccupancyGrid::decompress(a, 256 * 256, cells));
+  // Row and column of the point (2.5, 0.1) from the lower-left corner.
+  const uint32_t column{static_cast<uint32_t>((2.5f - single.originX()) / single.resolution())};
+  const uint32_t row{static_cast<uint32_t>((0.1f - single.originY()) / single.resolution())};
+  REQUIRE(single.at(2.5f, 0.1f) == cells[row * 256 + column]);
+  REQUIRE(0 > cells[row * 256 + column]);
+  REQUIRE(!OccupancyGrid::decompress(a.substr(0, a.size() - 1), 256 * 256, cells));
+  REQUIRE(!OccupancyGrid::decompress(a, 256 * 256 + 1, cells));
+}
+
+TEST_CASE("Test OccupancyGrid rolls with the device.") {
+  std::vector<float> angles;
+  std::vector<float> distances;
+  castScan(0.0f, 0.0f, 1440, angles, distances);
+  OccupancyGrid grid(OccupancyGrid::Config{});
+  grid.integrate(angles.data(), distances.data(), 1440, 0.0f, 0.0f, 0.0f);
+  REQUIRE(0 < wallAt(grid, -5.0f, 0.0f));
+
+  // Moving 4 m forward without any return keeps what is still in the window.
+  const std::vector<float> none(1440, 0.0f);
+  grid.integrate(angles.data(), none.data(), 1440, 4.0f, 0.0f, 0.0f);
+  REQUIRE(-2.4f == Approx(grid.originX()));
+  REQUIRE(0 == wallAt(grid, -5.0f, 0.0f));
+  REQUIRE(0 < wallAt(grid, 5.0f, 0.0f));
+  REQUIRE(0 > grid.at(0.0f, 0.1f));
+
+  // Coming back does not bring back cells that were forgotten.
+  grid.integrate(angles.data(), none.data(), 1440, 0.0f, 0.0f, 0.0f);
+  REQUIRE(0 == wallAt(grid, -5.0f, 0.0f));
+  REQUIRE(0 < wallAt(grid, 5.0f, 0.0f));
+}
+
+TEST_CASE("Test RPLidarDecoder sends occupancy grid snapshots.") {
+  ScanSynthesizer synthesizer{ScanSynthesizer::defaultRoom(0, 10.0f)};
+  std::vector<uint8_t> nodes{RPLidarDecoder::SYNC_BYTE0, RPLidarDecoder::SYNC_BYTE1, 0x5, 0x0, 0x0, 0x40, RPLidarDecoder::GOT_SCAN};
+  for (uint32_t i{0}; i < 3; i++) {
+    synthesizer.synthesize(i, 720, nodes);
+  }
+  RPLidarDecoder::encodeScanNode(nodes, true, 15, 0, 4000);
+
+  RPLidarDecoder decoder;
+  std::vector<opendlv::device::lidar::rplidar::OccupancyGridSnapshot> snapshots;
+  OccupancyGrid::Config config;
+  config.size = 100;
+  config.resolution = 0.1f;
+  decoder.setOccupancyGrid(config, std::chrono::milliseconds(0), [&snapshots](const opendlv::device::lidar::rplidar::OccupancyGridSnapshot &ogs){
+    snapshots.push_back(ogs);
+  });
+  decoder.decode(nodes.data(), nodes.size());
+
+  REQUIRE(3 == snapshots.size());
+  REQUIRE(128 == snapshots.back().width());
+  REQUIRE(-6.4f == Approx(snapshots.back().originX()));
+  REQUIRE(0 < snapshots.back().cellsUpdated());
+  std::vector<int8_t> cells;
+  REQUIRE(OccupancyGrid::decompress(snapshots.back().cells(), 128 * 128, cells));
+  // The device itself is in free space.
+  REQUIRE(0 > cells[64 * 128 + 64]);
+}
@@ -20,6 +20,11 @@
 
 #include "rplidar-decoder.hpp"
 
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <utility>
 #include <vector>
 
 const std::vector<uint8_t> RCV_INFO_BYTES {
@@ -41,3 +46,276 @@ TEST_CASE("Test DeviceInfo.") {
   }
 }
 
+
+// Encodes one measurement node as sent by the RPLidar in scanning mode.
+static void appendScanNode(std::vector<uint8_t> &bytes, bool startFlag, uint16_t angleQ6, uint16_t distanceQ2) {
+  bytes.push_back(static_cast<uint8_t>((startFlag ? 0x1 : 0x2) | (15 << 2)));
+  bytes.push_back(static_cast<uint8_t>(((angleQ6 << 1) & 0xFF) | 0x1));
+  bytes.push_back(static_cast<uint8_t>((angleQ6 >> 7) & 0xFF));
+  bytes.push_back(static_cast<uint8_t>(distanceQ2 & 0xFF));
+  bytes.push_back(static_cast<uint8_t>((distanceQ2 >> 8) & 0xFF));
+}
+
+// Response descriptor for SCAN followed by numberOfScans full rotations with
+// one sample per degree and the start of the next rotation.
+static std::vector<uint8_t> createScans(uint32_t numberOfScans, std::function<uint16_t(uint16_t)> distanceQ2ForDegree) {
+  std::vector<uint8_t> bytes{0xa5, 0x5a, 0x5, 0x0, 0x0, 0x40, 0x81};
+  for (uint32_t scan{0}; scan < numberOfScans; scan++) {
+    for (uint16_t degree{0}; degree < 360; degree++) {
+      appendScanNode(bytes, 0 == degree, static_cast<uint16_t>(degree * 64), distanceQ2ForDegree(degree));
+    }
+  }
+  appendScanNode(bytes, true, 0, distanceQ2ForDegree(0));
+  return bytes;
+}
+
+TEST_CASE("Test SectorMinDistance.") {
+  // 1 m everywhere except for 0.5 m at 100 degree and no return at 300-359 degree.
+  const std::vector<uint8_t> bytes = createScans(2, [](uint16_t degree){
+    return static_cast<uint16_t>((100 == degree) ? 2000 : ((300 <= degree) ? 0 : 4000));
+  });
+
+  uint32_t cloudsReceived{0};
+  std::vector<opendlv::device::lidar::rplidar::SectorMinDistance> sectors;
+  RPLidarDecoder decoder;
+  decoder.setDelegates(nullptr, nullptr, [&cloudsReceived](const opendlv::proxy::PointCloudReading &){ cloudsReceived++; });
+  decoder.setSectorDelegate(8, [&sectors](const opendlv::device::lidar::rplidar::SectorMinDistance &smd){ sectors.push_back(smd); });
+  decoder.decode(bytes.data(), bytes.size());
+
+  REQUIRE(2 == cloudsReceived);
+  REQUIRE(2 == sectors.size());
+  for (auto &smd : sectors) {
+    REQUIRE(8 == smd.numberOfSectors());
+    REQUIRE(8 * sizeof(float) == smd.distances().size());
+    std::vector<float> distances(8);
+    std::memcpy(distances.data(), smd.distances().data(), smd.distances().size());
+    REQUIRE(Approx(1.0f) == distances[0]);
+    REQUIRE(Approx(0.5f) == distances[2]);
+    REQUIRE(Approx(1.0f) == distances[6]);
+    REQUIRE(0.0f == Approx(distances[7]));
+  }
+}
+
+TEST_CASE("Test SectorMinDistance ignores a discarded partial scan.") {
+  std::vector<uint8_t> bytes = createScans(1, [](uint16_t){ return static_cast<uint16_t>(4000); });
+  // A partial rotation of 100 samples at 0.25 m in front of the first full one.
+  std::vector<uint8_t> partial;
+  for (uint16_t degree{0}; degree < 100; degree++) {
+    appendScanNode(partial, 0 == degree, static_cast<uint16_t>(degree * 64), 1000);
+  }
+  bytes.insert(bytes.begin() + 7, partial.begin(), partial.end());
+
+  std::vector<opendlv::device::lidar::rplidar::SectorMinDistance> sectors;
+  std::vector<opendlv::proxy::PointCloudReading> clouds;
+  RPLidarDecoder decoder;
+  decoder.setDelegates(nullptr, nullptr, [&clouds](const opendlv::proxy::PointCloudReading &pc){ clouds.push_back(pc); });
+  decoder.setSectorDelegate(8, [&sectors](const opendlv::device::lidar::rplidar::SectorMinDistance &smd){ sectors.push_back(smd); });
+  decoder.decode(bytes.data(), bytes.size());
+
+  REQUIRE(1 == sectors.size());
+  std::vector<float> distances(8);
+  std::memcpy(distances.data(), sectors[0].distances().data(), sectors[0].distances().size());
+  for (auto d : distances) {
+    REQUIRE(Approx(1.0f) == d);
+  }
+
+  // The cloud sent with the sectors does not contain the partial scan either.
+  REQUIRE(1 == clouds.size());
+  const std::string cloudDistances{clouds[0].distances()};
+  REQUIRE(360 * sizeof(float) == cloudDistances.size());
+  std::vector<float> samples(cloudDistances.size() / sizeof(float));
+  std::memcpy(samples.data(), cloudDistances.data(), cloudDistances.size());
+  for (auto d : samples) {
+    REQUIRE(Approx(1.0f) == d);
+  }
+}
+
+TEST_CASE("Test SectorMinDistance changes only after leaving scanning mode.") {
+  const std::vector<uint8_t> bytes = createScans(2, [](uint16_t){ return static_cast<uint16_t>(4000); });
+  const size_t HALF{7 + 5 * 540};
+
+  std::vector<opendlv::device::lidar::rplidar::SectorMinDistance> sectors;
+  auto delegate = [&sectors](const opendlv::device::lidar::rplidar::SectorMinDistance &smd){ sectors.push_back(smd); };
+  RPLidarDecoder decoder;
+  decoder.setSectorDelegate(8, delegate);
+  REQUIRE(HALF == decoder.decode(bytes.data(), HALF));
+  REQUIRE(1 == sectors.size());
+
+  // Requested while scanning, e.g., by a ScanRequest.
+  decoder.setSectorDelegate(4, delegate);
+  REQUIRE(bytes.size() - HALF == decoder.decode(bytes.data() + HALF, bytes.size() - HALF));
+  REQUIRE(2 == sectors.size());
+  REQUIRE(8 == sectors[1].numberOfSectors());
+
+  decoder.leaveScanningMode();
+  decoder.decode(bytes.data(), bytes.size());
+  REQUIRE(4 == sectors.size());
+  REQUIRE(4 == sectors[2].numberOfSectors());
+  REQUIRE(4 * sizeof(float) == sectors[3].distances().size());
+}
+
+TEST_CASE("Test DriverStatistics.") {
+  std::vector<uint8_t> bytes = createScans(3, [](uint16_t){ return static_cast<uint16_t>(4000); });
+  // Three bytes of garbage within the second rotation.
+  const std::vector<uint8_t> GARBAGE{0x0, 0x0, 0x0};
+  bytes.insert(bytes.begin() + 7 + 5 * 400, GARBAGE.begin(), GARBAGE.end());
+
+  RPLidarDecoder decoder;
+  uint32_t cloudsReceived{0};
+  decoder.setDelegates(nullptr, nullptr, [&cloudsReceived](const opendlv::proxy::PointCloudReading &){ cloudsReceived++; });
+  REQUIRE(bytes.size() == decoder.decode(bytes.data(), bytes.size()));
+  REQUIRE(3 == cloudsReceived);
+
+  const opendlv::device::lidar::rplidar::DriverStatistics statistics{decoder.getStatistics()};
+  REQUIRE(3 == statistics.bytesDiscarded());
+  REQUIRE(3 == statistics.invalidNodes());
+  REQUIRE(1 == statistics.resyncs());
+  REQUIRE(3 == statistics.scansEmitted());
+  REQUIRE(360 == statistics.samplesPerScan());
+  REQUIRE(0 == statistics.publishesDropped());
+
+  // Without delegate, complete scans cannot be published.
+  RPLidarDecoder decoderWithoutDelegate;
+  decoderWithoutDelegate.decode(bytes.data(), bytes.size());
+  REQUIRE(3 == decoderWithoutDelegate.getStatistics().publishesDropped());
+}
+
+TEST_CASE("Test leaving scanning mode.") {
+  RPLidarDecoder decoder;
+  std::vector<uint32_t> samples;
+  decoder.setDelegates(nullptr, nullptr, [&samples](const opendlv::proxy::PointCloudReading &pc){ samples.push_back(static_cast<uint32_t>(pc.distances().size() / 4)); });
+
+  // Stop in the middle of the second rotation and within a node.
+  std::vector<uint8_t> bytes = createScans(2, [](uint16_t){ return static_cast<uint16_t>(4000); });
+  const size_t STOPPED{7 + 5 * 540 + 2};
+  REQUIRE(STOPPED - 2 == decoder.decode(bytes.data(), STOPPED));
+  REQUIRE(1 == samples.size());
+  REQUIRE(RPLidarDecoder::GOT_SCAN == decoder.getLastRPLidarMessage());
+
+  decoder.leaveScanningMode();
+  REQUIRE(RPLidarDecoder::UNKNOWN == decoder.getLastRPLidarMessage());
+  REQUIRE(!decoder.waitForMessage(RPLidarDecoder::GOT_SCAN, std::chrono::milliseconds(10)));
+
+  // The remainder of the node is skipped and the partial rotation is not sent.
+  std::vector<uint8_t> resumed{bytes.begin() + STOPPED - 2, bytes.begin() + STOPPED};
+  resumed.insert(resumed.end(), bytes.begin(), bytes.end());
+  REQUIRE(resumed.size() == decoder.decode(resumed.data(), resumed.size()));
+  REQUIRE(decoder.waitForMessage(RPLidarDecoder::GOT_SCAN, std::chrono::milliseconds(0)));
+  REQUIRE(3 == samples.size());
+  REQUIRE(360 == samples[1]);
+  REQUIRE(360 == samples[2]);
+  REQUIRE(2 == decoder.getStatistics().bytesDiscarded());
+}
+
+TEST_CASE("Test mounting transform.") {
+  // 1 m everywhere except for 0.5 m at 10 degree.
+  const std::vector<uint8_t> bytes = createScans(1, [](uint16_t degree){ return static_cast<uint16_t>((10 == degree) ? 2000 : 4000); });
+  auto decode = [&bytes](float x, float y, float yaw, bool flip, std::vector<float> &angles, std::vector<float> &distances){
+    RPLidarDecoder decoder;
+    decoder.setMount(x, y, yaw, flip);
+    decoder.setDelegates(nullptr, nullptr, [&angles, &distances](const opendlv::proxy::PointCloudReading &pc){
+      angles.resize(pc.azimuthAngles().size() / sizeof(float));
+      distances.resize(pc.distances().size() / sizeof(float));
+      std::memcpy(angles.data(), pc.azimuthAngles().data(), angles.size() * sizeof(float));
+      std::memcpy(distances.data(), pc.distances().data(), distances.size() * sizeof(float));
+    });
+    decoder.decode(bytes.data(), bytes.size());
+    REQUIRE(360 == angles.size());
+    REQUIRE(360 == distances.size());
+  };
+
+  std::vector<float> angles;
+  std::vector<float> distances;
+  // Turned to the left, i.e., the closest return is on the right side.
+  decode(0.0f, 0.0f, 90.0f, false, angles, distances);
+  REQUIRE(0.5f == Approx(distances[10]));
+  REQUIRE(280.0f == Approx(angles[10]));
+  REQUIRE(270.0f == Approx(angles[0]));
+
+  decode(0.0f, 0.0f, 0.0f, true, angles, distances);
+  REQUIRE(350.0f == Approx(angles[10]));
+  REQUIRE(0.0f == Approx(angles[0]));
+
+  decode(0.0f, 0.0f, 90.0f, true, angles, distances);
+  REQUIRE(260.0f == Approx(angles[10]));
+
+  // 1 m in front of the vehicle; the sample at 90 degree is on the right.
+  decode(1.0f, 0.0f, 0.0f, false, angles, distances);
+  REQUIRE(2.0f == Approx(distances[0]));
+  REQUIRE(0.0f == Approx(angles[0]));
+  REQUIRE(std::sqrt(2.0f) == Approx(distances[90]));
+  REQUIRE(45.0f == Approx(angles[90]));
+}
+
+TEST_CASE("Test angular masks and range gates.") {
+  // 1 m everywhere except for 0.5 m at 100 degree and 5 m at 200 degree.
+  const std::vector<uint8_t> bytes = createScans(2, [](uint16_t degree){
+    return static_cast<uint16_t>((100 == degree) ? 2000 : ((200 == degree) ? 20000 : 4000));
+  });
+
+  std::vector<float> angles;
+  std::vector<float> distances;
+  RPLidarDecoder decoder;
+  decoder.setDelegates(nullptr, nullptr, [&angles, &distances](const opendlv::proxy::PointCloudReading &pc){
+    angles.resize(pc.azimuthAngles().size() / sizeof(float));
+    distances.resize(pc.distances().size() / sizeof(float));
+    std::memcpy(angles.data(), pc.azimuthAngles().data(), angles.size() * sizeof(float));
+    std::memcpy(distances.data(), pc.distances().data(), distances.size() * sizeof(float));
+  });
+
+  std::vector<std::pair<float, float>> masks;
+  REQUIRE(!RPLidarDecoder::parseAngularMasks("10", masks));
+  REQUIRE(RPLidarDecoder::parseAngularMasks("350:10,40:50", masks));
+  REQUIRE(2 == masks.size());
+  decoder.setAngularMasks(masks);
+  decoder.setRangeGate(0.75f, 4.0f);
+  decoder.decode(bytes.data(), bytes.size());
+
+  // 30 degree masked including the start node, 100 and 200 degree gated.
+  REQUIRE(328 == angles.size());
+  for (size_t i{0}; i < angles.size(); i++) {
+    REQUIRE(1.0f == Approx(distances[i]));
+    REQUIRE( ((10.0f <= angles[i]) && (350.0f > angles[i])) );
+    REQUIRE( ((40.0f > angles[i]) || (50.0f <= angles[i])) );
+  }
+  REQUIRE(2 * 32 == decoder.getStatistics().samplesFiltered());
+}
+
+TEST_CASE("Test samples without return.") {
+  // 1 m everywhere except for no return at 300-359 degree.
+  const std::vector<uint8_t> bytes = createScans(2, [](uint16_t degree){ return static_cast<uint16_t>((300 <= degree) ? 0 : 4000); });
+
+  auto decode = [&bytes](RPLidarDecoder::InvalidSamples invalidSamples, std::vector<uint32_t> &samples, std::vector<opendlv::device::lidar::rplidar::ScanValidity> &validities){
+    RPLidarDecoder decoder;
+    decoder.setDelegates(nullptr, nullptr, [&samples](const opendlv::proxy::PointCloudReading &pc){ samples.push_back(static_cast<uint32_t>(pc.distances().size() / 4)); });
+    decoder.setInvalidSamples(invalidSamples, [&validities](const opendlv::device::lidar::rplidar::ScanValidity &sv){ validities.push_back(sv); });
+    decoder.decode(bytes.data(), bytes.size());
+    const opendlv::device::lidar::rplidar::DriverStatistics statistics{decoder.getStatistics()};
+    REQUIRE(2 * 60 == statistics.samplesInvalid());
+    REQUIRE(60.0f / 360.0f == Approx(statistics.invalidRatio()));
+  };
+
+  std::vector<uint32_t> samples;
+  std::vector<opendlv::device::lidar::rplidar::ScanValidity> validities;
+  decode(RPLidarDecoder::KEEP_INVALID, samples, validities);
+  REQUIRE(std::vector<uint32_t>{360, 360} == samples);
+  REQUIRE(validities.empty());
+
+  samples.clear();
+  decode(RPLidarDecoder::DROP_INVALID, samples, validities);
+  REQUIRE(std::vector<uint32_t>{300, 300} == samples);
+  REQUIRE(validities.empty());
+
+  samples.clear();
+  decode(RPLidarDecoder::MARK_INVALID, samples, validities);
+  REQUIRE(std::vector<uint32_t>{360, 360} == samples);
+  REQUIRE(2 == validities.size());
+  const std::string validity{validities[0].validity()};
+  REQUIRE(360 == validities[0].numberOfSamples());
+  REQUIRE(45 == validity.size());
+  REQUIRE(60.0f / 360.0f == Approx(validities[0].invalidRatio()));
+  for (uint32_t i{0}; i < 360; i++) {
+    const bool valid{0 != ((static_cast<uint8_t>(validity[i / 8]) >> (i % 8)) & 0x1)};
+    REQUIRE((300 > i) == valid);
+  }
+}
@@ -0,0 +1,263 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "catch.hpp"
+
+#include "rplidar-decoder.hpp"
+#include "rplidar-emulator.hpp"
+#include "rplidar.hpp"
+
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <thread>
+#include <vector>
+
+// Sends a command to the emulator and decodes everything that arrives within the given time.
+static void exchange(int fd, RPLidarDecoder &decoder, uint8_t command, std::chrono::milliseconds duration) {
+  const uint8_t request[]{RPLidarDecoder::SYNC_BYTE0, command};
+  REQUIRE(sizeof(request) == ::write(fd, request, sizeof(request)));
+
+  std::vector<uint8_t> data;
+  const auto end{std::chrono::steady_clock::now() + duration};
+  while (std::chrono::steady_clock::now() < end) {
+    struct pollfd fds{fd, POLLIN, 0};
+    if (0 < ::poll(&fds, 1, 10)) {
+      uint8_t buffer[1024];
+      const ssize_t bytesRead = ::read(fd, buffer, sizeof(buffer));
+      if (0 < bytesRead) {
+        data.insert(data.end(), buffer, buffer + bytesRead);
+        const size_t consumed = decoder.decode(data.data(), data.size());
+        data.erase(data.begin(), data.begin() + static_cast<std::ptrdiff_t>(consumed));
+      }
+    }
+  }
+}
+
+// Polls the condition until it holds or the timeout passed; for state
+// changed by the emulator thread without depending on how fast it runs.
+static bool waitFor(std::function<bool()> condition, std::chrono::milliseconds timeout) {
+  const auto end{std::chrono::steady_clock::now() + timeout};
+  while (!condition() && (std::chrono::steady_clock::now() < end)) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  return condition();
+}
+
+TEST_CASE("Test RPLidarEmulator protocol.") {
+  RPLidarEmulator emulator(20.0f, 360);
+  REQUIRE(emulator.isOpen());
+
+  const int fd = ::open(emulator.getDeviceName().c_str(), O_RDWR | O_NOCTTY);
+  REQUIRE(-1 != fd);
+
+  uint32_t scans{0};
+  RPLidarDecoder decoder;
+  decoder.setDelegates(nullptr, nullptr, [&scans](const opendlv::proxy::PointCloudReading &pc){
+    REQUIRE(360 * 4 == pc.distances().size());
+    scans++;
+  });
+
+  exchange(fd, decoder, RPLidarDecoder::GET_INFO, std::chrono::milliseconds(50));
+  REQUIRE(RPLidarDecoder::GOT_INFO == decoder.getLastRPLidarMessage());
+  REQUIRE(0x18 == decoder.getDeviceInfo().model());
+
+  exchange(fd, decoder, RPLidarDecoder::GET_HEALTH, std::chrono::milliseconds(50));
+  REQUIRE(RPLidarDecoder::GOT_HEALTH == decoder.getLastRPLidarMessage());
+  REQUIRE(0 == decoder.getDeviceHealth().status());
+
+  exchange(fd, decoder, RPLidarDecoder::SCAN, std::chrono::milliseconds(300));
+  REQUIRE(emulator.isScanning());
+  REQUIRE(3 <= scans);
+
+  exchange(fd, decoder, RPLidarDecoder::STOP, std::chrono::milliseconds(20));
+  REQUIRE(!emulator.isScanning());
+  ::close(fd);
+}
+
+TEST_CASE("Test RPLidarEmulator SET_MOTOR_PWM.") {
+  RPLidarEmulator emulator(10.0f, 360);
+  REQUIRE(emulator.isOpen());
+  const int fd = ::open(emulator.getDeviceName().c_str(), O_RDWR | O_NOCTTY);
+  REQUIRE(-1 != fd);
+
+  // PWM 330 with checksum; ignored by an A1, which answers GET_INFO in
+  // order after it.
+  const uint8_t request[]{RPLidarDecoder::SYNC_BYTE0, RPLidarDecoder::SET_MOTOR_PWM, 0x2, 0x4A, 0x1, 0x1C};
+  REQUIRE(sizeof(request) == ::write(fd, request, sizeof(request)));
+  RPLidarDecoder decoder;
+  exchange(fd, decoder, RPLidarDecoder::GET_INFO, std::chrono::milliseconds(50));
+  REQUIRE(waitFor([&decoder](){ return RPLidarDecoder::GOT_INFO == decoder.getLastRPLidarMessage(); }, std::chrono::milliseconds(2000)));
+  REQUIRE(0 == emulator.motorPwm());
+
+  emulator.setModel(RPLidarEmulator::MODEL_A2);
+  REQUIRE(sizeof(request) == ::write(fd, request, sizeof(request)));
+  REQUIRE(waitFor([&emulator](){ return 330 == emulator.motorPwm(); }, std::chrono::milliseconds(2000)));
+
+  // A corrupted checksum is rejected; the valid request after it is taken.
+  const uint8_t corrupted[]{RPLidarDecoder::SYNC_BYTE0, RPLidarDecoder::SET_MOTOR_PWM, 0x2, 0x94, 0x2, 0x0};
+  REQUIRE(sizeof(corrupted) == ::write(fd, corrupted, sizeof(corrupted)));
+  const uint8_t faster[]{RPLidarDecoder::SYNC_BYTE0, RPLidarDecoder::SET_MOTOR_PWM, 0x2, 0x94, 0x2, 0xC1};
+  REQUIRE(sizeof(faster) == ::write(fd, faster, sizeof(faster)));
+  REQUIRE(waitFor([&emulator](){ return 330 != emulator.motorPwm(); }, std::chrono::milliseconds(2000)));
+  REQUIRE(660 == emulator.motorPwm());
+  ::close(fd);
+}
+
+TEST_CASE("Test RPLidar stops and resumes scanning.") {
+  RPLidarEmulator emulator(20.0f, 360);
+  REQUIRE(emulator.isOpen());
+  std::atomic<uint32_t> scans{0};
+  std::atomic<uint32_t> incompleteScans{0};
+  {
+    RPLidar rplidar(emulator.getDeviceName());
+    REQUIRE(rplidar.isOpen());
+    // Called from the thread reading bytes; hence, only count.
+    rplidar.startScanning(nullptr, nullptr, [&scans, &incompleteScans](const opendlv::proxy::PointCloudReading &pc){
+      if (360 * 4 != pc.distances().size()) {
+        incompleteScans++;
+      }
+      scans++;
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    REQUIRE(emulator.isScanning());
+    REQUIRE(2 <= scans);
+
+    rplidar.stopScanning();
+    REQUIRE(!emulator.isScanning());
+    const uint32_t scansBefore{scans};
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    REQUIRE(scansBefore == scans);
+
+    const auto start{std::chrono::steady_clock::now()};
+    REQUIRE(rplidar.resumeScanning());
+    REQUIRE(std::chrono::steady_clock::now() - start < std::chrono::milliseconds(50));
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    REQUIRE(scansBefore + 2 <= scans);
+    REQUIRE(0 == rplidar.getStatistics().invalidNodes());
+  }
+  REQUIRE(0 == incompleteScans);
+}
+
+TEST_CASE("Test RPLidar health checks and recovery.") {
+  RPLidarEmulator emulator(20.0f, 360);
+  REQUIRE(emulator.isOpen());
+  std::atomic<uint32_t> scans{0};
+  RPLidar rplidar(emulator.getDeviceName());
+  REQUIRE(rplidar.isOpen());
+  rplidar.startScanning(nullptr, nullptr, [&scans](const opendlv::proxy::PointCloudReading &){ scans++; });
+  std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+  REQUIRE(RPLidarEmulator::HEALTH_GOOD == rplidar.checkHealth());
+  REQUIRE(1 == rplidar.getStatistics().healthChecks());
+  REQUIRE(0 == rplidar.getStatistics().deviceResets());
+  REQUIRE(50 * 1000 > rplidar.getStatistics().healthCheckGap());
+  REQUIRE(emulator.isScanning());
+
+  // A warning is reported but scanning simply continues.
+  emulator.setHealth(RPLidarEmulator::HEALTH_WARNING, 0x42);
+  REQUIRE(RPLidarEmulator::HEALTH_WARNING == rplidar.checkHealth());
+  REQUIRE(0 == rplidar.getStatistics().deviceResets());
+
+  // An error stops the device until it was reset.
+  emulator.setHealth(RPLidarEmulator::HEALTH_ERROR, 0x1234);
+  REQUIRE(!emulator.isScanning());
+  REQUIRE(RPLidarEmulator::HEALTH_ERROR == rplidar.checkHealth());
+  REQUIRE(1 == rplidar.getStatistics().deviceResets());
+  REQUIRE(emulator.isScanning());
+  const uint32_t scansBefore{scans};
+  std::this_thread::sleep_for(std::chrono::milliseconds(200));
+  REQUIRE(scansBefore + 2 <= scans);
+  REQUIRE(RPLidarEmulator::HEALTH_GOOD == rplidar.checkHealth());
+  REQUIRE(4 == rplidar.getStatistics().healthChecks());
+}
+
+TEST_CASE("Test RPLidar reconnects after scans stalled.") {
+  RPLidarEmulator emulator(20.0f, 360);
+  REQUIRE(emulator.isOpen());
+  std::atomic<uint32_t> scans{0};
+  RPLidar rplidar(emulator.getDeviceName());
+  REQUIRE(rplidar.isOpen());
+  REQUIRE(!rplidar.isStalled(std::chrono::milliseconds(0)));
+  rplidar.startScanning(nullptr, nullptr, [&scans](const opendlv::proxy::PointCloudReading &){ scans++; });
+  std::this_thread::sleep_for(std::chrono::milliseconds(200));
+  REQUIRE(!rplidar.isStalled(std::chrono::milliseconds(200)));
+
+  // The device goes silent.
+  emulator.setHealth(RPLidarEmulator::HEALTH_ERROR);
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  REQUIRE(!rplidar.isStalled(std::chrono::milliseconds(200)));
+  std::this_thread::sleep_for(std::chrono::milliseconds(200));
+  REQUIRE(rplidar.isStalled(std::chrono::milliseconds(200)));
+
+  REQUIRE(rplidar.reconnect());
+  REQUIRE(emulator.isScanning());
+  REQUIRE(!rplidar.isStalled(std::chrono::milliseconds(200)));
+  const opendlv::device::lidar::rplidar::DriverStatistics statistics{rplidar.getStatistics()};
+  REQUIRE(1 == statistics.reconnects());
+  REQUIRE(300 <= statistics.recoveryTime());
+  REQUIRE(2000 > statistics.recoveryTime());
+  const uint32_t scansBefore{scans};
+  std::this_thread::sleep_for(std::chrono::milliseconds(200));
+  REQUIRE(scansBefore + 2 <= scans);
+
+  // No watchdog while scanning was stopped on purpose.
+  rplidar.stopScanning();
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  REQUIRE(!rplidar.isStalled(std::chrono::milliseconds(50)));
+}
+
+TEST_CASE("Test several RPLidars served from one IoLoop.") {
+  RPLidarEmulator first(20.0f, 360);
+  RPLidarEmulator second(10.0f, 720);
+  REQUIRE(first.isOpen());
+  REQUIRE(second.isOpen());
+
+  IoLoop ioLoop;
+  REQUIRE(ioLoop.isRunning());
+  std::atomic<uint32_t> firstScans{0};
+  std::atomic<uint32_t> secondScans{0};
+  std::atomic<uint32_t> wrongSize{0};
+  {
+    RPLidar firstRPLidar(first.getDeviceName(), "", &ioLoop);
+    RPLidar secondRPLidar(second.getDeviceName(), "", &ioLoop);
+    REQUIRE(firstRPLidar.isOpen());
+    REQUIRE(secondRPLidar.isOpen());
+    REQUIRE(2 == ioLoop.size());
+
+    std::thread handshake([&firstRPLidar, &firstScans, &wrongSize](){
+      firstRPLidar.startScanning(nullptr, nullptr, [&firstScans, &wrongSize](const opendlv::proxy::PointCloudReading &pc){
+        wrongSize += (360 * 4 != pc.distances().size()) ? 1 : 0;
+        firstScans++;
+      });
+    });
+    secondRPLidar.startScanning(nullptr, nullptr, [&secondScans, &wrongSize](const opendlv::proxy::PointCloudReading &pc){
+      wrongSize += (720 * 4 != pc.distances().size()) ? 1 : 0;
+      secondScans++;
+    });
+    handshake.join();
+    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+  }
+  REQUIRE(0 == ioLoop.size());
+  REQUIRE(6 <= firstScans);
+  REQUIRE(3 <= secondScans);
+  REQUIRE(0 == wrongSize);
+}
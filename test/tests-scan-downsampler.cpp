@@ -0,0 +1,101 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "catch.hpp"
+
+#include "rplidar-decoder.hpp"
+#include "scan-downsampler.hpp"
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+TEST_CASE("Test ScanDownsampler thins close surfaces and keeps distant returns.") {
+  // 900 samples on a wall at 1 m and 100 on one at 10 m.
+  std::vector<float> angles(1000);
+  std::vector<float> distances(1000);
+  for (uint32_t i{0}; i < 1000; i++) {
+    angles[i] = static_cast<float>(i) * 0.36f;
+    distances[i] = (900 > i) ? 1.0f : 10.0f;
+  }
+  distances[0] = 0.0f;
+
+  ScanDownsampler downsampler(200);
+  const uint32_t kept{downsampler.apply(angles.data(), distances.data(), 1000)};
+  REQUIRE(200 >= kept);
+  REQUIRE(195 <= kept);
+  uint32_t far{0};
+  for (uint32_t i{0}; i < kept; i++) {
+    REQUIRE(0.0f < distances[i]);
+    REQUIRE(((1.0f < distances[i]) ? 324.0f : 0.0f) <= angles[i]);
+    far += (1.0f < distances[i]) ? 1 : 0;
+    if (0 < i) {
+      REQUIRE(angles[i - 1] < angles[i]);
+    }
+  }
+  REQUIRE(100 == far);
+}
+
+TEST_CASE("Test ScanDownsampler leaves scans within budget.") {
+  std::vector<float> angles{0.0f, 1.0f, 2.0f};
+  std::vector<float> distances{1.0f, 2.0f, 3.0f};
+  ScanDownsampler downsampler(3);
+  REQUIRE(3 == downsampler.apply(angles.data(), distances.data(), 3));
+  REQUIRE(2.0f == Approx(distances[1]));
+  REQUIRE(1.0f == Approx(angles[1]));
+  REQUIRE(3 == ScanDownsampler(0).apply(angles.data(), distances.data(), 3));
+}
+
+TEST_CASE("Test RPLidarDecoder keeps the point budget.") {
+  // Two scans with 720 samples at 0.5 m, 4 m from 180 to 270 degree.
+  std::vector<uint8_t> bytes{0xa5, 0x5a, 0x5, 0x0, 0x0, 0x40, 0x81};
+  for (uint32_t scan{0}; scan < 2; scan++) {
+    for (uint16_t i{0}; i < 720; i++) {
+      RPLidarDecoder::encodeScanNode(bytes, 0 == i, 15, static_cast<uint16_t>(i * 32), static_cast<uint16_t>(((360 <= i) && (540 > i)) ? 16000 : 2000));
+    }
+  }
+  RPLidarDecoder::encodeScanNode(bytes, true, 15, 0, 2000);
+
+  RPLidarDecoder decoder;
+  std::vector<uint32_t> samples;
+  std::vector<float> distances;
+  std::string validity;
+  decoder.setDelegates(nullptr, nullptr, [&samples, &distances](const opendlv::proxy::PointCloudReading &pc){
+    samples.push_back(static_cast<uint32_t>(pc.distances().size() / 4));
+    distances.resize(pc.distances().size() / 4);
+    std::memcpy(distances.data(), pc.distances().data(), distances.size() * sizeof(float));
+  });
+  decoder.setInvalidSamples(RPLidarDecoder::MARK_INVALID, [&validity](const opendlv::device::lidar::rplidar::ScanValidity &sv){
+    REQUIRE(sv.numberOfSamples() * 1u <= sv.validity().size() * 8);
+    validity = sv.validity();
+  });
+  decoder.setPointBudget(300);
+  decoder.decode(bytes.data(), bytes.size());
+
+  REQUIRE(2 == samples.size());
+  REQUIRE(300 >= samples[1]);
+  REQUIRE(290 <= samples[1]);
+  uint32_t far{0};
+  for (auto d : distances) {
+    far += (1.0f < d) ? 1 : 0;
+  }
+  // Distant samples cover a quarter of the scan but most of its length.
+  REQUIRE(180 == far);
+  REQUIRE((samples[1] + 7) / 8 == validity.size());
+  REQUIRE(static_cast<char>(0xFF) == validity[0]);
+  REQUIRE(2 * (720 - samples[1]) == decoder.getStatistics().samplesDownsampled());
+}
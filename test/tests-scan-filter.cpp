@@ -0,0 +1,127 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "catch.hpp"
+
+#include "rplidar-decoder.hpp"
+#include "scan-filter.hpp"
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+TEST_CASE("Test ScanFilter median removes spikes.") {
+  ScanFilter::Config config;
+  config.medianWindow = 3;
+  ScanFilter filter(config);
+
+  std::vector<float> distances(100, 2.0f);
+  distances[10] = 0.5f;
+  distances[50] = 0.0f;
+  // Neighbour of the first sample in a circular scan.
+  distances[99] = 7.0f;
+  REQUIRE(0 == filter.apply(distances.data(), static_cast<uint32_t>(distances.size())));
+  REQUIRE(2.0f == Approx(distances[10]));
+  REQUIRE(2.0f == Approx(distances[99]));
+  REQUIRE(2.0f == Approx(distances[0]));
+  // Samples without return stay without return.
+  REQUIRE(!(0.0f < distances[50]));
+
+  // Two neighbouring spikes need a window of five.
+  std::vector<float> wide(100, 2.0f);
+  wide[20] = 0.5f;
+  wide[21] = 0.6f;
+  ScanFilter filter5(ScanFilter::Config{5, 0.0f});
+  filter5.apply(wide.data(), static_cast<uint32_t>(wide.size()));
+  REQUIRE(2.0f == Approx(wide[20]));
+  REQUIRE(2.0f == Approx(wide[21]));
+}
+
+TEST_CASE("Test ScanFilter median ignores samples without return.") {
+  for (uint32_t window : {3u, 5u}) {
+    ScanFilter filter(ScanFilter::Config{window, 0.0f});
+    std::vector<float> distances(100, 2.0f);
+    // A return between samples without return is kept.
+    distances[9] = 0.0f;
+    distances[10] = 0.0f;
+    distances[11] = 1.0f;
+    distances[12] = 0.0f;
+    distances[13] = 0.0f;
+    // Next to a dropout, the median is over the returns only.
+    distances[40] = 0.0f;
+    distances[41] = 0.0f;
+    distances[42] = 1.0f;
+    for (size_t i{43}; i < 50; i++) {
+      distances[i] = 1.0f + 0.01f * static_cast<float>(i - 42);
+    }
+    REQUIRE(0 == filter.apply(distances.data(), static_cast<uint32_t>(distances.size())));
+    REQUIRE(1.0f == Approx(distances[11]));
+    REQUIRE(1.0f == Approx(distances[42]));
+    REQUIRE(1.01f == Approx(distances[43]));
+    REQUIRE(!(0.0f < distances[10]));
+    REQUIRE(!(0.0f < distances[12]));
+  }
+}
+
+TEST_CASE("Test ScanFilter removes isolated samples.") {
+  ScanFilter filter(ScanFilter::Config{0, 0.3f});
+  std::vector<float> distances(100, 2.0f);
+  distances[10] = 1.0f;
+  // A step of an edge is kept.
+  for (size_t i{60}; i < 100; i++) {
+    distances[i] = 4.0f;
+  }
+  // A return between samples without return is isolated as well.
+  distances[30] = 0.0f;
+  distances[31] = 3.0f;
+  distances[32] = 0.0f;
+  REQUIRE(2 == filter.apply(distances.data(), static_cast<uint32_t>(distances.size())));
+  REQUIRE(!(0.0f < distances[10]));
+  REQUIRE(!(0.0f < distances[31]));
+  REQUIRE(4.0f == Approx(distances[60]));
+  REQUIRE(2.0f == Approx(distances[59]));
+}
+
+TEST_CASE("Test RPLidarDecoder drops samples removed by the filter.") {
+  // 1 m everywhere except for a spike of 3 m at 100 degree.
+  std::vector<uint8_t> bytes{0xa5, 0x5a, 0x5, 0x0, 0x0, 0x40, 0x81};
+  for (uint32_t scan{0}; scan < 2; scan++) {
+    for (uint16_t degree{0}; degree < 360; degree++) {
+      RPLidarDecoder::encodeScanNode(bytes, 0 == degree, 15, static_cast<uint16_t>(degree * 64), static_cast<uint16_t>((100 == degree) ? 12000 : 4000));
+    }
+  }
+  RPLidarDecoder::encodeScanNode(bytes, true, 15, 0, 4000);
+
+  RPLidarDecoder decoder;
+  std::vector<uint32_t> samples;
+  std::vector<float> distances;
+  decoder.setDelegates(nullptr, nullptr, [&samples, &distances](const opendlv::proxy::PointCloudReading &pc){
+    samples.push_back(static_cast<uint32_t>(pc.distances().size() / 4));
+    distances.resize(pc.distances().size() / 4);
+    std::memcpy(distances.data(), pc.distances().data(), distances.size() * sizeof(float));
+  });
+  decoder.setScanFilter(ScanFilter::Config{0, 0.5f});
+  decoder.setInvalidSamples(RPLidarDecoder::DROP_INVALID);
+  decoder.decode(bytes.data(), bytes.size());
+
+  REQUIRE(std::vector<uint32_t>{359, 359} == samples);
+  for (auto d : distances) {
+    REQUIRE(1.0f == Approx(d));
+  }
+  REQUIRE(2 == decoder.getStatistics().outliersRemoved());
+  REQUIRE(359 == decoder.getStatistics().samplesPerScan());
+}
@@ -0,0 +1,126 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "catch.hpp"
+
+#include "rplidar-decoder.hpp"
+#include "scan-matcher.hpp"
+#include "scan-synthesizer.hpp"
+
+#include <cmath>
+#include <vector>
+
+namespace {
+constexpr const float PI{3.14159265f};
+
+// Noise-free scan of the default room from the given pose.
+void castScan(ScanSynthesizer &synthesizer, float x, float y, float yaw, uint32_t samples, std::vector<float> &angles, std::vector<float> &distances) {
+  synthesizer.setSensorPose(x, y, yaw);
+  angles.resize(samples);
+  distances.resize(samples);
+  for (uint32_t i{0}; i < samples; i++) {
+    angles[i] = static_cast<float>(i) * 360.0f / static_cast<float>(samples);
+    distances[i] = synthesizer.castRay(yaw - angles[i] * PI / 180.0f, 0.0f);
+  }
+}
+}
+
+TEST_CASE("Test ScanMatcher recovers the motion between two scans.") {
+  ScanSynthesizer synthesizer{ScanSynthesizer::defaultRoom()};
+  ScanMatcher matcher(ScanMatcher::Config{});
+  std::vector<float> angles;
+  std::vector<float> distances;
+  ScanMatcher::Result result;
+
+  castScan(synthesizer, 0.5f, 0.2f, 0.3f, 1440, angles, distances);
+  REQUIRE(!matcher.match(angles.data(), distances.data(), 1440, result));
+
+  // 10 cm forward, 5 cm to the left, and 3 degree to the left in the frame
+  // of the first scan.
+  const float c{std::cos(0.3f)};
+  const float s{std::sin(0.3f)};
+  castScan(synthesizer, 0.5f + c * 0.1f - s * 0.05f, 0.2f + s * 0.1f + c * 0.05f, 0.3f + 3.0f * PI / 180.0f, 1440, angles, distances);
+  REQUIRE(matcher.match(angles.data(), distances.data(), 1440, result));
+  REQUIRE(result.converged);
+  REQUIRE(1000 < result.correspondences);
+  REQUIRE(0.1f == Approx(result.delta.x).margin(0.005));
+  REQUIRE(0.05f == Approx(result.delta.y).margin(0.005));
+  REQUIRE(3.0f * PI / 180.0f == Approx(result.delta.yaw).margin(0.002));
+  REQUIRE(0.01f > result.residual);
+  REQUIRE(0.1f == Approx(matcher.pose().x).margin(0.005));
+
+  // Without samples, nothing can be matched and the previous motion is
+  // assumed to go on.
+  std::vector<float> none(1440, 0.0f);
+  REQUIRE(matcher.match(angles.data(), none.data(), 1440, result));
+  REQUIRE(!result.converged);
+  REQUIRE(0 == result.correspondences);
+  REQUIRE(0.1f == Approx(result.delta.x).margin(0.005));
+  REQUIRE(3.0f * PI / 180.0f == Approx(result.delta.yaw).margin(0.002));
+  REQUIRE(0.2f == Approx(matcher.pose().x).margin(0.01));
+
+  // After a restart, the next scan is the reference at the same pose.
+  const ScanMatcher::Pose pose{matcher.pose()};
+  matcher.restart();
+  castScan(synthesizer, 0.9f, 0.2f, 0.3f, 1440, angles, distances);
+  REQUIRE(!matcher.match(angles.data(), distances.data(), 1440, result));
+  REQUIRE(pose.x == Approx(matcher.pose().x));
+}
+
+TEST_CASE("Test RPLidarDecoder sends odometry for every scan after the first.") {
+  ScanSynthesizer synthesizer{ScanSynthesizer::defaultRoom(0, 10.0f)};
+  ScanSynthesizer::NoiseModel noiseModel;
+  noiseModel.sigma = 0.005f;
+  synthesizer.setNoiseModel(noiseModel);
+  std::vector<uint8_t> nodes{RPLidarDecoder::SYNC_BYTE0, RPLidarDecoder::SYNC_BYTE1, 0x5, 0x0, 0x0, 0x40, RPLidarDecoder::GOT_SCAN};
+  // Driving forward at 0.5 m/s along x.
+  for (uint32_t i{0}; i < 6; i++) {
+    synthesizer.setSensorPose(-1.0f + 0.05f * static_cast<float>(i), 0.0f, 0.0f);
+    synthesizer.synthesize(i, 720, nodes);
+  }
+  RPLidarDecoder::encodeScanNode(nodes, true, 15, 0, 4000);
+
+  RPLidarDecoder decoder;
+  uint32_t scans{0};
+  std::vector<opendlv::device::lidar::rplidar::ScanOdometry> odometry;
+  decoder.setDelegates(nullptr, nullptr, [&scans](const opendlv::proxy::PointCloudReading &){
+    scans++;
+  });
+  decoder.setOdometry(ScanMatcher::Config(), [&odometry](const opendlv::device::lidar::rplidar::ScanOdometry &so){
+    odometry.push_back(so);
+  });
+  decoder.decode(nodes.data(), nodes.size());
+
+  REQUIRE(6 == scans);
+  REQUIRE(5 == odometry.size());
+  for (const auto &so : odometry) {
+    REQUIRE(so.converged());
+    REQUIRE(0.05f == Approx(so.deltaX()).margin(0.01));
+    REQUIRE(0.0f == Approx(so.deltaY()).margin(0.01));
+  }
+  REQUIRE(0.25f == Approx(odometry.back().x()).margin(0.02));
+  REQUIRE(0.0f == Approx(odometry.back().yaw()).margin(0.01));
+
+  // Leaving scanning mode, e.g., for a ScanRequest, starts from a new
+  // reference at the same pose: the first scan after it is not matched
+  // against the last one before, which was 0.25 m ahead.
+  decoder.leaveScanningMode();
+  decoder.decode(nodes.data(), nodes.size());
+  REQUIRE(12 == scans);
+  REQUIRE(10 == odometry.size());
+  REQUIRE(0.5f == Approx(odometry.back().x()).margin(0.04));
+}
@@ -0,0 +1,142 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "catch.hpp"
+
+#include "scan-merger.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+opendlv::proxy::PointCloudReading scan(const std::vector<float> &angles, const std::vector<float> &distances) {
+  opendlv::proxy::PointCloudReading pc;
+  pc.azimuthAngles(std::string(reinterpret_cast<const char*>(angles.data()), angles.size() * sizeof(float)))
+    .distances(std::string(reinterpret_cast<const char*>(distances.data()), distances.size() * sizeof(float)));
+  return pc;
+}
+
+std::vector<float> points(const opendlv::device::lidar::rplidar::MergedPointCloud &mpc) {
+  const std::string bytes{mpc.points()};
+  std::vector<float> p(bytes.size() / sizeof(float));
+  std::memcpy(p.data(), bytes.data(), bytes.size());
+  return p;
+}
+
+const int64_t MS{1000 * 1000};
+}
+
+TEST_CASE("Test ScanMerger parses extrinsics.") {
+  ScanMerger::Extrinsics e;
+  REQUIRE(ScanMerger::parseExtrinsics("0.5:-0.25:90", e));
+  REQUIRE(0.5f == Approx(e.x));
+  REQUIRE(-0.25f == Approx(e.y));
+  REQUIRE(static_cast<float>(M_PI) / 2.0f == Approx(e.yaw));
+  REQUIRE(!ScanMerger::parseExtrinsics("0.5:0", e));
+  REQUIRE(!ScanMerger::parseExtrinsics("a:b:c", e));
+}
+
+TEST_CASE("Test ScanMerger transforms scans of several devices into the vehicle frame.") {
+  // One device at the front looking forward, one at the back looking backward.
+  std::vector<ScanMerger::Extrinsics> extrinsics(3);
+  extrinsics[0].x = 1.0f;
+  extrinsics[1].x = -1.0f;
+  extrinsics[1].yaw = static_cast<float>(M_PI);
+
+  std::vector<float> p;
+  std::string pointsPerDevice;
+  uint32_t numberOfPoints{0};
+  ScanMerger merger(extrinsics, std::chrono::milliseconds(200), [&](opendlv::device::lidar::rplidar::MergedPointCloud &mpc, int64_t){
+    p = points(mpc);
+    pointsPerDevice = mpc.pointsPerDevice();
+    numberOfPoints = mpc.numberOfPoints();
+  });
+
+  // Azimuths are clockwise; 0 m is no return.
+  merger.addScan(0, scan({0.0f, 10.0f}, {2.0f, 0.0f}), 100 * MS, 10.0f);
+  merger.addScan(1, scan({90.0f}, {1.0f}), 100 * MS, 10.0f);
+  REQUIRE(2 == merger.merge(150 * MS));
+  REQUIRE(2 == numberOfPoints);
+  REQUIRE(4 == p.size());
+  REQUIRE(3.0f == Approx(p[0]));
+  REQUIRE(0.0f == Approx(p[1]).margin(1e-6));
+  REQUIRE(-1.0f == Approx(p[2]));
+  REQUIRE(1.0f == Approx(p[3]));
+  const uint32_t expected[]{1, 1, 0};
+  REQUIRE(sizeof(expected) == pointsPerDevice.size());
+  REQUIRE(0 == std::memcmp(expected, pointsPerDevice.data(), sizeof(expected)));
+
+  // The latest scans are kept until they are too old.
+  REQUIRE(2 == merger.merge(300 * MS));
+  merger.addScan(1, scan({90.0f}, {1.0f}), 300 * MS, 10.0f);
+  REQUIRE(1 == merger.merge(350 * MS));
+  REQUIRE(1 == numberOfPoints);
+  REQUIRE(3 == merger.merges());
+}
+
+TEST_CASE("Test ScanMerger deskews samples by the vehicle motion.") {
+  std::vector<float> p;
+  bool deskewed{false};
+  ScanMerger merger({ScanMerger::Extrinsics()}, std::chrono::milliseconds(500), [&](opendlv::device::lidar::rplidar::MergedPointCloud &mpc, int64_t){
+    p = points(mpc);
+    deskewed = mpc.deskewed();
+  });
+  merger.setDeskew(true);
+
+  // At 10 Hz, the only sample of the scan was measured 100 ms before its end
+  // that was 100 ms before the merge.
+  merger.addScan(0, scan({0.0f}, {3.0f}), 100 * MS, 10.0f);
+  merger.setMotion(1.0f, 0.0f, 0.0f);
+  REQUIRE(1 == merger.merge(200 * MS));
+  REQUIRE(deskewed);
+  REQUIRE(2.8f == Approx(p[0]));
+  REQUIRE(0.0f == Approx(p[1]).margin(1e-6));
+
+  merger.setMotion(0.0f, 0.0f, static_cast<float>(M_PI) / 2.0f);
+  REQUIRE(1 == merger.merge(200 * MS));
+  REQUIRE(3.0f * std::cos(static_cast<float>(M_PI) / 10.0f) == Approx(p[0]));
+  REQUIRE(-3.0f * std::sin(static_cast<float>(M_PI) / 10.0f) == Approx(p[1]));
+}
+
+TEST_CASE("Test ScanMerger merges periodically.") {
+  std::atomic<uint32_t> merged{0};
+  {
+    ScanMerger merger(std::vector<ScanMerger::Extrinsics>(4), std::chrono::milliseconds(1000), [&merged](opendlv::device::lidar::rplidar::MergedPointCloud &mpc, int64_t){
+      if (4 * 720 == mpc.numberOfPoints()) {
+        merged++;
+      }
+    });
+    std::vector<float> angles;
+    for (uint32_t i{0}; i < 720; i++) {
+      angles.push_back(static_cast<float>(i) / 2.0f);
+    }
+    const opendlv::proxy::PointCloudReading pc{scan(angles, std::vector<float>(720, 5.0f))};
+    const int64_t now{std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count()};
+    for (uint32_t i{0}; i < 4; i++) {
+      merger.addScan(i, pc, now, 10.0f);
+    }
+    merger.start(std::chrono::milliseconds(20));
+    std::this_thread::sleep_for(std::chrono::milliseconds(150));
+    REQUIRE(merger.mergeDuration() < 20 * 1000);
+  }
+  REQUIRE(3 <= merged);
+}
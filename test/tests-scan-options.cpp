@@ -0,0 +1,97 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "catch.hpp"
+
+#include "scan-options.hpp"
+
+#include <map>
+#include <string>
+#include <vector>
+
+TEST_CASE("Test ScanOptions defaults without options.") {
+  std::map<std::string, std::string> arguments;
+  ScanOptions options;
+  std::string error;
+  REQUIRE(options.parse(arguments, 2, error));
+  REQUIRE(2 == options.devices.size());
+  REQUIRE(0 == options.sectors);
+  REQUIRE(RPLidarDecoder::KEEP_INVALID == options.invalidSamples);
+  REQUIRE(0 == options.grid.size);
+  REQUIRE(0.0f == Approx(options.lines.splitDistance));
+  REQUIRE(!options.linesOnly);
+  REQUIRE(options.pipeline.empty());
+  REQUIRE(options.warning().empty());
+}
+
+TEST_CASE("Test ScanOptions parses values per device.") {
+  std::map<std::string, std::string> arguments{{"mount-x", "1.5,-0.5"}, {"mount-yaw", ",180"}, {"mount-flip", "0,1"}, {"max-range", "8"}, {"mask", "90:270/0:10,350:360"}};
+  ScanOptions options;
+  std::string error;
+  REQUIRE(options.parse(arguments, 2, error));
+  REQUIRE(1.5f == Approx(options.devices[0].mountX));
+  REQUIRE(-0.5f == Approx(options.devices[1].mountX));
+  // Empty entries are skipped, i.e., values apply to the first devices.
+  REQUIRE(180.0f == Approx(options.devices[0].mountYaw));
+  REQUIRE(!options.devices[0].mountFlip);
+  REQUIRE(options.devices[1].mountFlip);
+  REQUIRE(8.0f == Approx(options.devices[0].maxRange));
+  REQUIRE(0.0f == Approx(options.devices[1].maxRange));
+  REQUIRE(1 == options.devices[0].masks.size());
+  REQUIRE(2 == options.devices[1].masks.size());
+}
+
+TEST_CASE("Test ScanOptions rejects invalid options.") {
+  const std::map<std::string, std::string> invalid[]{
+    {{"invalid", "ignore"}},
+    {{"median", "4"}},
+    {{"mask", "90"}},
+    {{"grid", "8192"}},
+    {{"grid", "256"}, {"grid-rate", "0"}},
+    {{"lines-only", ""}},
+    {{"pipeline", "median,outliers"}, {"median", "3"}},
+    {{"pipeline", "smooth"}},
+  };
+  for (auto arguments : invalid) {
+    ScanOptions options;
+    std::string error;
+    REQUIRE(!options.parse(arguments, 1, error));
+    REQUIRE(!error.empty());
+  }
+}
+
+TEST_CASE("Test ScanOptions accepts a configured pipeline and warns about a grid without odometry.") {
+  std::map<std::string, std::string> arguments{{"median", "5"}, {"budget", "360"}, {"grid", "128"}, {"lines", "0.05"}, {"lines-only", ""}, {"invalid", "mark"}, {"pipeline", "resample,median,grid,lines"}};
+  ScanOptions options;
+  std::string error;
+  REQUIRE(options.parse(arguments, 1, error));
+  REQUIRE(RPLidarDecoder::MARK_INVALID == options.invalidSamples);
+  REQUIRE(5 == options.scanFilter.medianWindow);
+  REQUIRE(360 == options.budget);
+  REQUIRE(options.linesOnly);
+  REQUIRE("resample,median,grid,lines" == options.pipeline);
+  REQUIRE(!options.warning().empty());
+
+  arguments["odometry"] = "";
+  REQUIRE(options.parse(arguments, 1, error));
+  REQUIRE(options.warning().empty());
+}
+
+TEST_CASE("Test ScanOptions splits lists.") {
+  REQUIRE(ScanOptions::split("").empty());
+  REQUIRE((std::vector<std::string>{"a", "b"}) == ScanOptions::split("a,,b,"));
+}
@@ -0,0 +1,95 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "catch.hpp"
+
+#include "scan-pipeline.hpp"
+#include "scan-stages.hpp"
+
+#include <string>
+#include <vector>
+
+namespace {
+using Pipeline = ScanPipeline<MedianStage, OutlierStage, ResampleStage>;
+
+void fill(ScanBuffer &buffer, uint32_t size) {
+  buffer.angles.resize(size);
+  buffer.distances.resize(size);
+  for (uint32_t i{0}; i < size; i++) {
+    buffer.angles[i] = static_cast<float>(i) * 360.0f / static_cast<float>(size);
+    buffer.distances[i] = 2.0f;
+  }
+  buffer.size = size;
+}
+}
+
+TEST_CASE("Test ScanPipeline stage order.") {
+  Pipeline pipeline;
+  REQUIRE(3 == Pipeline::NUMBER_OF_STAGES);
+  REQUIRE(1 == Pipeline::indexOf<OutlierStage>());
+  REQUIRE(std::string("resample") == Pipeline::name(2));
+  REQUIRE((std::vector<uint32_t>{0, 1, 2}) == pipeline.order());
+
+  REQUIRE(pipeline.setOrder("resample,median"));
+  REQUIRE((std::vector<uint32_t>{2, 0}) == pipeline.order());
+  REQUIRE(!pipeline.setOrder("mask,median"));
+  REQUIRE(!pipeline.setOrder("median,median"));
+  REQUIRE((std::vector<uint32_t>{2, 0}) == pipeline.order());
+
+  // Stages that are not configured are skipped.
+  REQUIRE(!pipeline.enabled());
+  pipeline.stage<OutlierStage>().configure(0.5f, 100);
+  REQUIRE(!pipeline.enabled());
+  ScanBuffer buffer;
+  fill(buffer, 100);
+  REQUIRE(0 == pipeline.run(buffer));
+  REQUIRE(0 == pipeline.statistics(Pipeline::indexOf<OutlierStage>()).runs);
+}
+
+TEST_CASE("Test ScanPipeline runs and times the configured stages.") {
+  Pipeline pipeline;
+  pipeline.stage<MedianStage>().configure(3, 100);
+  pipeline.stage<OutlierStage>().configure(0.5f, 100);
+  pipeline.stage<ResampleStage>().configure(50);
+  REQUIRE(pipeline.setOrder("outliers,resample"));
+  REQUIRE(pipeline.enabled());
+
+  ScanBuffer buffer;
+  for (uint32_t scan{0}; scan < 2; scan++) {
+    fill(buffer, 100);
+    buffer.distances[10] = 5.0f;
+    // The outlier and 49 thinned returns; the outlier is not counted twice.
+    REQUIRE(50 == pipeline.run(buffer));
+    REQUIRE(50 == buffer.size);
+    // The outlier was removed before it could be resampled.
+    for (uint32_t i{0}; i < buffer.size; i++) {
+      REQUIRE(2.0f == Approx(buffer.distances[i]));
+    }
+  }
+
+  const Pipeline::Statistics outliers{pipeline.statistics(Pipeline::indexOf<OutlierStage>())};
+  REQUIRE(2 == outliers.runs);
+  REQUIRE(2 == outliers.samplesRemoved);
+  REQUIRE(0 <= outliers.duration);
+  REQUIRE(outliers.maxDuration <= outliers.duration);
+  REQUIRE(98 == pipeline.statistics(Pipeline::indexOf<ResampleStage>()).samplesRemoved);
+  REQUIRE(0 == pipeline.statistics(Pipeline::indexOf<MedianStage>()).runs);
+
+  const std::string s{pipeline.toString()};
+  REQUIRE(s.find("outliers: ") < s.find("resample: "));
+  REQUIRE(std::string::npos == s.find("median"));
+}
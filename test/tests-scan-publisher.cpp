@@ -0,0 +1,119 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "catch.hpp"
+
+#include "scan-publisher.hpp"
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+TEST_CASE("Test ScanPublisher sends scans of several producers.") {
+  std::mutex sentMutex;
+  std::vector<uint32_t> senderStamps;
+  std::vector<float> startAzimuths;
+  {
+    ScanPublisher publisher([&](opendlv::proxy::PointCloudReading &pc, uint32_t senderStamp){
+      std::lock_guard<std::mutex> lck(sentMutex);
+      senderStamps.push_back(senderStamp);
+      startAzimuths.push_back(pc.startAzimuth());
+    }, 64);
+
+    auto produce = [&publisher](uint32_t senderStamp){
+      opendlv::proxy::PointCloudReading pc;
+      pc.distances(std::string(1440, 'x'));
+      for (uint32_t i{0}; i < 10; i++) {
+        pc.startAzimuth(static_cast<float>(i));
+        REQUIRE(publisher.publish(pc, senderStamp));
+      }
+    };
+    std::thread first(produce, 1);
+    std::thread second(produce, 2);
+    first.join();
+    second.join();
+  }
+  // All queued scans are sent before the publisher ends.
+  REQUIRE(20 == senderStamps.size());
+  float lastOfFirst{-1.0f};
+  for (size_t i{0}; i < senderStamps.size(); i++) {
+    REQUIRE( ((1 == senderStamps[i]) || (2 == senderStamps[i])) );
+    if (1 == senderStamps[i]) {
+      // In order per producer.
+      REQUIRE(lastOfFirst < startAzimuths[i]);
+      lastOfFirst = startAzimuths[i];
+    }
+  }
+}
+
+TEST_CASE("Test ScanPublisher drops scans when the queue is full.") {
+  std::mutex blockMutex;
+  std::condition_variable unblocked;
+  bool blocked{true};
+  uint32_t sent{0};
+  ScanPublisher publisher([&](opendlv::proxy::PointCloudReading &, uint32_t){
+    std::unique_lock<std::mutex> lck(blockMutex);
+    unblocked.wait(lck, [&blocked](){ return !blocked; });
+    sent++;
+  }, 2);
+
+  opendlv::proxy::PointCloudReading pc;
+  REQUIRE(publisher.publish(pc, 0));
+  REQUIRE(publisher.publish(pc, 0));
+  // The first one is being sent and occupies its entry until it was sent.
+  REQUIRE(!publisher.publish(pc, 0));
+  REQUIRE(1 == publisher.dropped());
+
+  {
+    std::lock_guard<std::mutex> lck(blockMutex);
+    blocked = false;
+  }
+  unblocked.notify_all();
+  const auto end{std::chrono::steady_clock::now() + std::chrono::seconds(1)};
+  while ( (2 > publisher.published()) && (std::chrono::steady_clock::now() < end) ) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  REQUIRE(2 == publisher.published());
+}
+
+TEST_CASE("Test ScanPublisher records the latencies of sending a scan.") {
+  LatencyTracer latencyTracer;
+  {
+    ScanPublisher publisher([](opendlv::proxy::PointCloudReading &, uint32_t){
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    });
+
+    const int64_t now{LatencyTracer::now()};
+    latencyTracer.mark(LatencyTracer::SERIAL_READ, now - 3000);
+    latencyTracer.mark(LatencyTracer::NODE_DECODE, now - 2000);
+    latencyTracer.mark(LatencyTracer::SCAN_COMPLETE, now - 1000);
+    opendlv::proxy::PointCloudReading pc;
+    REQUIRE(publisher.publish(pc, 0, &latencyTracer));
+    // As done by the decoder once the scan was handed over.
+    latencyTracer.complete();
+    publisher.stop();
+    REQUIRE(!publisher.publish(pc, 0, &latencyTracer));
+  }
+  for (uint8_t i{0}; i < LatencyTracer::NUMBER_OF_STAGES; i++) {
+    REQUIRE(1 == latencyTracer.statistics(static_cast<LatencyTracer::Stage>(i)).count);
+  }
+  REQUIRE(1000000 <= latencyTracer.statistics(LatencyTracer::UDP_SEND).p50);
+  REQUIRE(1000000 + 3000 <= latencyTracer.statistics(LatencyTracer::SERIAL_READ).max);
+}
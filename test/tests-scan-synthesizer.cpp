@@ -0,0 +1,73 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "catch.hpp"
+
+#include "rplidar-decoder.hpp"
+#include "scan-synthesizer.hpp"
+
+#include <cstring>
+#include <vector>
+
+TEST_CASE("Test ScanSynthesizer ray casting.") {
+  ScanSynthesizer synthesizer;
+  synthesizer.addPolygon({{-2.0f, -1.0f}, {2.0f, -1.0f}, {2.0f, 1.0f}, {-2.0f, 1.0f}});
+
+  std::vector<uint8_t> bytes{0xa5, 0x5a, 0x5, 0x0, 0x0, 0x40, 0x81};
+  synthesizer.synthesize(0, 360, bytes);
+  synthesizer.synthesize(1, 360, bytes);
+  REQUIRE(7 + 2 * 360 * 5 == bytes.size());
+
+  std::vector<float> distances;
+  RPLidarDecoder decoder;
+  decoder.setDelegates(nullptr, nullptr, [&distances](const opendlv::proxy::PointCloudReading &pc){
+    const std::string d{pc.distances()};
+    distances.resize(d.size() / sizeof(float));
+    std::memcpy(distances.data(), d.data(), d.size());
+  });
+  decoder.decode(bytes.data(), bytes.size());
+
+  REQUIRE(360 == distances.size());
+  REQUIRE(Approx(2.0f).epsilon(0.001) == distances[0]);
+  REQUIRE(Approx(1.0f).epsilon(0.001) == distances[90]);
+  REQUIRE(Approx(2.0f).epsilon(0.001) == distances[180]);
+  REQUIRE(Approx(1.0f).epsilon(0.001) == distances[270]);
+}
+
+TEST_CASE("Test ScanSynthesizer determinism.") {
+  ScanSynthesizer::NoiseModel noiseModel;
+  noiseModel.sigma = 0.05f;
+  noiseModel.dropoutProbability = 0.1f;
+
+  ScanSynthesizer::Obstacle obstacle;
+  obstacle.position.x = 1.0f;
+  obstacle.velocity.y = 0.5f;
+
+  std::vector<uint8_t> first;
+  std::vector<uint8_t> second;
+  std::vector<uint8_t> otherSeed;
+  for (uint32_t seed : {42u, 42u, 43u}) {
+    ScanSynthesizer synthesizer{ScanSynthesizer::defaultRoom(seed)};
+    synthesizer.setNoiseModel(noiseModel);
+    synthesizer.addObstacle(obstacle);
+    std::vector<uint8_t> &nodes = first.empty() ? first : (second.empty() ? second : otherSeed);
+    synthesizer.synthesize(7, 2000, nodes);
+  }
+  REQUIRE(2000 * 5 == first.size());
+  REQUIRE(first == second);
+  REQUIRE(first != otherSeed);
+}
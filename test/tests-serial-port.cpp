@@ -0,0 +1,82 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "catch.hpp"
+
+#include "serial-port.hpp"
+
+#include <fcntl.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+TEST_CASE("Test SerialPort writes frames from several threads without interleaving.") {
+  int master = ::posix_openpt(O_RDWR | O_NOCTTY);
+  REQUIRE(-1 != master);
+  REQUIRE(0 == ::grantpt(master));
+  REQUIRE(0 == ::unlockpt(master));
+  SerialPort port(::ptsname(master));
+  REQUIRE(port.isOpen());
+
+  // Frames larger than the buffer of the pseudo terminal are written in parts.
+  const size_t FRAME_SIZE{8192};
+  const uint32_t FRAMES{20};
+  std::atomic<uint32_t> failed{0};
+  auto writer = [&port, &failed, FRAME_SIZE, FRAMES](uint8_t value){
+    const std::vector<uint8_t> frame(FRAME_SIZE, value);
+    for (uint32_t i{0}; i < FRAMES; i++) {
+      if (!port.write(frame)) {
+        failed++;
+      }
+    }
+  };
+  std::thread a(writer, 'a');
+  std::thread b(writer, 'b');
+
+  std::vector<uint8_t> received;
+  std::vector<uint8_t> buffer(4096);
+  while (received.size() < 2 * FRAMES * FRAME_SIZE) {
+    struct pollfd fds{master, POLLIN, 0};
+    if (0 >= ::poll(&fds, 1, 1000)) {
+      break;
+    }
+    const ssize_t bytesRead = ::read(master, buffer.data(), buffer.size());
+    if (0 < bytesRead) {
+      received.insert(received.end(), buffer.begin(), buffer.begin() + bytesRead);
+    }
+  }
+  a.join();
+  b.join();
+  ::close(master);
+
+  REQUIRE(0 == failed);
+  REQUIRE(2 * FRAMES * FRAME_SIZE == received.size());
+  uint32_t interleaved{0};
+  for (size_t frame{0}; frame < received.size(); frame += FRAME_SIZE) {
+    for (size_t i{1}; i < FRAME_SIZE; i++) {
+      if (received[frame] != received[frame + i]) {
+        interleaved++;
+        break;
+      }
+    }
+  }
+  REQUIRE(0 == interleaved);
+}